@@ -0,0 +1,66 @@
+#ifndef _ZYP_BENCH_H
+#define _ZYP_BENCH_H
+/**
+ * @file
+ * Shared helpers for the micro benchmarks.
+ * This header should be included before any system header.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Read the monotonic clock in nanoseconds
+ */
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * A small xorshift generator, so that the input is reproducible across runs
+ */
+static inline uint32_t bench_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (uint32_t)(x >> 32);
+}
+
+/**
+ * Print a result line as nanoseconds per item
+ */
+static inline void bench_report(const char *name, uint64_t ns, uint64_t items)
+{
+    printf("%-32s %10.2f ns/op  (%llu ops)\n", name,
+           items ? (double)ns / (double)items : 0.0,
+           (unsigned long long)items);
+}
+
+/**
+ * Print a result line as gigabytes per second
+ */
+static inline void bench_report_bytes(const char *name, uint64_t ns,
+                                      uint64_t bytes)
+{
+    printf("%-32s %10.2f GB/s   (%llu bytes)\n", name,
+           ns ? (double)bytes / (double)ns : 0.0,
+           (unsigned long long)bytes);
+}
+
+/**
+ * Keep the compiler from optimizing away a computed value
+ */
+static volatile uint64_t bench_sink;
+
+#endif
@@ -0,0 +1,174 @@
+#include "bench.h"
+
+#include "dict_bigram.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PHRASE_COUNT 200000
+#define PAIR_COUNT (1 << 21)
+#define QUERY_COUNT 4000000
+
+// The plain table to compare with, open addressing with linear probing
+struct plain_slot {
+    uint32_t prev;
+    uint32_t next;
+    int32_t score;
+    uint32_t used;
+};
+
+struct plain_table {
+    struct plain_slot *slots;
+    size_t mask;
+};
+
+static inline size_t plain_find(const struct plain_table *t, uint32_t prev,
+                                uint32_t next)
+{
+    size_t i = dict_bigram_mix((uint64_t)prev << 32 | next) & t->mask;
+    while (t->slots[i].used
+           && (t->slots[i].prev != prev || t->slots[i].next != next)) {
+        i = (i + 1) & t->mask;
+    }
+    return i;
+}
+
+static inline int plain_lookup(const struct plain_table *t, uint32_t prev,
+                               uint32_t next, int32_t *score)
+{
+    const struct plain_slot *slot = &t->slots[plain_find(t, prev, next)];
+    if (!slot->used) {
+        return 0;
+    }
+    *score = slot->score;
+    return 1;
+}
+
+// Keep the load factor under 1/2
+static int plain_build(struct plain_table *t,
+                       const struct dict_bigram_entry *entries, size_t count)
+{
+    size_t capacity = 64;
+    while (capacity < 2 * count) {
+        capacity *= 2;
+    }
+    t->slots = calloc(capacity, sizeof(*t->slots));
+    if (!t->slots) {
+        return 1;
+    }
+    t->mask = capacity - 1;
+    for (size_t i = 0; i < count; i++) {
+        struct plain_slot *slot =
+            &t->slots[plain_find(t, entries[i].prev, entries[i].next)];
+        *slot = (struct plain_slot){
+            entries[i].prev, entries[i].next, entries[i].score, 1,
+        };
+    }
+    return 0;
+}
+
+// A skewed phrase, frequent phrases have small identifiers
+static uint32_t skewed_phrase(uint64_t *seed)
+{
+    uint32_t r = bench_rand(seed) % PHRASE_COUNT;
+    return (uint32_t)((uint64_t)r * r / PHRASE_COUNT);
+}
+
+int main(void)
+{
+    static struct dict_bigram_entry entries[PAIR_COUNT];
+    static uint32_t queries[QUERY_COUNT][2];
+    uint64_t seed = 0x5A595048u;
+
+    // Unique pairs of skewed phrases, with scores of about +-16 bits
+    struct plain_table seen = { .mask = 4 * (size_t)PAIR_COUNT - 1 };
+    seen.slots = calloc(seen.mask + 1, sizeof(*seen.slots));
+    size_t count = 0;
+    while (seen.slots && count < PAIR_COUNT) {
+        uint32_t prev = skewed_phrase(&seed), next = skewed_phrase(&seed);
+        struct plain_slot *slot = &seen.slots[plain_find(&seen, prev, next)];
+        if (slot->used) {
+            continue;
+        }
+        *slot = (struct plain_slot){ prev, next, 0, 1 };
+        entries[count].prev = prev;
+        entries[count].next = next;
+        entries[count].score = (int32_t)(bench_rand(&seed) % (32 << 8))
+                               - (16 << 8);
+        count++;
+    }
+    free(seen.slots);
+    if (count < PAIR_COUNT) {
+        return 1;
+    }
+
+    uint64_t start = bench_now_ns();
+    void *image;
+    size_t size;
+    if (dict_bigram_build(entries, PAIR_COUNT, &image, &size)) {
+        fprintf(stderr, "fail to build the bigram table\n");
+        return 1;
+    }
+    bench_report("dict_bigram_build (per pair)", bench_now_ns() - start,
+                 PAIR_COUNT);
+    struct dict_bigram lm;
+    dict_bigram_load(&lm, image, size);
+
+    struct plain_table plain;
+    if (plain_build(&plain, entries, PAIR_COUNT)) {
+        return 1;
+    }
+    size_t plain_size = (plain.mask + 1) * sizeof(struct plain_slot);
+    printf("%-32s %10.2f bytes/pair\n", "minimal perfect hash",
+           (double)size / PAIR_COUNT);
+    printf("%-32s %10.2f bytes/pair\n", "plain hash table",
+           (double)plain_size / PAIR_COUNT);
+
+    // Half of the queries are in the table, in random order
+    for (size_t i = 0; i < QUERY_COUNT; i++) {
+        if (i % 2) {
+            const struct dict_bigram_entry *e =
+                &entries[bench_rand(&seed) % PAIR_COUNT];
+            queries[i][0] = e->prev;
+            queries[i][1] = e->next;
+        } else {
+            queries[i][0] = skewed_phrase(&seed);
+            queries[i][1] = skewed_phrase(&seed);
+        }
+    }
+
+    int64_t sum = 0;
+    uint64_t found = 0;
+    int32_t score;
+    start = bench_now_ns();
+    for (size_t i = 0; i < QUERY_COUNT; i++) {
+        if (dict_bigram_lookup(&lm, queries[i][0], queries[i][1], &score)) {
+            sum += score;
+            found++;
+        }
+    }
+    bench_report("dict_bigram_lookup", bench_now_ns() - start, QUERY_COUNT);
+
+    uint64_t plain_found = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < QUERY_COUNT; i++) {
+        if (plain_lookup(&plain, queries[i][0], queries[i][1], &score)) {
+            sum += score;
+            plain_found++;
+        }
+    }
+    bench_report("plain hash table lookup", bench_now_ns() - start,
+                 QUERY_COUNT);
+
+    // The fingerprints may accept a few pairs not in the table
+    if (found < plain_found || found - plain_found > QUERY_COUNT / 100000) {
+        fprintf(stderr, "lookup mismatch: %llu vs %llu\n",
+                (unsigned long long)found, (unsigned long long)plain_found);
+        return 1;
+    }
+    free(image);
+    free(plain.slots);
+    bench_sink = (uint64_t)sum;
+    return 0;
+}
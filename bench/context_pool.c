@@ -0,0 +1,142 @@
+#include "bench.h"
+
+#include <zyphtine/context.h>
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_builder.h"
+#include "utf8.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define DICT_PATH "bench-context-pool.bin"
+#define KEY_COUNT 20000
+#define MAX_KEY_LENGTH 4
+#define SESSION_LENGTH 16
+#define SESSION_COUNT 20000
+#define CHURN_COUNT 1000000
+#define POOL_SIZE 16
+
+struct key {
+    uint16_t sylls[MAX_KEY_LENGTH];
+    uint16_t len;
+};
+
+static uint16_t sylls[SESSION_COUNT][SESSION_LENGTH];
+
+static int key_compare(const void *a, const void *b)
+{
+    const struct key *ka = (const struct key *)a;
+    const struct key *kb = (const struct key *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    for (size_t i = 0; i < n; i++) {
+        if (ka->sylls[i] != kb->sylls[i]) {
+            return ka->sylls[i] < kb->sylls[i] ? -1 : 1;
+        }
+    }
+    return (ka->len > kb->len) - (ka->len < kb->len);
+}
+
+// A short session, typing and converting a few syllables
+static int session_type(struct zyphtine_ctx *ctx, const struct zyp_dict *dict,
+                        size_t s)
+{
+    zyp_ctx_set_dict(ctx, dict);
+    for (size_t i = 0; i < SESSION_LENGTH; i++) {
+        struct preedit_char ch = { .zhuyin_syll = sylls[s][i] };
+        if (zyp_ctx_preedit_insert(ctx, i, &ch, 1) || zyp_ctx_convert(ctx)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int bench_sessions(struct zyp_ctx_pool *pool,
+                          const struct zyp_dict *dict)
+{
+    uint64_t start = bench_now_ns();
+    for (size_t s = 0; s < SESSION_COUNT; s++) {
+        struct zyphtine_ctx *ctx = pool ? zyp_ctx_pool_acquire(pool)
+                                        : zyp_ctx_new();
+        if (!ctx || session_type(ctx, dict, s)) {
+            fprintf(stderr, "fail to run a session\n");
+            return 1;
+        }
+        if (pool) {
+            zyp_ctx_pool_release(pool, ctx);
+        } else {
+            zyp_ctx_free(ctx);
+        }
+    }
+    bench_report(pool ? "session (pool)" : "session (zyp_ctx_new)",
+                 bench_now_ns() - start, SESSION_COUNT);
+    return 0;
+}
+
+int main(void)
+{
+    uint64_t seed = 0x5A595048u;
+
+    // The keys are added in order
+    static struct key keys[KEY_COUNT];
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        keys[i].len = (uint16_t)(1 + bench_rand(&seed) % MAX_KEY_LENGTH);
+        for (size_t j = 0; j < keys[i].len; j++) {
+            keys[i].sylls[j] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+    qsort(keys, KEY_COUNT, sizeof(keys[0]), key_compare);
+    struct zyp_dict_builder *b = zyp_dict_builder_new();
+    char text[MAX_KEY_LENGTH * 4];
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        size_t size = 0;
+        for (size_t j = 0; j < keys[i].len; j++) {
+            size += utf8_encode(text + size,
+                                0x4E00 + bench_rand(&seed) % 20000);
+        }
+        if (zyp_dict_builder_add(b, keys[i].sylls, keys[i].len, text, size,
+                                 bench_rand(&seed) % 10000)) {
+            fprintf(stderr, "fail to add phrase %zu\n", i);
+            return 1;
+        }
+    }
+    if (zyp_dict_builder_write(b, DICT_PATH)) {
+        fprintf(stderr, "fail to write " DICT_PATH "\n");
+        return 1;
+    }
+    zyp_dict_builder_free(b);
+    struct zyp_dict *dict = zyp_dict_open(DICT_PATH);
+    struct zyp_ctx_pool *pool = zyp_ctx_pool_new(POOL_SIZE);
+    if (!dict || !pool) {
+        fprintf(stderr, "fail to open " DICT_PATH "\n");
+        return 1;
+    }
+    for (size_t s = 0; s < SESSION_COUNT; s++) {
+        for (size_t i = 0; i < SESSION_LENGTH; i++) {
+            sylls[s][i] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < CHURN_COUNT; i++) {
+        zyp_ctx_free(zyp_ctx_new());
+    }
+    bench_report("zyp_ctx_new + zyp_ctx_free", bench_now_ns() - start,
+                 CHURN_COUNT);
+    start = bench_now_ns();
+    for (size_t i = 0; i < CHURN_COUNT; i++) {
+        zyp_ctx_pool_release(pool, zyp_ctx_pool_acquire(pool));
+    }
+    bench_report("zyp_ctx_pool_acquire + release", bench_now_ns() - start,
+                 CHURN_COUNT);
+
+    if (bench_sessions(NULL, dict) || bench_sessions(pool, dict)) {
+        return 1;
+    }
+    zyp_ctx_pool_free(pool);
+    zyp_dict_close(dict);
+    remove(DICT_PATH);
+    return 0;
+}
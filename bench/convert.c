@@ -0,0 +1,200 @@
+#include "bench.h"
+
+#include <zyphtine/context.h>
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_builder.h"
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_PATH "bench-convert.bin"
+#define KEY_COUNT 100000
+#define MAX_KEY_LENGTH 4
+#define LINE_LENGTH 40
+#define LINE_COUNT 2000
+#define TYPE_LENGTH 100
+#define TYPE_COUNT 200
+#define SENTENCE_COUNT 100
+#define BIGRAM_COUNT 400000
+
+struct key {
+    uint16_t sylls[MAX_KEY_LENGTH];
+    uint16_t len;
+};
+
+static int u64_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Type lines syllable by syllable, converting after each one, and report
+// the percentiles of the keystroke latency
+static int bench_typing(struct zyphtine_ctx *ctx, const struct zyp_dict *dict,
+                        const struct key *keys, uint64_t *seed, bool full)
+{
+    static uint64_t samples[TYPE_COUNT * TYPE_LENGTH];
+    size_t count = 0;
+    for (size_t l = 0; l < TYPE_COUNT; l++) {
+        zyp_ctx_preedit_remove(ctx, 0, zyp_ctx_preedit_length(ctx));
+        size_t len = 0;
+        while (len < TYPE_LENGTH) {
+            const struct key *k = &keys[bench_rand(seed) % KEY_COUNT];
+            for (size_t j = 0; j < k->len && len < TYPE_LENGTH; j++) {
+                struct preedit_char ch = { .zhuyin_syll = k->sylls[j] };
+                uint64_t start = bench_now_ns();
+                zyp_ctx_preedit_insert(ctx, len++, &ch, 1);
+                if (full) {
+                    // Setting the dictionary drops the lattice
+                    zyp_ctx_set_dict(ctx, dict);
+                }
+                if (zyp_ctx_convert(ctx)) {
+                    fprintf(stderr, "fail to convert\n");
+                    return 1;
+                }
+                samples[count++] = bench_now_ns() - start;
+            }
+        }
+    }
+    qsort(samples, count, sizeof(samples[0]), u64_compare);
+    printf("%-32s p50 %8llu ns  p99 %8llu ns\n",
+           full ? "keystroke (full conversion)" : "keystroke (incremental)",
+           (unsigned long long)samples[count / 2],
+           (unsigned long long)samples[count * 99 / 100]);
+    return 0;
+}
+
+static int key_compare(const void *a, const void *b)
+{
+    const struct key *ka = (const struct key *)a;
+    const struct key *kb = (const struct key *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    for (size_t i = 0; i < n; i++) {
+        if (ka->sylls[i] != kb->sylls[i]) {
+            return ka->sylls[i] < kb->sylls[i] ? -1 : 1;
+        }
+    }
+    return (ka->len > kb->len) - (ka->len < kb->len);
+}
+
+int main(void)
+{
+    static struct key keys[KEY_COUNT];
+    uint64_t seed = 0x5A595048u;
+
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        keys[i].len = (uint16_t)(1 + bench_rand(&seed) % MAX_KEY_LENGTH);
+        for (size_t j = 0; j < keys[i].len; j++) {
+            keys[i].sylls[j] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+    qsort(keys, KEY_COUNT, sizeof(keys[0]), key_compare);
+
+    // Phrases have one CJK charactor for each syllable
+    struct zyp_dict_builder *b = zyp_dict_builder_new();
+    char text[MAX_KEY_LENGTH * 4];
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        size_t len = 0;
+        for (size_t j = 0; j < keys[i].len; j++) {
+            len += utf8_encode(text + len,
+                               0x4E00 + bench_rand(&seed) % 20000);
+        }
+        if (zyp_dict_builder_add(b, keys[i].sylls, keys[i].len, text, len,
+                                 bench_rand(&seed) % 10000)) {
+            fprintf(stderr, "fail to add phrase %zu\n", i);
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < BIGRAM_COUNT; i++) {
+        if (zyp_dict_builder_add_bigram(b, bench_rand(&seed) % KEY_COUNT,
+                                        bench_rand(&seed) % KEY_COUNT,
+                                        1 + bench_rand(&seed) % 100)) {
+            fprintf(stderr, "fail to add bigram %zu\n", i);
+            return 1;
+        }
+    }
+    if (zyp_dict_builder_write(b, DICT_PATH)) {
+        fprintf(stderr, "fail to write " DICT_PATH "\n");
+        return 1;
+    }
+    zyp_dict_builder_free(b);
+
+    struct zyp_dict *dict = zyp_dict_open(DICT_PATH);
+    struct zyphtine_ctx *ctx = zyp_ctx_new();
+    if (!dict || !ctx) {
+        fprintf(stderr, "fail to open " DICT_PATH "\n");
+        return 1;
+    }
+    zyp_ctx_set_dict(ctx, dict);
+
+    // Lines made of dictionary keys, so there are phrases of every length
+    static struct preedit_char lines[LINE_COUNT][LINE_LENGTH];
+    for (size_t l = 0; l < LINE_COUNT; l++) {
+        size_t len = 0;
+        while (len < LINE_LENGTH) {
+            const struct key *k = &keys[bench_rand(&seed) % KEY_COUNT];
+            for (size_t j = 0; j < k->len && len < LINE_LENGTH; j++) {
+                lines[l][len++].zhuyin_syll = k->sylls[j];
+            }
+        }
+    }
+
+    uint64_t segments = 0, start = bench_now_ns();
+    for (size_t l = 0; l < LINE_COUNT; l++) {
+        zyp_ctx_preedit_remove(ctx, 0, zyp_ctx_preedit_length(ctx));
+        zyp_ctx_preedit_insert(ctx, 0, lines[l], LINE_LENGTH);
+        if (zyp_ctx_convert(ctx)) {
+            fprintf(stderr, "fail to convert line %zu\n", l);
+            return 1;
+        }
+        struct preedit_char ch;
+        for (size_t i = 0; i < LINE_LENGTH; i++) {
+            zyp_ctx_preedit_get(ctx, i, &ch);
+            segments += ch.seg_point;
+        }
+    }
+    bench_report("zyp_ctx_convert (40 syllables)", bench_now_ns() - start,
+                 LINE_COUNT);
+
+    // Enumerate the sentences of the lines, after the conversion
+    static struct preedit_char sentence[LINE_LENGTH];
+    uint64_t first_ns = 0, rest_ns = 0, rest = 0;
+    for (size_t l = 0; l < LINE_COUNT / 10; l++) {
+        zyp_ctx_preedit_remove(ctx, 0, zyp_ctx_preedit_length(ctx));
+        zyp_ctx_preedit_insert(ctx, 0, lines[l], LINE_LENGTH);
+        zyp_ctx_sentence_begin(ctx);
+        start = bench_now_ns();
+        zyp_ctx_sentence_next(ctx, sentence);
+        uint64_t mid = bench_now_ns();
+        size_t count = 1;
+        while (count < SENTENCE_COUNT && zyp_ctx_sentence_next(ctx, sentence)) {
+            count++;
+        }
+        first_ns += mid - start;
+        rest_ns += bench_now_ns() - mid;
+        rest += count - 1;
+    }
+    bench_report("zyp_ctx_sentence_next (1st)", first_ns, LINE_COUNT / 10);
+    bench_report("zyp_ctx_sentence_next (2nd-100th)", rest_ns, rest);
+
+    if (bench_typing(ctx, dict, keys, &seed, false)
+        || bench_typing(ctx, dict, keys, &seed, true)) {
+        return 1;
+    }
+
+    zyp_ctx_free(ctx);
+    zyp_dict_close(dict);
+    remove(DICT_PATH);
+
+    if (segments >= (uint64_t)LINE_COUNT * LINE_LENGTH) {
+        fprintf(stderr, "no phrase is chosen\n");
+        return 1;
+    }
+    bench_sink = segments;
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "bench.h"
+
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_builder.h"
+#include "utf8.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_PATH "bench-dict.bin"
+#define KEY_COUNT 200000
+#define MAX_KEY_LENGTH 4
+#define OPEN_ROUNDS 1000
+#define LOOKUP_ROUNDS 16
+#define LINE_LENGTH 8
+#define TOP_CHARS 10
+
+struct key {
+    uint16_t sylls[MAX_KEY_LENGTH];
+    uint16_t len;
+};
+
+static int key_compare(const void *a, const void *b)
+{
+    const struct key *ka = (const struct key *)a;
+    const struct key *kb = (const struct key *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    for (size_t i = 0; i < n; i++) {
+        if (ka->sylls[i] != kb->sylls[i]) {
+            return ka->sylls[i] < kb->sylls[i] ? -1 : 1;
+        }
+    }
+    return (ka->len > kb->len) - (ka->len < kb->len);
+}
+
+int main(void)
+{
+    static struct key keys[KEY_COUNT];
+    uint64_t seed = 0x5A595048u;
+
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        keys[i].len = (uint16_t)(1 + bench_rand(&seed) % MAX_KEY_LENGTH);
+        for (size_t j = 0; j < keys[i].len; j++) {
+            keys[i].sylls[j] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+    qsort(keys, KEY_COUNT, sizeof(keys[0]), key_compare);
+
+    struct zyp_dict_builder *b = zyp_dict_builder_new();
+    char text[32];
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        // Single syllables are single CJK charactors
+        size_t len = keys[i].len == 1
+                     ? utf8_encode(text, 0x4E00 + (uint32_t)(i % 20000))
+                     : (size_t)snprintf(text, sizeof(text), "phrase%zu", i);
+        if (zyp_dict_builder_add(b, keys[i].sylls, keys[i].len, text, len,
+                                 bench_rand(&seed) % 10000)) {
+            fprintf(stderr, "fail to add phrase %zu\n", i);
+            return 1;
+        }
+    }
+    if (zyp_dict_builder_write(b, DICT_PATH)) {
+        fprintf(stderr, "fail to write " DICT_PATH "\n");
+        return 1;
+    }
+    bench_report("zyp_dict_builder (per phrase)", bench_now_ns() - start,
+                 KEY_COUNT);
+    zyp_dict_builder_free(b);
+
+    start = bench_now_ns();
+    for (int r = 0; r < OPEN_ROUNDS; r++) {
+        struct zyp_dict *dict = zyp_dict_open(DICT_PATH);
+        if (!dict) {
+            fprintf(stderr, "fail to open " DICT_PATH "\n");
+            return 1;
+        }
+        zyp_dict_close(dict);
+    }
+    bench_report("zyp_dict_open + close", bench_now_ns() - start,
+                 OPEN_ROUNDS);
+
+    struct zyp_dict *dict = zyp_dict_open(DICT_PATH);
+    const struct zyp_dict_phrase *phrases;
+    uint64_t found = 0;
+    start = bench_now_ns();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+        for (size_t i = 0; i < KEY_COUNT; i++) {
+            size_t idx = bench_rand(&seed) % KEY_COUNT;
+            found += zyp_dict_lookup(dict, keys[idx].sylls, keys[idx].len,
+                                     &phrases);
+        }
+    }
+    bench_report("zyp_dict_lookup", bench_now_ns() - start,
+                 (uint64_t)LOOKUP_ROUNDS * KEY_COUNT);
+
+    // Search every suffix of lines made of dictionary keys
+    uint16_t line[LINE_LENGTH + MAX_KEY_LENGTH];
+    struct zyp_dict_match matches[LINE_LENGTH];
+    uint64_t suffixes = 0, matched = 0;
+    start = bench_now_ns();
+    for (int r = 0; r < LOOKUP_ROUNDS * KEY_COUNT / LINE_LENGTH; r++) {
+        size_t len = 0;
+        while (len < LINE_LENGTH) {
+            const struct key *k = &keys[bench_rand(&seed) % KEY_COUNT];
+            memcpy(line + len, k->sylls, k->len * sizeof(uint16_t));
+            len += k->len;
+        }
+        for (size_t i = 0; i < LINE_LENGTH; i++) {
+            matched += zyp_dict_prefix_search(dict, line + i,
+                                              LINE_LENGTH - i, matches,
+                                              LINE_LENGTH);
+        }
+        suffixes += LINE_LENGTH;
+    }
+    bench_report("zyp_dict_prefix_search (suffix)", bench_now_ns() - start,
+                 suffixes);
+    found += matched;
+
+    uint32_t chars[TOP_CHARS];
+    for (int toneless = 0; toneless < 2; toneless++) {
+        uint64_t got = 0;
+        start = bench_now_ns();
+        for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+            for (size_t i = 0; i < KEY_COUNT; i++) {
+                uint16_t syll = keys[bench_rand(&seed) % KEY_COUNT].sylls[0];
+                if (toneless) {
+                    syll &= (uint16_t)~ZYP_SYLLABLE_TONE(syll);
+                }
+                got += zyp_dict_chars(dict, syll, chars, TOP_CHARS);
+            }
+        }
+        bench_report(toneless ? "zyp_dict_chars (toneless)"
+                              : "zyp_dict_chars (toned)",
+                     bench_now_ns() - start,
+                     (uint64_t)LOOKUP_ROUNDS * KEY_COUNT);
+        bench_sink += got;
+    }
+    zyp_dict_close(dict);
+    remove(DICT_PATH);
+
+    if (found < (uint64_t)LOOKUP_ROUNDS * KEY_COUNT) {
+        fprintf(stderr, "missing phrases in the dictionary\n");
+        return 1;
+    }
+    bench_sink = found;
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "bench.h"
+
+#include <zyphtine/context.h>
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_builder.h"
+#include "utf8.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_PATH_A "bench-dict-reload-a.bin"
+#define DICT_PATH_B "bench-dict-reload-b.bin"
+#define KEY_COUNT 20000
+#define MAX_KEY_LENGTH 4
+#define LINE_LENGTH 24
+#define LINE_COUNT 64
+#define READER_COUNT 4
+#define RELOAD_COUNT 1000
+#define RELOAD_INTERVAL_NS 500000
+
+struct key {
+    uint16_t sylls[MAX_KEY_LENGTH];
+    uint16_t len;
+};
+
+static struct preedit_char lines[LINE_COUNT][LINE_LENGTH];
+/** The converted lines with each of the dictionaries */
+static uint32_t expected[2][LINE_COUNT][LINE_LENGTH];
+
+struct reader {
+    pthread_t thread;
+    struct zyp_dict_shared *shared;
+    const bool *stop;
+    uint64_t seed;
+    uint64_t lines;
+    uint64_t ns;
+    uint64_t mismatches;
+    int err;
+};
+
+static int key_compare(const void *a, const void *b)
+{
+    const struct key *ka = (const struct key *)a;
+    const struct key *kb = (const struct key *)b;
+    size_t n = ka->len < kb->len ? ka->len : kb->len;
+    for (size_t i = 0; i < n; i++) {
+        if (ka->sylls[i] != kb->sylls[i]) {
+            return ka->sylls[i] < kb->sylls[i] ? -1 : 1;
+        }
+    }
+    return (ka->len > kb->len) - (ka->len < kb->len);
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// The dictionaries have the same keys, with charactors from different
+// ranges, so a line converted with a mix of them is detected
+static int build_dict(const char *path, const struct key *keys,
+                      uint32_t first_char, uint64_t seed)
+{
+    struct zyp_dict_builder *b = zyp_dict_builder_new();
+    if (!b) {
+        return 1;
+    }
+    char text[MAX_KEY_LENGTH * 4];
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        size_t len = 0;
+        for (size_t j = 0; j < keys[i].len; j++) {
+            len += utf8_encode(text + len,
+                               first_char + bench_rand(&seed) % 4096);
+        }
+        if (zyp_dict_builder_add(b, keys[i].sylls, keys[i].len, text, len,
+                                 bench_rand(&seed) % 10000)) {
+            zyp_dict_builder_free(b);
+            return 1;
+        }
+    }
+    int err = zyp_dict_builder_write(b, path);
+    zyp_dict_builder_free(b);
+    return err;
+}
+
+// Type a line, half at once and the rest charactor by charactor
+static int type_line(struct zyphtine_ctx *ctx, size_t l)
+{
+    zyp_ctx_preedit_remove(ctx, 0, zyp_ctx_preedit_length(ctx));
+    if (zyp_ctx_preedit_insert(ctx, 0, lines[l], LINE_LENGTH / 2)
+        || zyp_ctx_convert(ctx)) {
+        return 1;
+    }
+    for (size_t i = LINE_LENGTH / 2; i < LINE_LENGTH; i++) {
+        if (zyp_ctx_preedit_insert(ctx, i, &lines[l][i], 1)
+            || zyp_ctx_convert(ctx)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Check that the line is converted with one of the dictionaries
+static bool line_matches(const struct zyphtine_ctx *ctx, size_t l)
+{
+    for (size_t v = 0; v < 2; v++) {
+        size_t i = 0;
+        struct preedit_char ch;
+        while (i < LINE_LENGTH && !zyp_ctx_preedit_get(ctx, i, &ch)
+               && ch.selected_char == expected[v][l][i]) {
+            i++;
+        }
+        if (i == LINE_LENGTH) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *reader_run(void *arg)
+{
+    struct reader *r = (struct reader *)arg;
+    struct zyphtine_ctx *ctx = zyp_ctx_new();
+    if (!ctx) {
+        r->err = 1;
+        return NULL;
+    }
+    zyp_ctx_set_shared_dict(ctx, r->shared);
+    uint64_t start = bench_now_ns();
+    while (!__atomic_load_n(r->stop, __ATOMIC_ACQUIRE)) {
+        size_t l = bench_rand(&r->seed) % LINE_COUNT;
+        if (type_line(ctx, l)) {
+            r->err = 1;
+            break;
+        }
+        r->mismatches += !line_matches(ctx, l);
+        r->lines++;
+    }
+    r->ns = bench_now_ns() - start;
+    zyp_ctx_free(ctx);
+    return NULL;
+}
+
+int main(void)
+{
+    static struct key keys[KEY_COUNT];
+    uint64_t seed = 0x5A595048u;
+
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        keys[i].len = (uint16_t)(1 + bench_rand(&seed) % MAX_KEY_LENGTH);
+        for (size_t j = 0; j < keys[i].len; j++) {
+            keys[i].sylls[j] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+    qsort(keys, KEY_COUNT, sizeof(keys[0]), key_compare);
+    if (build_dict(DICT_PATH_A, keys, 0x4E00, seed)
+        || build_dict(DICT_PATH_B, keys, 0x8000, seed + 1)) {
+        fprintf(stderr, "fail to build the dictionaries\n");
+        return 1;
+    }
+
+    for (size_t l = 0; l < LINE_COUNT; l++) {
+        size_t len = 0;
+        while (len < LINE_LENGTH) {
+            const struct key *k = &keys[bench_rand(&seed) % KEY_COUNT];
+            for (size_t j = 0; j < k->len && len < LINE_LENGTH; j++) {
+                lines[l][len++].zhuyin_syll = k->sylls[j];
+            }
+        }
+    }
+    const char *paths[] = { DICT_PATH_A, DICT_PATH_B };
+    struct zyphtine_ctx *ctx = zyp_ctx_new();
+    for (size_t v = 0; v < 2; v++) {
+        struct zyp_dict *dict = zyp_dict_open(paths[v]);
+        if (!ctx || !dict) {
+            fprintf(stderr, "fail to open %s\n", paths[v]);
+            return 1;
+        }
+        zyp_ctx_set_dict(ctx, dict);
+        for (size_t l = 0; l < LINE_COUNT; l++) {
+            type_line(ctx, l);
+            for (size_t i = 0; i < LINE_LENGTH; i++) {
+                struct preedit_char ch;
+                zyp_ctx_preedit_get(ctx, i, &ch);
+                expected[v][l][i] = ch.selected_char;
+            }
+        }
+        zyp_ctx_set_dict(ctx, NULL);
+        zyp_dict_close(dict);
+    }
+    zyp_ctx_free(ctx);
+
+    struct zyp_dict_shared *shared =
+        zyp_dict_shared_new(zyp_dict_open(DICT_PATH_A));
+    if (!shared) {
+        fprintf(stderr, "fail to open " DICT_PATH_A "\n");
+        return 1;
+    }
+    bool stop = false;
+    static struct reader readers[READER_COUNT];
+    for (size_t i = 0; i < READER_COUNT; i++) {
+        readers[i].shared = shared;
+        readers[i].stop = &stop;
+        readers[i].seed = seed + i;
+        if (pthread_create(&readers[i].thread, NULL, reader_run,
+                           &readers[i])) {
+            fprintf(stderr, "fail to start a reader\n");
+            return 1;
+        }
+    }
+
+    // Load each dictionary while the readers convert, and publish it
+    static uint64_t publish_ns[RELOAD_COUNT];
+    uint64_t open_ns = 0;
+    for (size_t i = 0; i < RELOAD_COUNT; i++) {
+        struct timespec interval = { 0, RELOAD_INTERVAL_NS };
+        nanosleep(&interval, NULL);
+        uint64_t start = bench_now_ns();
+        struct zyp_dict *dict = zyp_dict_open(paths[(i + 1) % 2]);
+        uint64_t mid = bench_now_ns();
+        if (!dict) {
+            fprintf(stderr, "fail to reload %s\n", paths[(i + 1) % 2]);
+            return 1;
+        }
+        zyp_dict_shared_publish(shared, dict);
+        open_ns += mid - start;
+        publish_ns[i] = bench_now_ns() - mid;
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+    uint64_t lines_done = 0, ns = 0, mismatches = 0;
+    int err = 0;
+    for (size_t i = 0; i < READER_COUNT; i++) {
+        pthread_join(readers[i].thread, NULL);
+        lines_done += readers[i].lines;
+        ns += readers[i].ns;
+        mismatches += readers[i].mismatches;
+        err |= readers[i].err;
+    }
+    zyp_dict_shared_free(shared);
+    remove(DICT_PATH_A);
+    remove(DICT_PATH_B);
+
+    bench_report("type a line (4 readers)", ns, lines_done);
+    bench_report("zyp_dict_open", open_ns, RELOAD_COUNT);
+    qsort(publish_ns, RELOAD_COUNT, sizeof(publish_ns[0]), u64_compare);
+    printf("%-32s p50 %8llu ns  p99 %8llu ns\n", "zyp_dict_shared_publish",
+           (unsigned long long)publish_ns[RELOAD_COUNT / 2],
+           (unsigned long long)publish_ns[RELOAD_COUNT * 99 / 100]);
+    if (err || mismatches) {
+        fprintf(stderr, "%llu lines converted with a mixed dictionary\n",
+                (unsigned long long)mismatches);
+        return 1;
+    }
+    return 0;
+}
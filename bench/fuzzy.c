@@ -0,0 +1,76 @@
+#include "bench.h"
+
+#include <zyphtine/fuzzy.h>
+#include <zyphtine/syllable.h>
+#include "cpu.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define KEY_COUNT (1 << 20)
+#define ROUNDS 16
+
+static const struct {
+    const char *name;
+    unsigned features;
+} KERNELS[] = {
+    { "scalar", 0 },
+    { "sse2", ZYP_CPU_SSE2 },
+    { "avx2", ZYP_CPU_SSE2 | ZYP_CPU_AVX2 },
+};
+
+int main(void)
+{
+    const unsigned fuzzy = ZYP_FUZZY_ZH_Z | ZYP_FUZZY_SH_S | ZYP_FUZZY_EN_ENG
+                         | ZYP_FUZZY_TONE;
+    char name[64];
+
+    for (size_t len = 1; len <= 4; len++) {
+        uint16_t *keys = malloc(KEY_COUNT * len * sizeof(uint16_t));
+        uint32_t *matches = malloc(KEY_COUNT * sizeof(uint32_t));
+        if (!keys || !matches) {
+            return 1;
+        }
+
+        // A small syllable pool, so that the query has many fuzzy matches
+        uint64_t seed = 0x5A595048u;
+        for (size_t i = 0; i < KEY_COUNT * len; i++) {
+            keys[i] = zyp_syllable_from_index(
+                    (uint16_t)(bench_rand(&seed) % 64 + 1200));
+        }
+        const uint16_t *query = keys + len * (KEY_COUNT / 2);
+
+        size_t expected = 0;
+        for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+            if ((zyp_cpu_features() & KERNELS[k].features)
+                    != KERNELS[k].features) {
+                continue;
+            }
+            zyp_cpu_restrict(KERNELS[k].features);
+
+            size_t found = 0;
+            uint64_t start = bench_now_ns();
+            for (int r = 0; r < ROUNDS; r++) {
+                found = zyp_fuzzy_match(query, len, keys, KEY_COUNT, fuzzy,
+                                        matches, KEY_COUNT);
+            }
+            uint64_t ns = bench_now_ns() - start;
+
+            if (k == 0) {
+                expected = found;
+            } else if (found != expected) {
+                fprintf(stderr, "%s found %zu keys, expected %zu\n",
+                        KERNELS[k].name, found, expected);
+                return 1;
+            }
+            snprintf(name, sizeof(name), "zyp_fuzzy_match (len %zu, %s)",
+                     len, KERNELS[k].name);
+            bench_report(name, ns, (uint64_t)ROUNDS * KEY_COUNT);
+            zyp_cpu_restrict(~0u);
+        }
+
+        free(matches);
+        free(keys);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include <zyphtine/keyboard.h>
+#include <zyphtine/syllable.h>
+
+#include <stddef.h>
+
+#define KEY_STREAM 4096
+#define ROUNDS 1024
+
+static const char *const LAYOUT_NAMES[ZYP_LAYOUT_COUNT] = {
+    "standard", "eten", "hsu", "eten26",
+};
+
+// Keys of each layout, to build a random but valid key stream
+static const char *const LAYOUT_KEYS[ZYP_LAYOUT_COUNT] = {
+    "1qaz2wsxedcrfv5tgbyhnujm8ik,9ol.0p;/- 6347",
+    "bpmfdtnlvkhg7c,./j;'sexuaorwiqzy890-= 2341",
+    "bpmfdtnlgkhjvcrzasexuyiwo ",
+    "bpmfdtnlvkhgycjqwsexuaorizx ",
+};
+
+int main(void)
+{
+    static char keys[KEY_STREAM];
+    char name[64];
+
+    for (int layout = 0; layout < ZYP_LAYOUT_COUNT; layout++) {
+        const char *pool = LAYOUT_KEYS[layout];
+        size_t poolsz = 0;
+        while (pool[poolsz]) {
+            poolsz++;
+        }
+        uint64_t seed = 0x5A595048u;
+        for (size_t i = 0; i < KEY_STREAM; i++) {
+            keys[i] = pool[bench_rand(&seed) % poolsz];
+        }
+
+        struct zyp_composer comp;
+        zyp_composer_init(&comp, (enum zyp_layout)layout);
+        uint64_t committed = 0;
+        uint16_t syll;
+        uint64_t start = bench_now_ns();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (size_t i = 0; i < KEY_STREAM; i++) {
+                if (zyp_composer_key(&comp, keys[i], &syll)
+                        == ZYP_KEY_COMMITTED) {
+                    committed += syll;
+                }
+            }
+        }
+        uint64_t ns = bench_now_ns() - start;
+
+        snprintf(name, sizeof(name), "zyp_composer_key (%s)",
+                 LAYOUT_NAMES[layout]);
+        bench_report(name, ns, (uint64_t)ROUNDS * KEY_STREAM);
+        bench_sink += committed;
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+
+#include <zyphtine/syllable.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SYLLABLE_COUNT (1 << 20)
+#define ROUNDS 8
+
+int main(void)
+{
+    uint16_t *sylls = malloc(SYLLABLE_COUNT * sizeof(uint16_t));
+    uint16_t *parsed = malloc(SYLLABLE_COUNT * sizeof(uint16_t));
+    char *text = malloc(SYLLABLE_COUNT * (ZYP_SYLLABLE_MAX_BYTES + 1) + 1);
+    if (!sylls || !parsed || !text) {
+        return 1;
+    }
+
+    uint64_t seed = 0x5A595048u;
+    for (size_t i = 0; i < SYLLABLE_COUNT; i++) {
+        // Always carry a tone, so that the round trip is unambiguous
+        do {
+            sylls[i] = (uint16_t)(((bench_rand(&seed) % 22) << 9)
+                                | ((bench_rand(&seed) % 4) << 7)
+                                | ((bench_rand(&seed) % 14) << 3));
+        } while (!sylls[i]);
+        sylls[i] |= (uint16_t)(bench_rand(&seed) % 5 + 1);
+    }
+    size_t len = zyp_syllable_print_n(text, sylls, SYLLABLE_COUNT, " ");
+
+    size_t count = 0, end = 0;
+    uint64_t start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        count = zyp_syllable_parse_n(parsed, SYLLABLE_COUNT, text, len, &end);
+    }
+    uint64_t ns = bench_now_ns() - start;
+
+    for (size_t i = 0; i < count; i++) {
+        if (parsed[i] != sylls[i]) {
+            fprintf(stderr, "mismatch at %zu\n", i);
+            return 1;
+        }
+    }
+    if (count != SYLLABLE_COUNT || end != len) {
+        fprintf(stderr, "parsed %zu syllables, stopped at %zu\n", count, end);
+        return 1;
+    }
+
+    bench_report("zyp_syllable_parse_n", ns, (uint64_t)ROUNDS * count);
+    printf("%-32s %10.2f MB/s\n", "zyp_syllable_parse_n",
+           (double)len * ROUNDS / ((double)ns / 1e9) / 1e6);
+
+    free(text);
+    free(parsed);
+    free(sylls);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include <zyphtine/syllable.h>
+#include "utf8.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SYLLABLE_COUNT 4096
+#define ROUNDS 256
+
+static const char *const LEGACY_INITIALS =
+    "ㄅㄆㄇㄈㄉㄊㄋㄌㄍㄎㄏㄐㄑㄒㄓㄔㄕㄖㄗㄘㄙ";
+static const char *const LEGACY_MEDIALS = "ㄧㄨㄩ";
+static const char *const LEGACY_RHYMES = "ㄚㄛㄜㄝㄞㄟㄠㄡㄢㄣㄤㄥㄦ";
+static const char *const LEGACY_TONES = "ˉˊˇˋ˙";
+
+// The string scanning implementation, kept here as the baseline
+static char *legacy_print(char *dest, uint16_t syll)
+{
+    if (!zyp_syllable_check(syll)) {
+        return NULL;
+    }
+
+    char *s = dest;
+    uint16_t init, med, rhy, tone;
+    if ((init = ZYP_SYLLABLE_INITIAL(syll))) {
+        utf8_strncpy(s, utf8_nthchr(LEGACY_INITIALS, (init >> 9) - 1), 1);
+        s = utf8_nextchr(s);
+    }
+    if ((med = ZYP_SYLLABLE_MEDIAL(syll))) {
+        utf8_strncpy(s, utf8_nthchr(LEGACY_MEDIALS, (med >> 7) - 1), 1);
+        s = utf8_nextchr(s);
+    }
+    if ((rhy = ZYP_SYLLABLE_RHYME(syll))) {
+        utf8_strncpy(s, utf8_nthchr(LEGACY_RHYMES, (rhy >> 3) - 1), 1);
+        s = utf8_nextchr(s);
+    }
+    if ((tone = ZYP_SYLLABLE_TONE(syll))) {
+        utf8_strncpy(s, utf8_nthchr(LEGACY_TONES, tone - 1), 1);
+        s = utf8_nextchr(s);
+    }
+    return dest;
+}
+
+int main(void)
+{
+    static uint16_t sylls[SYLLABLE_COUNT];
+    static char line[SYLLABLE_COUNT * (ZYP_SYLLABLE_MAX_BYTES + 1) + 1];
+    char buf[ZYP_SYLLABLE_MAX_BYTES + 1];
+    uint64_t seed = 0x5A595048u;
+
+    for (size_t i = 0; i < SYLLABLE_COUNT; i++) {
+        sylls[i] = (uint16_t)(((bench_rand(&seed) % 22) << 9)
+                            | ((bench_rand(&seed) % 4) << 7)
+                            | ((bench_rand(&seed) % 14) << 3)
+                            | (bench_rand(&seed) % 6));
+    }
+
+    uint64_t sum = 0, start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < SYLLABLE_COUNT; i++) {
+            legacy_print(buf, sylls[i]);
+            sum += (unsigned char)buf[0];
+        }
+    }
+    bench_report("syllable_print (legacy scan)", bench_now_ns() - start,
+                 (uint64_t)ROUNDS * SYLLABLE_COUNT);
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < SYLLABLE_COUNT; i++) {
+            zyp_syllable_print(buf, sylls[i]);
+            sum += (unsigned char)buf[0];
+        }
+    }
+    bench_report("zyp_syllable_print", bench_now_ns() - start,
+                 (uint64_t)ROUNDS * SYLLABLE_COUNT);
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        sum += zyp_syllable_print_n(line, sylls, SYLLABLE_COUNT, " ");
+    }
+    bench_report("zyp_syllable_print_n", bench_now_ns() - start,
+                 (uint64_t)ROUNDS * SYLLABLE_COUNT);
+
+    bench_sink = sum;
+    return 0;
+}
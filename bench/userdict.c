@@ -0,0 +1,70 @@
+#include "bench.h"
+
+#include <zyphtine/syllable.h>
+#include <zyphtine/userdict.h>
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define USERDICT_PATH "bench-userdict.log"
+#define KEY_COUNT 20000
+#define COMMITS 200000
+#define MAX_KEY_LENGTH 4
+
+int main(void)
+{
+    static uint16_t keys[KEY_COUNT][MAX_KEY_LENGTH];
+    static size_t lens[KEY_COUNT];
+    uint64_t seed = 0x5A595048u;
+
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        lens[i] = 1 + bench_rand(&seed) % MAX_KEY_LENGTH;
+        for (size_t j = 0; j < lens[i]; j++) {
+            keys[i][j] = zyp_syllable_from_index(
+                (uint16_t)(bench_rand(&seed) % ZYP_SYLLABLE_INDEX_COUNT));
+        }
+    }
+
+    remove(USERDICT_PATH);
+    struct zyp_userdict *ud = zyp_userdict_open(USERDICT_PATH);
+    if (!ud) {
+        fprintf(stderr, "fail to open " USERDICT_PATH "\n");
+        return 1;
+    }
+    char text[32];
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < COMMITS; i++) {
+        size_t k = bench_rand(&seed) % KEY_COUNT;
+        int len = snprintf(text, sizeof(text), "phrase%zu", k);
+        if (zyp_userdict_learn(ud, keys[k], lens[k], text, (size_t)len, 1)) {
+            fprintf(stderr, "fail to learn a phrase\n");
+            return 1;
+        }
+    }
+    bench_report("zyp_userdict_learn", bench_now_ns() - start, COMMITS);
+    size_t count = zyp_userdict_count(ud);
+    zyp_userdict_close(ud);
+
+    start = bench_now_ns();
+    ud = zyp_userdict_open(USERDICT_PATH);
+    uint64_t ns = bench_now_ns() - start;
+    if (!ud || zyp_userdict_count(ud) != count) {
+        fprintf(stderr, "fail to replay " USERDICT_PATH "\n");
+        return 1;
+    }
+    bench_report("zyp_userdict_open (per phrase)", ns, count);
+
+    const struct zyp_userdict_phrase *phrases;
+    uint64_t found = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < COMMITS; i++) {
+        size_t k = bench_rand(&seed) % KEY_COUNT;
+        found += zyp_userdict_lookup(ud, keys[k], lens[k], &phrases);
+    }
+    bench_report("zyp_userdict_lookup", bench_now_ns() - start, COMMITS);
+    zyp_userdict_close(ud);
+    remove(USERDICT_PATH);
+
+    bench_sink = found;
+    return 0;
+}
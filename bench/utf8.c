@@ -0,0 +1,328 @@
+#include "bench.h"
+
+#include "cpu.h"
+#include "utf8.h"
+#include "utf8_view.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CORPUS_SIZE (1 << 20)
+#define ROUNDS 64
+
+static const struct {
+    const char *name;
+    unsigned features;
+} KERNELS[] = {
+    { "scalar", 0 },
+    { "sse2", ZYP_CPU_SSE2 },
+    { "sse4.1", ZYP_CPU_SSE2 | ZYP_CPU_SSSE3 | ZYP_CPU_SSE41 },
+    { "avx2", ZYP_CPU_SSE2 | ZYP_CPU_SSSE3 | ZYP_CPU_SSE41 | ZYP_CPU_AVX2 },
+};
+
+#define KERNEL_SCALAR (1u << 0)
+#define KERNEL_SSE2 (1u << 1)
+#define KERNEL_SSE41 (1u << 2)
+#define KERNEL_AVX2 (1u << 3)
+
+enum corpus {
+    CORPUS_ASCII,
+    CORPUS_CJK,
+    CORPUS_MIXED,
+};
+
+static const char *const CORPUS_NAMES[] = { "ascii", "cjk", "mixed" };
+
+// Fill the buffer with charactors, ending with a null charactor
+static size_t corpus_fill(char *buf, size_t size, enum corpus kind)
+{
+    uint64_t seed = 0x55544638u;
+    size_t n = 0;
+    while (n + 5 < size) {
+        uint32_t r = bench_rand(&seed);
+        uint32_t cp;
+        if (kind == CORPUS_ASCII || (kind == CORPUS_MIXED && r % 3 == 0)) {
+            cp = 0x20 + r % 0x5F;
+        } else if (kind == CORPUS_MIXED && r % 17 == 0) {
+            cp = 0x1F600 + r % 0x50;
+        } else {
+            cp = 0x4E00 + r % 0x5200;
+        }
+        n += utf8_encode(buf + n, cp);
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// The charactor by charactor walk, kept here as the baseline
+static size_t legacy_strlen(const char *str)
+{
+    size_t len = 0;
+    while (*str) {
+        str = utf8_nextchr(str);
+        len++;
+    }
+    return len;
+}
+
+static uint64_t op_legacy_strlen(const char *buf, size_t len)
+{
+    (void)len;
+    return legacy_strlen(buf);
+}
+
+static uint64_t op_check_n(const char *buf, size_t len)
+{
+    return utf8_check_n(buf, len);
+}
+
+static uint64_t op_strlen(const char *buf, size_t len)
+{
+    (void)len;
+    return utf8_strlen(buf);
+}
+
+static uint64_t op_strlen_n(const char *buf, size_t len)
+{
+    return utf8_strlen_n(buf, len);
+}
+
+// Seek the last charactor, through the whole corpus
+static uint64_t op_nthchr_n(const char *buf, size_t len)
+{
+    size_t count = utf8_strlen_n(buf, len);
+    return (uint64_t)(utf8_nthchr_n(buf, len, count - 1) - buf);
+}
+
+static uint64_t op_nthchr(const char *buf, size_t len)
+{
+    size_t count = utf8_strlen_n(buf, len);
+    return (uint64_t)(utf8_nthchr(buf, count - 1) - buf);
+}
+
+// Decode every charactor, through the null terminated string
+static uint64_t op_decode(const char *buf, size_t len)
+{
+    (void)len;
+    uint64_t sum = 0;
+    size_t size;
+    for (uint32_t cp; (cp = utf8_decode(buf, &size)); buf += size) {
+        sum += cp;
+    }
+    return sum;
+}
+
+static uint64_t op_view_next(const char *buf, size_t len)
+{
+    struct utf8_view view = utf8_view_make(buf, len);
+    uint64_t sum = 0;
+    for (uint32_t cp; utf8_view_next(&view, &cp);) {
+        sum += cp;
+    }
+    return sum;
+}
+
+// Find the last 4 charactors, through the whole corpus
+static uint64_t op_view_find(const char *buf, size_t len)
+{
+    struct utf8_view view = utf8_view_make(buf, len);
+    struct utf8_view needle = utf8_view_slice(
+        view, utf8_view_length(view) - 4, SIZE_MAX);
+    return (uint64_t)(utf8_view_find(view, needle) - buf);
+}
+
+static const struct {
+    const char *name;
+    uint64_t (*run)(const char *buf, size_t len);
+    /** Bits of the KERNELS the operation has, the first is scalar */
+    unsigned kernels;
+} OPS[] = {
+    { "utf8_check_n", op_check_n, KERNEL_SCALAR | KERNEL_SSE41 | KERNEL_AVX2 },
+    { "legacy strlen", op_legacy_strlen, KERNEL_SCALAR },
+    { "utf8_strlen", op_strlen, KERNEL_SCALAR | KERNEL_SSE2 | KERNEL_AVX2 },
+    { "utf8_strlen_n", op_strlen_n, KERNEL_SCALAR | KERNEL_SSE2 | KERNEL_AVX2 },
+    { "utf8_nthchr", op_nthchr, KERNEL_SCALAR | KERNEL_SSE2 | KERNEL_AVX2 },
+    { "utf8_nthchr_n", op_nthchr_n, KERNEL_SCALAR | KERNEL_SSE2 | KERNEL_AVX2 },
+    { "utf8_decode", op_decode, KERNEL_SCALAR },
+    { "utf8_view_next", op_view_next, KERNEL_SCALAR },
+    { "utf8_view_find", op_view_find,
+      KERNEL_SCALAR | KERNEL_SSE2 | KERNEL_AVX2 },
+};
+
+#define INVALID_CASES 20000
+#define INVALID_MAX_SIZE 160
+
+// Validate by the table of RFC 3629, as the reference of the kernels
+static bool rfc3629_check(const unsigned char *s, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        unsigned char b = s[i];
+        size_t size;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (b < 0x80) {
+            i++;
+            continue;
+        } else if (b >= 0xC2 && b <= 0xDF) {
+            size = 2;
+        } else if (b >= 0xE0 && b <= 0xEF) {
+            size = 3;
+            lo = b == 0xE0 ? 0xA0 : 0x80;
+            hi = b == 0xED ? 0x9F : 0xBF;
+        } else if (b >= 0xF0 && b <= 0xF4) {
+            size = 4;
+            lo = b == 0xF0 ? 0x90 : 0x80;
+            hi = b == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+        if (len - i < size || s[i + 1] < lo || s[i + 1] > hi) {
+            return false;
+        }
+        for (size_t k = 2; k < size; k++) {
+            if (s[i + k] < 0x80 || s[i + k] > 0xBF) {
+                return false;
+            }
+        }
+        i += size;
+    }
+    return true;
+}
+
+/**
+ * Fill the buffer with valid charactors and an invalid sequence, which is
+ * often at the end of a 16 or 32 bytes block. Return the size.
+ */
+static size_t invalid_fill(unsigned char *buf, uint64_t *seed)
+{
+    static const size_t EDGES[] = { 13, 14, 15, 16, 29, 30, 31, 32, 61, 63 };
+    static const struct {
+        unsigned char bytes[4];
+        size_t size;
+    } FAULTS[] = {
+        // Overlong
+        { { 0xC0, 0xAF }, 2 },
+        { { 0xC1, 0xBF }, 2 },
+        { { 0xE0, 0x80, 0xAF }, 3 },
+        { { 0xE0, 0x9F, 0xBF }, 3 },
+        { { 0xF0, 0x80, 0x80, 0xAF }, 4 },
+        { { 0xF0, 0x8F, 0xBF, 0xBF }, 4 },
+        // Surrogates
+        { { 0xED, 0xA0, 0x80 }, 3 },
+        { { 0xED, 0xBF, 0xBF }, 3 },
+        // Above U+10FFFF
+        { { 0xF4, 0x90, 0x80, 0x80 }, 4 },
+        { { 0xF5, 0x80, 0x80, 0x80 }, 4 },
+        { { 0xFF }, 1 },
+        // Stray continuation
+        { { 0x80 }, 1 },
+        { { 0xBF }, 1 },
+        // Truncated
+        { { 0xC3 }, 1 },
+        { { 0xE4, 0xB8 }, 2 },
+        { { 0xF0, 0x9F, 0x98 }, 3 },
+    };
+    uint32_t r = bench_rand(seed);
+    size_t at = r & 1 ? EDGES[(r >> 1) % (sizeof(EDGES) / sizeof(EDGES[0]))]
+                      : (r >> 1) % INVALID_MAX_SIZE;
+    size_t size = 0;
+    while (size < at) {
+        uint32_t v = bench_rand(seed);
+        uint32_t cp = v % 4 ? 0x20 + (v >> 2) % 0x5F
+                            : 0x4E00 + (v >> 2) % 0x80;
+        size += utf8_encode((char *)buf + size, cp);
+    }
+    size_t f = bench_rand(seed) % (sizeof(FAULTS) / sizeof(FAULTS[0]));
+    memcpy(buf + size, FAULTS[f].bytes, FAULTS[f].size);
+    size += FAULTS[f].size;
+    // Valid charactors after it, or none, so the fault may end the string
+    size_t tail = bench_rand(seed) % 40;
+    for (size_t n = 0; n < tail; n++) {
+        size += utf8_encode((char *)buf + size, 0x4E00 + n);
+    }
+    return size;
+}
+
+// Compare every kernel of utf8_check_n() with RFC 3629 on invalid strings
+static int check_invalid(void)
+{
+    unsigned char buf[INVALID_MAX_SIZE + 4 + 40 * 3];
+    uint64_t seed = 0x494e5641u;
+    for (int i = 0; i < INVALID_CASES; i++) {
+        size_t len = invalid_fill(buf, &seed);
+        bool expected = rfc3629_check(buf, len);
+        if (expected) {
+            fprintf(stderr, "invalid case %d is valid\n", i);
+            return 1;
+        }
+        for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+            if ((zyp_cpu_features() & KERNELS[k].features)
+                != KERNELS[k].features) {
+                continue;
+            }
+            zyp_cpu_restrict(KERNELS[k].features);
+            bool result = utf8_check_n((const char *)buf, len);
+            zyp_cpu_restrict(~0u);
+            if (result != expected) {
+                fprintf(stderr, "utf8_check_n (%s) returns %d for case %d, "
+                        "expected %d\n", KERNELS[k].name, result, i,
+                        expected);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    if (check_invalid()) {
+        return 1;
+    }
+    char *buf = malloc(CORPUS_SIZE + 1);
+    if (!buf) {
+        return 1;
+    }
+    char name[64];
+
+    for (int c = CORPUS_ASCII; c <= CORPUS_MIXED; c++) {
+        size_t len = corpus_fill(buf, CORPUS_SIZE, (enum corpus)c);
+        for (size_t o = 0; o < sizeof(OPS) / sizeof(OPS[0]); o++) {
+            uint64_t expected = 0;
+            for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]);
+                 k++) {
+                if ((zyp_cpu_features() & KERNELS[k].features)
+                        != KERNELS[k].features
+                    || !(OPS[o].kernels & (1u << k))) {
+                    continue;
+                }
+                zyp_cpu_restrict(KERNELS[k].features);
+
+                uint64_t result = 0, start = bench_now_ns();
+                for (int r = 0; r < ROUNDS; r++) {
+                    result = OPS[o].run(buf, len);
+                }
+                uint64_t ns = bench_now_ns() - start;
+                zyp_cpu_restrict(~0u);
+
+                if (k == 0) {
+                    expected = result;
+                } else if (result != expected) {
+                    fprintf(stderr, "%s (%s) returns %llu, expected %llu\n",
+                            OPS[o].name, KERNELS[k].name,
+                            (unsigned long long)result,
+                            (unsigned long long)expected);
+                    return 1;
+                }
+                snprintf(name, sizeof(name), "%s (%s, %s)", OPS[o].name,
+                         CORPUS_NAMES[c], KERNELS[k].name);
+                bench_report_bytes(name, ns, (uint64_t)ROUNDS * len);
+            }
+        }
+    }
+
+    free(buf);
+    return 0;
+}
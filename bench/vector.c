@@ -0,0 +1,357 @@
+#include "bench.h"
+
+#include "vector.h"
+#include "vector_typed.h"
+
+#include <zyphtine/alloc.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ELEMENT_COUNT 1000000
+#define ROUNDS 20
+/** Phrases of the short vector benchmarks */
+#define PHRASE_COUNT 1000000
+/** Syllables of a phrase, cycling through 1 ... PHRASE_MAX_LENGTH */
+#define PHRASE_MAX_LENGTH 6
+/** Size of the blocks of the pool allocator */
+#define POOL_BLOCK_SIZE 64
+
+/** Charactors in the buffer of the splice benchmarks */
+#define BUFFER_LENGTH 64
+/** Charactors spliced into or deleted from the buffer */
+#define SPLICE_LENGTH 8
+
+// Push the elements and sum them with the generic vector
+static uint64_t generic_u16(void)
+{
+    struct zyp_vec *vec = zyp_vec_new(sizeof(uint16_t));
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ELEMENT_COUNT; i++) {
+        uint16_t syll = (uint16_t)i;
+        zyp_vec_push(vec, &syll);
+    }
+    for (size_t i = 0; i < ELEMENT_COUNT; i++) {
+        sum += *(const uint16_t *)zyp_vec_get(vec, i);
+    }
+    zyp_vec_free(vec);
+    return sum;
+}
+
+static uint64_t typed_u16(void)
+{
+    struct zyp_vec_u16 vec;
+    zyp_vec_u16_init(&vec, NULL);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ELEMENT_COUNT; i++) {
+        zyp_vec_u16_push(&vec, (uint16_t)i);
+    }
+    for (size_t i = 0; i < ELEMENT_COUNT; i++) {
+        sum += zyp_vec_u16_get(&vec, i);
+    }
+    zyp_vec_u16_release(&vec);
+    return sum;
+}
+
+static uint64_t generic_u32(void)
+{
+    struct zyp_vec *vec = zyp_vec_new(sizeof(uint32_t));
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ELEMENT_COUNT; i++) {
+        uint32_t cp = 0x4E00 + i;
+        zyp_vec_push(vec, &cp);
+    }
+    for (size_t i = 0; i < ELEMENT_COUNT; i++) {
+        sum += *(const uint32_t *)zyp_vec_get(vec, i);
+    }
+    zyp_vec_free(vec);
+    return sum;
+}
+
+static uint64_t typed_u32(void)
+{
+    struct zyp_vec_u32 vec;
+    zyp_vec_u32_init(&vec, NULL);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ELEMENT_COUNT; i++) {
+        zyp_vec_u32_push(&vec, 0x4E00 + i);
+    }
+    for (size_t i = 0; i < ELEMENT_COUNT; i++) {
+        sum += zyp_vec_u32_get(&vec, i);
+    }
+    zyp_vec_u32_release(&vec);
+    return sum;
+}
+
+// Build a short vector per phrase, as a lookup of one phrase would
+static uint64_t generic_phrase(void)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t len = i % PHRASE_MAX_LENGTH + 1;
+        struct zyp_vec *vec = zyp_vec_with_capacity(sizeof(uint16_t), len);
+        for (size_t k = 0; k < len; k++) {
+            uint16_t syll = (uint16_t)(i + k);
+            zyp_vec_push(vec, &syll);
+        }
+        for (size_t k = 0; k < len; k++) {
+            sum += *(const uint16_t *)zyp_vec_get(vec, k);
+        }
+        zyp_vec_free(vec);
+    }
+    return sum;
+}
+
+/**
+ * A pool of fixed size blocks on a free list, standing for the allocator
+ * of an application. Larger requests go to malloc().
+ */
+struct block_pool {
+    void *free_list;
+};
+
+static void *pool_allocate(void *user, size_t size)
+{
+    struct block_pool *pool = user;
+    if (size > POOL_BLOCK_SIZE) {
+        return malloc(size);
+    }
+    void *block = pool->free_list;
+    if (block) {
+        memcpy(&pool->free_list, block, sizeof(void *));
+        return block;
+    }
+    return malloc(POOL_BLOCK_SIZE);
+}
+
+static void pool_deallocate(void *user, void *ptr, size_t size)
+{
+    struct block_pool *pool = user;
+    if (!ptr) {
+        return;
+    }
+    if (size > POOL_BLOCK_SIZE) {
+        free(ptr);
+        return;
+    }
+    memcpy(ptr, &pool->free_list, sizeof(void *));
+    pool->free_list = ptr;
+}
+
+static void *pool_reallocate(void *user, void *ptr, size_t old_size,
+                             size_t size)
+{
+    if (ptr && old_size <= POOL_BLOCK_SIZE && size <= POOL_BLOCK_SIZE) {
+        return ptr;
+    }
+    if (ptr && old_size > POOL_BLOCK_SIZE && size > POOL_BLOCK_SIZE) {
+        return realloc(ptr, size);
+    }
+    void *grown = pool_allocate(user, size);
+    if (grown && ptr) {
+        memcpy(grown, ptr, old_size < size ? old_size : size);
+        pool_deallocate(user, ptr, old_size);
+    }
+    return grown;
+}
+
+static void pool_release(struct block_pool *pool)
+{
+    while (pool->free_list) {
+        void *block = pool->free_list;
+        memcpy(&pool->free_list, block, sizeof(void *));
+        free(block);
+    }
+}
+
+static uint64_t pooled_phrase(void)
+{
+    struct block_pool pool = {NULL};
+    const struct zyp_allocator allocator = {
+        pool_allocate, pool_reallocate, pool_deallocate, &pool,
+    };
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t len = i % PHRASE_MAX_LENGTH + 1;
+        struct zyp_vec *vec =
+            zyp_vec_with_allocator(sizeof(uint16_t), len, &allocator);
+        for (size_t k = 0; k < len; k++) {
+            uint16_t syll = (uint16_t)(i + k);
+            zyp_vec_push(vec, &syll);
+        }
+        for (size_t k = 0; k < len; k++) {
+            sum += *(const uint16_t *)zyp_vec_get(vec, k);
+        }
+        zyp_vec_free(vec);
+    }
+    pool_release(&pool);
+    return sum;
+}
+
+static uint64_t typed_phrase(void)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t len = i % PHRASE_MAX_LENGTH + 1;
+        struct zyp_vec_u16 vec;
+        zyp_vec_u16_init(&vec, NULL);
+        for (size_t k = 0; k < len; k++) {
+            zyp_vec_u16_push(&vec, (uint16_t)(i + k));
+        }
+        for (size_t k = 0; k < len; k++) {
+            sum += zyp_vec_u16_get(&vec, k);
+        }
+        zyp_vec_u16_release(&vec);
+    }
+    return sum;
+}
+
+static uint64_t small_phrase(void)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t len = i % PHRASE_MAX_LENGTH + 1;
+        struct zyp_small_vec_u16 vec;
+        zyp_small_vec_u16_init(&vec, NULL);
+        for (size_t k = 0; k < len; k++) {
+            zyp_small_vec_u16_push(&vec, (uint16_t)(i + k));
+        }
+        for (size_t k = 0; k < len; k++) {
+            sum += zyp_small_vec_u16_get(&vec, k);
+        }
+        zyp_small_vec_u16_release(&vec);
+    }
+    return sum;
+}
+
+// Push past the inline storage, so the small vector spills to the heap
+static uint64_t small_u32(void)
+{
+    struct zyp_small_vec_u32 vec;
+    zyp_small_vec_u32_init(&vec, NULL);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < ELEMENT_COUNT; i++) {
+        zyp_small_vec_u32_push(&vec, 0x4E00 + i);
+    }
+    for (size_t i = 0; i < ELEMENT_COUNT; i++) {
+        sum += zyp_small_vec_u32_get(&vec, i);
+    }
+    zyp_small_vec_u32_release(&vec);
+    return sum;
+}
+
+// Replace a selection in the middle of a buffer element by element
+static uint64_t single_splice(void)
+{
+    struct zyp_vec *vec = zyp_vec_new(sizeof(uint32_t));
+    uint32_t phrase[SPLICE_LENGTH];
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < BUFFER_LENGTH; i++) {
+        uint32_t cp = 0x4E00 + i;
+        zyp_vec_push(vec, &cp);
+    }
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t at = i % (BUFFER_LENGTH - SPLICE_LENGTH);
+        for (size_t k = 0; k < SPLICE_LENGTH; k++) {
+            phrase[k] = 0x4E00 + i + (uint32_t)k;
+            zyp_vec_remove(vec, at, NULL);
+        }
+        for (size_t k = 0; k < SPLICE_LENGTH; k++) {
+            zyp_vec_insert(vec, at + k, &phrase[k]);
+        }
+        sum += *(const uint32_t *)zyp_vec_get(vec, at);
+    }
+    zyp_vec_free(vec);
+    return sum;
+}
+
+static uint64_t range_splice(void)
+{
+    struct zyp_vec *vec = zyp_vec_new(sizeof(uint32_t));
+    uint32_t phrase[SPLICE_LENGTH];
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < BUFFER_LENGTH; i++) {
+        uint32_t cp = 0x4E00 + i;
+        zyp_vec_push(vec, &cp);
+    }
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t at = i % (BUFFER_LENGTH - SPLICE_LENGTH);
+        for (size_t k = 0; k < SPLICE_LENGTH; k++) {
+            phrase[k] = 0x4E00 + i + (uint32_t)k;
+        }
+        zyp_vec_remove_range(vec, at, SPLICE_LENGTH, NULL);
+        zyp_vec_insert_range(vec, at, phrase, SPLICE_LENGTH);
+        sum += *(const uint32_t *)zyp_vec_get(vec, at);
+    }
+    zyp_vec_free(vec);
+    return sum;
+}
+
+static uint64_t one_splice(void)
+{
+    struct zyp_vec *vec = zyp_vec_new(sizeof(uint32_t));
+    uint32_t phrase[SPLICE_LENGTH];
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < BUFFER_LENGTH; i++) {
+        uint32_t cp = 0x4E00 + i;
+        zyp_vec_push(vec, &cp);
+    }
+    for (uint32_t i = 0; i < PHRASE_COUNT; i++) {
+        size_t at = i % (BUFFER_LENGTH - SPLICE_LENGTH);
+        for (size_t k = 0; k < SPLICE_LENGTH; k++) {
+            phrase[k] = 0x4E00 + i + (uint32_t)k;
+        }
+        zyp_vec_splice(vec, at, SPLICE_LENGTH, NULL, phrase, SPLICE_LENGTH);
+        sum += *(const uint32_t *)zyp_vec_get(vec, at);
+    }
+    zyp_vec_free(vec);
+    return sum;
+}
+
+static uint64_t run_count(const char *name, uint64_t (*f)(void),
+                          uint64_t count)
+{
+    uint64_t sum = 0, start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        sum += f();
+    }
+    bench_report(name, bench_now_ns() - start, (uint64_t)ROUNDS * count);
+    return sum;
+}
+
+static uint64_t run(const char *name, uint64_t (*f)(void))
+{
+    return run_count(name, f, ELEMENT_COUNT);
+}
+
+int main(void)
+{
+    uint64_t a = run("zyp_vec push+get (uint16_t)", generic_u16);
+    uint64_t b = run("zyp_vec_u16 push+get", typed_u16);
+    uint64_t c = run("zyp_vec push+get (uint32_t)", generic_u32);
+    uint64_t d = run("zyp_vec_u32 push+get", typed_u32);
+    uint64_t e = run("zyp_small_vec_u32 push+get", small_u32);
+    uint64_t f = run_count("zyp_vec new+push+get+free (phrase)",
+                           generic_phrase, PHRASE_COUNT);
+    uint64_t l = run_count("zyp_vec new+push+get+free (phrase, pool)",
+                           pooled_phrase, PHRASE_COUNT);
+    uint64_t g = run_count("zyp_vec_u16 init+push+get+release (phrase)",
+                           typed_phrase, PHRASE_COUNT);
+    uint64_t h = run_count("zyp_small_vec_u16 init+push+get+release (phrase)",
+                           small_phrase, PHRASE_COUNT);
+    uint64_t i = run_count("zyp_vec_remove+insert x8 (splice)",
+                           single_splice, PHRASE_COUNT);
+    uint64_t j = run_count("zyp_vec_remove_range+insert_range (splice)",
+                           range_splice, PHRASE_COUNT);
+    uint64_t k = run_count("zyp_vec_splice (splice)", one_splice,
+                           PHRASE_COUNT);
+    if (a != b || c != d || c != e || f != g || f != h || f != l || i != j
+        || i != k) {
+        fprintf(stderr, "the vectors disagree\n");
+        return 1;
+    }
+    bench_sink = a + c + f + i;
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef ZYP_ALLOC_H
+#define ZYP_ALLOC_H
+
+/**
+ *  @file
+ *  This header file define the allocator interface, which lets the library
+ *  draw its memory from an allocator of the application
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief An allocator
+ * The functions take `user` as their first argument. They are told the size
+ * of the memory being reallocated or freed, so that pools and arenas need
+ * not record it. The allocator should outlive every object using it.
+ *
+ * Where the library accepts an allocator, NULL means the standard malloc(),
+ * realloc() and free().
+ */
+struct zyp_allocator {
+    /** @brief Allocate `size` bytes aligned for any type, or return NULL */
+    void *(*allocate)(void *user, size_t size);
+    /** @brief Resize memory of `old_size` bytes to `size` bytes, keeping the
+        content, or return NULL and leave `ptr` as is. `ptr` can be NULL. */
+    void *(*reallocate)(void *user, void *ptr, size_t old_size, size_t size);
+    /** @brief Free memory of `size` bytes, `ptr` can be NULL */
+    void (*deallocate)(void *user, void *ptr, size_t size);
+    /** @brief Data passed to the functions */
+    void *user;
+};
+
+#endif
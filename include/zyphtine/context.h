@@ -0,0 +1,267 @@
+#ifndef ZYP_CONTEXT_H
+#define ZYP_CONTEXT_H
+
+/**
+ *  @file
+ *  This header file define the input context, which holds the preedit
+ *  buffer of a session and converts it into charactors
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct zyp_allocator;
+struct zyp_dict;
+struct zyp_dict_shared;
+
+/**
+ * Charactor data in preedit buffer
+ */
+struct preedit_char {
+    /** @brief Zhuyin syllable of the charactor
+        If this field is zero, it means that the selected charactor
+        is not a Chinese charactor. */
+    uint16_t zhuyin_syll;
+    /** @brief The currently selected charactor, as a Unicode code point */
+    uint32_t selected_char;
+    /** @brief The charactor is selected by user
+        If this field is not zero, the conversion keeps the selected
+        charactor. */
+    uint8_t user_selected;
+    /** @brief Flag of segmentor
+        It is not zero if a phrase begins at this charactor, which is set by
+        the conversion. */
+    uint8_t seg_point;
+};
+
+/**
+ * @brief The main context object in this library
+ * Since this is an opaque structure, use zyp_ctx_*() functions to access
+ * the data.
+ * @see zyp_ctx_new()
+ */
+struct zyphtine_ctx;
+
+/**
+ * @brief Create a new context
+ *
+ * @retval NULL fail to allocate memory
+ * @return newly created context
+ */
+struct zyphtine_ctx *zyp_ctx_new(void);
+
+/**
+ * @brief Create a new context drawing its memory from an allocator
+ * The context and all its buffers are allocated from the allocator, which
+ * should outlive the context.
+ *
+ * @param allocator allocator of the context, or NULL for malloc()
+ * @retval NULL fail to allocate memory
+ * @return newly created context
+ */
+struct zyphtine_ctx *zyp_ctx_new_with_allocator(
+    const struct zyp_allocator *allocator);
+
+/**
+ * @brief Free the context
+ *
+ * @param ctx context object
+ */
+void zyp_ctx_free(struct zyphtine_ctx *ctx);
+
+/**
+ * @brief Clear the state of a session, keeping the memory
+ * The context is left as created by zyp_ctx_new(), except that the
+ * dictionary set to it is kept, and that its buffers keep their capacity.
+ * This takes constant time.
+ *
+ * @param ctx context object
+ */
+void zyp_ctx_reset(struct zyphtine_ctx *ctx);
+
+/**
+ * @brief Set the dictionary used by the conversion
+ * The dictionary is not owned by the context, it should outlive the
+ * context or be replaced before it is closed.
+ *
+ * @param ctx context object
+ * @param dict dictionary object, or NULL to convert without a dictionary
+ */
+void zyp_ctx_set_dict(struct zyphtine_ctx *ctx, const struct zyp_dict *dict);
+
+/**
+ * @brief Use a shared dictionary for the conversion
+ * The context holds a reference to the current dictionary of `shared`.
+ * Each conversion checks the version of `shared` with one atomic load, and
+ * switches to the new dictionary if one is published, dropping the lattice.
+ * The shared dictionary should outlive the context, or be replaced with
+ * zyp_ctx_set_dict() before it is freed.
+ *
+ * @param ctx context object
+ * @param shared shared dictionary object
+ */
+void zyp_ctx_set_shared_dict(struct zyphtine_ctx *ctx,
+                             struct zyp_dict_shared *shared);
+
+/**
+ * @brief Get the length of the preedit buffer
+ *
+ * @param ctx context object
+ * @return number of charactors in the preedit buffer
+ */
+size_t zyp_ctx_preedit_length(const struct zyphtine_ctx *ctx);
+
+/**
+ * @brief Insert charactors into the preedit buffer
+ *
+ * @param ctx context object
+ * @param pos position to insert, at most the length of the buffer
+ * @param chars charactors to be inserted
+ * @param n number of charactors
+ * @return 0 if successful, 1 if the position is not valid or fail to
+ * allocate memory
+ */
+int zyp_ctx_preedit_insert(struct zyphtine_ctx *ctx, size_t pos,
+                           const struct preedit_char *chars, size_t n);
+
+/**
+ * @brief Remove charactors from the preedit buffer
+ *
+ * @param ctx context object
+ * @param pos position of the first charactor to be removed
+ * @param n number of charactors
+ * @return 0 if successful, 1 if the range is not valid
+ */
+int zyp_ctx_preedit_remove(struct zyphtine_ctx *ctx, size_t pos, size_t n);
+
+/**
+ * @brief Get a charactor in the preedit buffer
+ *
+ * @param ctx context object
+ * @param pos position of the charactor
+ * @param out where to copy the charactor
+ * @return 0 if successful, 1 if the position is not valid
+ */
+int zyp_ctx_preedit_get(const struct zyphtine_ctx *ctx, size_t pos,
+                        struct preedit_char *out);
+
+/**
+ * @brief Replace a charactor in the preedit buffer
+ *
+ * @param ctx context object
+ * @param pos position of the charactor
+ * @param ch new content of the charactor
+ * @return 0 if successful, 1 if the position is not valid
+ */
+int zyp_ctx_preedit_set(struct zyphtine_ctx *ctx, size_t pos,
+                        const struct preedit_char *ch);
+
+/**
+ * @brief Convert the preedit buffer into charactors
+ * The most probable phrase sequence is chosen for the syllables, and the
+ * `selected_char` and `seg_point` fields of the whole buffer are filled.
+ * The charactors selected by user are kept, only the phrases agreeing with
+ * them are considered.
+ * The lattice is kept in the context, and only the part which may depend
+ * on the charactors changed since the last conversion is recomputed. So
+ * the cost of typing a charactor does not grow with the length of the
+ * buffer, and no memory is allocated unless the buffer grows.
+ *
+ * @param ctx context object
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_ctx_convert(struct zyphtine_ctx *ctx);
+
+/**
+ * @brief Start enumerating the candidate sentences of the preedit buffer
+ * The buffer is converted if it has changed, and the sentences are then
+ * enumerated with zyp_ctx_sentence_next() in order of score.
+ *
+ * @param ctx context object
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_ctx_sentence_begin(struct zyphtine_ctx *ctx);
+
+/**
+ * @brief Get the next candidate sentence
+ * The first sentence is the one chosen by zyp_ctx_convert(), it costs no
+ * search. Each of the next sentences costs logarithmic time in the number
+ * of sentences enumerated, after a preparation when the second one is
+ * requested. Sentences with the same charactors but different segments are
+ * enumerated separately.
+ * The enumeration ends when the preedit buffer is changed.
+ *
+ * @param ctx context object
+ * @param chars array of zyp_ctx_preedit_length() charactors to store the
+ * preedit buffer with the sentence in `selected_char` and `seg_point`
+ * @return true if a sentence is stored, false if there are no more
+ * sentences or fail to allocate memory
+ */
+bool zyp_ctx_sentence_next(struct zyphtine_ctx *ctx,
+                           struct preedit_char *chars);
+
+/**
+ * @brief A pool of contexts, for the sessions which come and go often
+ * The contexts are created with their buffers allocated for a typical
+ * sentence, and are reset and kept by the pool when released, so getting
+ * one neither allocates memory nor warms the buffers again. The pool can be
+ * used from several threads.
+ */
+struct zyp_ctx_pool;
+
+/**
+ * @brief Create a pool of contexts
+ *
+ * @param count number of contexts created and kept by the pool
+ * @retval NULL fail to allocate memory
+ * @return newly created pool
+ */
+struct zyp_ctx_pool *zyp_ctx_pool_new(size_t count);
+
+/**
+ * @brief Create a pool of contexts drawing its memory from an allocator
+ * The pool and every context it creates are allocated from the allocator,
+ * which should outlive the pool and the contexts. It is called from every
+ * thread acquiring a context when the pool is empty.
+ *
+ * @param count number of contexts created and kept by the pool
+ * @param allocator allocator of the pool, or NULL for malloc()
+ * @retval NULL fail to allocate memory
+ * @return newly created pool
+ */
+struct zyp_ctx_pool *zyp_ctx_pool_new_with_allocator(
+    size_t count, const struct zyp_allocator *allocator);
+
+/**
+ * @brief Free the pool and the contexts it keeps
+ * The contexts acquired from it should be freed with zyp_ctx_free() or
+ * released before.
+ *
+ * @param pool pool object
+ */
+void zyp_ctx_pool_free(struct zyp_ctx_pool *pool);
+
+/**
+ * @brief Get a context from the pool
+ * A new context is created if the pool is empty.
+ * The context may have the dictionary of the last session which used it,
+ * see zyp_ctx_reset().
+ *
+ * @param pool pool object
+ * @retval NULL fail to allocate memory
+ * @return context object
+ */
+struct zyphtine_ctx *zyp_ctx_pool_acquire(struct zyp_ctx_pool *pool);
+
+/**
+ * @brief Reset a context and give it back to the pool
+ * The context is freed if the pool is full.
+ *
+ * @param pool pool object
+ * @param ctx context object
+ */
+void zyp_ctx_pool_release(struct zyp_ctx_pool *pool,
+                          struct zyphtine_ctx *ctx);
+
+#endif
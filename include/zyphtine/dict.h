@@ -0,0 +1,267 @@
+#ifndef ZYP_DICT_H
+#define ZYP_DICT_H
+
+/**
+ *  @file
+ *  This header file define the read-only binary dictionary, which maps
+ *  syllable sequences to phrases
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A phrase record in the dictionary
+ * Records are stored in the dictionary image as is, and the lookup functions
+ * return pointers into the image directly.
+ */
+struct zyp_dict_phrase {
+    /** @brief Offset of the text in the text pool */
+    uint32_t text_offset;
+    /** @brief Size in bytes of the text, excluding the null charactor */
+    uint32_t text_length;
+    /** @brief Frequency of the phrase */
+    uint32_t frequency;
+};
+
+/**
+ * @brief Phrases matching a prefix of a syllable sequence
+ * @see zyp_dict_prefix_search()
+ */
+struct zyp_dict_match {
+    /** @brief Number of syllables matched */
+    size_t length;
+    /** @brief Phrases of the prefix, sorted by frequency */
+    const struct zyp_dict_phrase *phrases;
+    /** @brief Number of phrases */
+    size_t count;
+};
+
+/**
+ * @brief A read-only dictionary
+ * The dictionary image is memory mapped and shared by every process opening
+ * the same file. Since this is an opaque structure, use zyp_dict_*()
+ * functions to access the data.
+ * @see zyp_dict_open()
+ */
+struct zyp_dict;
+
+/**
+ * @brief Open a dictionary file
+ * The file is mapped into memory, only the header is validated, so opening
+ * is done in constant time regardless of the dictionary size.
+ * @note The format is little-endian, opening fails on big-endian hosts.
+ *
+ * @param path path to the dictionary file
+ * @retval NULL fail to open or map the file, or the file is not valid
+ * @return newly opened dictionary
+ */
+struct zyp_dict *zyp_dict_open(const char *path);
+
+/**
+ * @brief Open a dictionary image in memory
+ * The image is not copied, it should be kept alive and unchanged until the
+ * dictionary is closed.
+ * @see zyp_dict_open()
+ *
+ * @param data dictionary image, aligned to 8 bytes
+ * @param size size in bytes of the image
+ * @retval NULL the image is not valid
+ * @return newly opened dictionary
+ */
+struct zyp_dict *zyp_dict_open_memory(const void *data, size_t size);
+
+/**
+ * @brief Take a reference to the dictionary
+ * A dictionary is freed when its last reference is closed, so a reference
+ * keeps it alive while other threads close theirs. Taking and closing
+ * references are thread-safe.
+ * @see zyp_dict_close()
+ *
+ * @param dict dictionary object
+ * @return the same dictionary
+ */
+struct zyp_dict *zyp_dict_ref(struct zyp_dict *dict);
+
+/**
+ * @brief Close the dictionary
+ * This drops a reference, the opening or one from zyp_dict_ref(). After the
+ * last one is dropped, the pointers returned by the lookup functions are
+ * invalid.
+ *
+ * @param dict dictionary object
+ */
+void zyp_dict_close(struct zyp_dict *dict);
+
+/**
+ * @brief Find the phrases of a syllable sequence
+ * The phrases are sorted by frequency in descending order. The lookup takes
+ * time linear to the sequence length.
+ *
+ * @param dict dictionary object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param phrases where to store the pointer to the first phrase
+ * @return number of phrases, 0 if the sequence is not found
+ */
+size_t zyp_dict_lookup(const struct zyp_dict *dict, const uint16_t *sylls,
+                       size_t len, const struct zyp_dict_phrase **phrases);
+
+/**
+ * @brief Find the phrases of every prefix of a syllable sequence
+ * The prefixes are found in a single walk of the dictionary trie, in time
+ * linear to the sequence length, without allocating memory.
+ * The matches are stored from the shortest prefix to the longest.
+ * @see zyp_dict_lookup()
+ *
+ * @param dict dictionary object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param matches array to store the matches
+ * @param n capacity of the array, the walk stops when it is full
+ * @return number of matches stored
+ */
+size_t zyp_dict_prefix_search(const struct zyp_dict *dict,
+                              const uint16_t *sylls, size_t len,
+                              struct zyp_dict_match *matches, size_t n);
+
+/**
+ * @brief Get the most frequent single charactors of a syllable
+ * The charactors are sorted by frequency in descending order. If the
+ * syllable has no tone, the charactors of all its tones are merged by
+ * frequency, and a charactor having several tones is stored once.
+ * This function does not allocate memory.
+ *
+ * @param dict dictionary object
+ * @param syll syllable, with or without a tone
+ * @param chars array to store the Unicode code points
+ * @param n capacity of the array
+ * @return number of charactors stored
+ */
+size_t zyp_dict_chars(const struct zyp_dict *dict, uint16_t syll,
+                      uint32_t *chars, size_t n);
+
+/**
+ * @brief Get the text of a phrase
+ *
+ * @param dict dictionary object
+ * @param phrase phrase record returned from the dictionary
+ * @retval NULL the record is out of the dictionary
+ * @return null terminated UTF-8 string inside the dictionary image
+ */
+const char *zyp_dict_phrase_text(const struct zyp_dict *dict,
+                                 const struct zyp_dict_phrase *phrase);
+
+/**
+ * @brief Get the identifier of a phrase
+ * Identifiers are the positions of the phrases in the dictionary, they are in
+ * `[0, zyp_dict_phrase_count())`.
+ *
+ * @param dict dictionary object
+ * @param phrase phrase record returned from the dictionary
+ * @retval UINT32_MAX the phrase is not in the dictionary
+ * @return identifier of the phrase
+ */
+uint32_t zyp_dict_phrase_id(const struct zyp_dict *dict,
+                            const struct zyp_dict_phrase *phrase);
+
+/**
+ * @brief Get the total number of phrases in the dictionary
+ *
+ * @param dict dictionary object
+ * @return number of phrases
+ */
+size_t zyp_dict_phrase_count(const struct zyp_dict *dict);
+
+/**
+ * @brief Get the sum of the phrase frequencies
+ * It is stored in the dictionary image. For the images built without it,
+ * it is computed from all the phrases.
+ *
+ * @param dict dictionary object
+ * @return total frequency
+ */
+uint64_t zyp_dict_total_frequency(const struct zyp_dict *dict);
+
+/**
+ * @brief Get the bigram score of a phrase pair
+ * The score is how much more likely the next phrase follows the previous
+ * one than appears alone, as a base 2 logarithm in units of 1/256. The
+ * scores are stored quantized in a minimal perfect hash table, and a
+ * lookup touches two cache lines.
+ * @see zyp_dict_phrase_id()
+ *
+ * @param dict dictionary object
+ * @param prev identifier of the previous phrase
+ * @param next identifier of the next phrase
+ * @return score of the pair, 0 if the pair is not known
+ */
+int32_t zyp_dict_bigram(const struct zyp_dict *dict, uint32_t prev,
+                        uint32_t next);
+
+/**
+ * @brief A dictionary shared by many contexts, which can be replaced while
+ * they use it
+ * The current dictionary is published with an atomic pointer. Getting it
+ * takes no lock: a reader announces itself in one of two counters, loads
+ * the pointer and takes a reference. A publisher swaps the pointer, then
+ * waits only for the readers announced before the swap, which are a few
+ * instructions long, and drops the reference of the old dictionary. The old
+ * dictionary is freed when the last context holding it moves to the new
+ * one, so conversions in progress are never blocked.
+ * @see zyp_ctx_set_shared_dict()
+ */
+struct zyp_dict_shared;
+
+/**
+ * @brief Create a shared dictionary
+ *
+ * @param dict the first dictionary, whose reference is taken over
+ * @retval NULL `dict` is NULL, or fail to allocate memory
+ * @return newly created shared dictionary
+ */
+struct zyp_dict_shared *zyp_dict_shared_new(struct zyp_dict *dict);
+
+/**
+ * @brief Free the shared dictionary
+ * It should not be used by any thread or context anymore. The current
+ * dictionary is closed.
+ *
+ * @param shared shared dictionary object
+ */
+void zyp_dict_shared_free(struct zyp_dict_shared *shared);
+
+/**
+ * @brief Replace the current dictionary
+ * The contexts switch to the new dictionary at their next conversion.
+ * Publishing from several threads is serialized.
+ *
+ * @param shared shared dictionary object
+ * @param dict the new dictionary, whose reference is taken over
+ */
+void zyp_dict_shared_publish(struct zyp_dict_shared *shared,
+                             struct zyp_dict *dict);
+
+/**
+ * @brief Get a reference to the current dictionary
+ * It should be closed with zyp_dict_close().
+ *
+ * @param shared shared dictionary object
+ * @param version where to store the version of the dictionary, can be NULL
+ * @return the current dictionary
+ */
+struct zyp_dict *zyp_dict_shared_get(struct zyp_dict_shared *shared,
+                                     uint64_t *version);
+
+/**
+ * @brief Get the version of the current dictionary
+ * The version grows by one with each publishing, so comparing it with the
+ * version of a dictionary tells if there is a newer one, at the cost of one
+ * atomic load.
+ *
+ * @param shared shared dictionary object
+ * @return version of the current dictionary
+ */
+uint64_t zyp_dict_shared_version(const struct zyp_dict_shared *shared);
+
+#endif
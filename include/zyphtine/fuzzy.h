@@ -0,0 +1,53 @@
+#ifndef ZYP_FUZZY_H
+#define ZYP_FUZZY_H
+
+/**
+ *  @file
+ *  This header file define the fuzzy matching of syllables, which tolerates
+ *  the commonly confused symbols and omitted tones
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZYP_FUZZY_ZH_Z      (1u << 0)   ///< ㄓ and ㄗ
+#define ZYP_FUZZY_CH_C      (1u << 1)   ///< ㄔ and ㄘ
+#define ZYP_FUZZY_SH_S      (1u << 2)   ///< ㄕ and ㄙ
+#define ZYP_FUZZY_AN_ANG    (1u << 3)   ///< ㄢ and ㄤ
+#define ZYP_FUZZY_EN_ENG    (1u << 4)   ///< ㄣ and ㄥ
+#define ZYP_FUZZY_TONE      (1u << 5)   ///< Ignore tones
+
+/**
+ * The maximum length of a key in syllables for zyp_fuzzy_match()
+ */
+#define ZYP_FUZZY_MAX_LENGTH 32
+
+/**
+ * Map a syllable to the representative of its fuzzy class
+ * Two syllables are fuzzy equal if they have the same representative.
+ *
+ * @param syll valid syllable
+ * @param fuzzy bitwise OR of `ZYP_FUZZY_*` flags
+ * @return normalized syllable
+ */
+uint16_t zyp_fuzzy_normalize(uint16_t syll, unsigned fuzzy);
+
+/**
+ * Find the keys fuzzy equal to the query
+ * Keys are packed in a single array, each takes `len` syllables. SIMD kernels
+ * are selected at runtime if the CPU supports them.
+ *
+ * @param query syllables to be matched
+ * @param len length of the query and each key, at most ZYP_FUZZY_MAX_LENGTH
+ * @param keys packed array of `count * len` syllables
+ * @param count number of keys
+ * @param fuzzy bitwise OR of `ZYP_FUZZY_*` flags
+ * @param matches array to store the indexes of the matched keys
+ * @param cap capacity of the matches array
+ * @return number of indexes stored. Scanning stops when the array is full.
+ */
+size_t zyp_fuzzy_match(const uint16_t *query, size_t len,
+                       const uint16_t *keys, size_t count, unsigned fuzzy,
+                       uint32_t *matches, size_t cap);
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef ZYP_KEYBOARD_H
+#define ZYP_KEYBOARD_H
+
+/**
+ *  @file
+ *  This header file define the keyboard layouts, and the composer which
+ *  turns key strokes into syllables
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Keyboard layouts supported by the composer
+ */
+enum zyp_layout {
+    ZYP_LAYOUT_STANDARD,    ///< 大千 (Standard)
+    ZYP_LAYOUT_ETEN,        ///< 倚天 (Eten)
+    ZYP_LAYOUT_HSU,         ///< 許氏 (Hsu)
+    ZYP_LAYOUT_ETEN26,      ///< 倚天26鍵 (Eten 26 keys)
+    ZYP_LAYOUT_COUNT,
+};
+
+/**
+ * The result of feeding a key into the composer
+ */
+enum zyp_key_result {
+    /** The key is not a part of the layout, and should be handled by caller */
+    ZYP_KEY_IGNORED,
+    /** The key is consumed, and the composition is changed */
+    ZYP_KEY_ABSORBED,
+    /** The key completes the syllable, which is written to the output */
+    ZYP_KEY_COMMITTED,
+};
+
+/**
+ * @brief A compiled-in keyboard layout table
+ * @see zyp_composer_init()
+ */
+struct zyp_keymap;
+
+/**
+ * @brief The composition state of a syllable being typed
+ * It is a plain value type without any allocation, so it can be embedded
+ * in other structures.
+ */
+struct zyp_composer {
+    /** @brief The table of the current layout */
+    const struct zyp_keymap *keymap;
+    /** @brief The components typed so far */
+    uint16_t syll;
+    /**
+     * @brief The initial typed before it is converted by ㄧ or ㄩ, 0 if the
+     * initial is not converted
+     */
+    uint16_t unconverted_initial;
+};
+
+/**
+ * Initialize a composer with the given layout
+ *
+ * @param comp composer object
+ * @param layout keyboard layout
+ * @return 0 if successful, 1 if the layout is not valid
+ */
+int zyp_composer_init(struct zyp_composer *comp, enum zyp_layout layout);
+
+/**
+ * Change the layout of a composer
+ * The current composition is cleared.
+ *
+ * @param comp composer object
+ * @param layout keyboard layout
+ * @return 0 if successful, 1 if the layout is not valid
+ */
+int zyp_composer_set_layout(struct zyp_composer *comp, enum zyp_layout layout);
+
+/**
+ * Feed an ASCII key into the composer
+ * For the layouts sharing keys between symbols (Hsu and Eten26), the symbol
+ * is decided by what has been typed, and the initial may be converted when
+ * a later symbol is typed(e.g. ㄓ to ㄐ when followed by ㄧ).
+ *
+ * @param comp composer object
+ * @param key ASCII code of the key
+ * @param syll where to store the completed syllable
+ * @return how the key is handled
+ */
+enum zyp_key_result zyp_composer_key(struct zyp_composer *comp, int key,
+                                     uint16_t *syll);
+
+/**
+ * Remove the last typed symbol
+ *
+ * @param comp composer object
+ * @return true if a symbol is removed, false if the composition is empty
+ */
+bool zyp_composer_backspace(struct zyp_composer *comp);
+
+/**
+ * Get the syllable being composed
+ *
+ * @param comp composer object
+ * @return the incomplete syllable, 0 if nothing is typed
+ */
+static inline uint16_t zyp_composer_peek(const struct zyp_composer *comp)
+{
+    return comp->syll;
+}
+
+/**
+ * Discard the syllable being composed
+ *
+ * @param comp composer object
+ */
+static inline void zyp_composer_clear(struct zyp_composer *comp)
+{
+    comp->syll = 0;
+    comp->unconverted_initial = 0;
+}
+
+#endif
@@ -8,6 +8,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define ZYP_BOPOMOFO_B      ((uint16_t)1 << 9)  ///< ㄅ
@@ -56,33 +57,50 @@
 #define ZYP_TONE_4          ((uint16_t)4)       ///< ˋ
 #define ZYP_TONE_5          ((uint16_t)5)       ///< ˙
 
+/**
+ * The maximum size in bytes of a printed syllable, excluding the null charactor
+ */
+#define ZYP_SYLLABLE_MAX_BYTES 11
+
+/**
+ * The number of legal syllables, which is also the size of the dense index.
+ * It covers the 411 standard Mandarin syllables, with each of the five tones
+ * and without tone.
+ */
+#define ZYP_SYLLABLE_INDEX_COUNT 2466
+
+/**
+ * The dense index of an illegal syllable
+ */
+#define ZYP_SYLLABLE_INDEX_INVALID ((uint16_t)0xFFFF)
+
 /**
  * Get the initial(聲母) part of a syllable
  *
  * @param syll valid syllable
  */
-#define ZYP_SYLLABLE_INITIAL(syll) (syll & 0x3F00)
+#define ZYP_SYLLABLE_INITIAL(syll) ((syll) & 0x3E00)
 
 /**
  * Get the medial(介音) part of a syllable
  *
  * @param syll valid syllable
  */
-#define ZYP_SYLLABLE_MEDIAL(syll) (syll & 0x0180)
+#define ZYP_SYLLABLE_MEDIAL(syll) ((syll) & 0x0180)
 
 /**
  * Get the rhyme(韻母) part of a syllable
  *
  * @param syll valid syllable
  */
-#define ZYP_SYLLABLE_RHYME(syll) (syll & 0x0078)
+#define ZYP_SYLLABLE_RHYME(syll) ((syll) & 0x0078)
 
 /**
  * Get the tone(聲調) part of a syllable
  *
  * @param syll valid syllable
  */
-#define ZYP_SYLLABLE_TONE(syll) (syll & 0x0007)
+#define ZYP_SYLLABLE_TONE(syll) ((syll) & 0x0007)
 
 /**
  * Check if the syllable is valid
@@ -92,6 +110,40 @@
  */
 bool zyp_syllable_check(uint16_t syll);
 
+/**
+ * Check if the syllable is a legal Mandarin syllable
+ * Unlike zyp_syllable_check(), combinations which do not occur in Mandarin,
+ * such as ㄅㄩ, are rejected. A syllable without tone is legal if it would
+ * be legal with a tone.
+ *
+ * @param syll syllable to be verified
+ * @return true if the syllable is legal
+ */
+bool zyp_syllable_is_legal(uint16_t syll);
+
+/**
+ * Get the dense index of a legal syllable
+ * The indexes are in `[0, ZYP_SYLLABLE_INDEX_COUNT)`, and keep the numeric
+ * order of the syllables. The five tones and the toneless form of a syllable
+ * are adjacent, starting from the toneless one.
+ * @see zyp_syllable_from_index()
+ *
+ * @param syll any syllable
+ * @retval ZYP_SYLLABLE_INDEX_INVALID if the syllable is not legal
+ * @return the dense index of the syllable
+ */
+uint16_t zyp_syllable_to_index(uint16_t syll);
+
+/**
+ * Get the syllable of a dense index
+ * @see zyp_syllable_to_index()
+ *
+ * @param index dense index
+ * @retval 0 if the index is out of range
+ * @return the legal syllable of the index
+ */
+uint16_t zyp_syllable_from_index(uint16_t index);
+
 /**
  * Check if the syllable is consisted of single symbol
  *
@@ -144,4 +196,56 @@ bool zyp_syllable_is_tones(uint16_t syll);
  */
 char *zyp_syllable_print(char *dest, uint16_t syll);
 
+/**
+ * Print an array of syllables to a single UTF-8 string
+ * Syllables are joined with the given separator, and the result is always
+ * null terminated.
+ * @note you need to reserve at least
+ * `n * ZYP_SYLLABLE_MAX_BYTES + (n - 1) * strlen(sep) + 1` bytes in the
+ * string buffer, or a buffer overflow may occurred!
+ *
+ * @param dest string to be printed
+ * @param sylls array of valid syllables
+ * @param n number of syllables in the array
+ * @param sep separator placed between syllables, can be NULL for none
+ * @retval SIZE_MAX if any of the syllables is not valid
+ * @return length in bytes of the printed string(excluding null charactor)
+ */
+size_t zyp_syllable_print_n(char *dest, const uint16_t *sylls, size_t n,
+                            const char *sep);
+
+/**
+ * Parse a syllable from the beginning of a UTF-8 string
+ * The components should appear in the order of initial, medial, rhyme and
+ * tone. The syllable ends at a tone mark, or before a component which
+ * cannot follow the previous one.
+ * @note An unmarked syllable is parsed with no tone (0), not `ZYP_TONE_1`
+ *
+ * @param str UTF-8 string, not necessary null terminated
+ * @param len size in bytes of the string
+ * @param syll where to store the parsed syllable, can be NULL
+ * @retval 0 if no syllable can be parsed at the beginning of the string
+ * @return number of bytes consumed
+ */
+size_t zyp_syllable_parse(const char *str, size_t len, uint16_t *syll);
+
+/**
+ * Parse a UTF-8 string to an array of syllables
+ * Syllables may be separated with ASCII whitespaces or written adjacently.
+ * Parsing stops at the end of the string, when `dest` is full, or at the
+ * first malformed syllable.
+ * @see zyp_syllable_parse()
+ *
+ * @param dest array to store the syllables, or NULL to only count them
+ * @param n capacity of the array, ignored if `dest` is NULL
+ * @param str UTF-8 string, not necessary null terminated
+ * @param len size in bytes of the string
+ * @param end where to store the byte offset that parsing stops, can be NULL.
+ * If it is less than `len` and `dest` is not full, it is the beginning of
+ * a malformed syllable.
+ * @return number of syllables parsed
+ */
+size_t zyp_syllable_parse_n(uint16_t *dest, size_t n, const char *str,
+                            size_t len, size_t *end);
+
 #endif
@@ -0,0 +1,160 @@
+#ifndef ZYP_USERDICT_H
+#define ZYP_USERDICT_H
+
+/**
+ *  @file
+ *  This header file define the user dictionary, which keeps the phrases
+ *  learned from the user and their frequencies
+ */
+
+#include <zyphtine/alloc.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A phrase in the user dictionary
+ */
+struct zyp_userdict_phrase {
+    /** @brief Null terminated UTF-8 text */
+    const char *text;
+    /** @brief Size in bytes of the text, excluding the null charactor */
+    uint32_t text_length;
+    /** @brief Frequency of the phrase */
+    uint32_t frequency;
+};
+
+/**
+ * @brief A user dictionary
+ * The phrases are kept in a hash table in memory. Every change is appended
+ * to a log file with a single `write()`. Once the log grows much larger than
+ * the phrases it holds, it is compacted by zyp_userdict_compact(), or when
+ * the dictionary is opened or closed. A torn record at the end of
+ * the log, left by a crash, is dropped when the dictionary is opened.
+ * Since this is an opaque structure, use zyp_userdict_*() functions to
+ * access the data.
+ * @note A log file should be opened by only one process at a time.
+ * @see zyp_userdict_open()
+ */
+struct zyp_userdict;
+
+/**
+ * @brief Open a user dictionary
+ * The log file is created if it does not exist, otherwise it is replayed.
+ *
+ * @param path path to the log file
+ * @retval NULL fail to open the file, the file is not a user dictionary, or
+ * fail to allocate memory
+ * @return newly opened user dictionary
+ */
+struct zyp_userdict *zyp_userdict_open(const char *path);
+
+/**
+ * @brief Open a user dictionary drawing its memory from an allocator
+ * The hash table, the keys, the phrases and their texts, and the buffers of
+ * the log are all allocated from the allocator.
+ *
+ * @param path path to the log file
+ * @param allocator allocator of the dictionary, or NULL for malloc()
+ * @retval NULL fail to open the file, the file is not a user dictionary, or
+ * fail to allocate memory
+ * @return newly opened user dictionary
+ */
+struct zyp_userdict *zyp_userdict_open_with_allocator(
+    const char *path, const struct zyp_allocator *allocator);
+
+/**
+ * @brief Close the user dictionary
+ * The log is compacted if it has grown, and flushed to the disk before
+ * closing.
+ *
+ * @param ud user dictionary object
+ */
+void zyp_userdict_close(struct zyp_userdict *ud);
+
+/**
+ * @brief Find the phrases of a syllable sequence
+ * The phrases are sorted by frequency in descending order. They are owned by
+ * the dictionary, and valid until the next change.
+ *
+ * @param ud user dictionary object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param phrases where to store the pointer to the first phrase
+ * @return number of phrases, 0 if the sequence is not found
+ */
+size_t zyp_userdict_lookup(const struct zyp_userdict *ud,
+                           const uint16_t *sylls, size_t len,
+                           const struct zyp_userdict_phrase **phrases);
+
+/**
+ * @brief Learn a phrase, or raise its frequency
+ * A new phrase starts with the given frequency, otherwise the frequency is
+ * added to the phrase, saturating at `UINT32_MAX`. If the change fails to be
+ * written to the log, the dictionary is left unchanged.
+ *
+ * @param ud user dictionary object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param text UTF-8 text, not necessarily null terminated
+ * @param textlen size in bytes of the text
+ * @param frequency frequency to add
+ * @return 0 if successful, 1 otherwise
+ */
+int zyp_userdict_learn(struct zyp_userdict *ud, const uint16_t *sylls,
+                       size_t len, const char *text, size_t textlen,
+                       uint32_t frequency);
+
+/**
+ * @brief Remove a phrase
+ *
+ * @param ud user dictionary object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param text UTF-8 text, not necessarily null terminated
+ * @param textlen size in bytes of the text
+ * @return 0 if successful or the phrase does not exist, 1 otherwise
+ */
+int zyp_userdict_remove(struct zyp_userdict *ud, const uint16_t *sylls,
+                        size_t len, const char *text, size_t textlen);
+
+/**
+ * @brief Get the number of phrases
+ *
+ * @param ud user dictionary object
+ * @return number of phrases
+ */
+size_t zyp_userdict_count(const struct zyp_userdict *ud);
+
+/**
+ * @brief Flush the log to the disk
+ * Changes are written to the file immediately, but they may stay in the
+ * page cache until this function is called.
+ *
+ * @param ud user dictionary object
+ * @return 0 if successful, 1 otherwise
+ */
+int zyp_userdict_sync(struct zyp_userdict *ud);
+
+/**
+ * @brief Rewrite the log with only the current phrases
+ * The changes never rewrite the log themselves, this should be called when
+ * the input method is idle and zyp_userdict_compact_pending() is true. The
+ * new log is written to a temporary file and then renamed, so a crash leaves
+ * either the old or the new log.
+ *
+ * @param ud user dictionary object
+ * @return 0 if successful, 1 otherwise
+ */
+int zyp_userdict_compact(struct zyp_userdict *ud);
+
+/**
+ * @brief Check if the log has grown enough to be compacted
+ *
+ * @param ud user dictionary object
+ * @return true if zyp_userdict_compact() should be called
+ */
+bool zyp_userdict_compact_pending(const struct zyp_userdict *ud);
+
+#endif
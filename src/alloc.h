@@ -0,0 +1,59 @@
+#ifndef _ZYP_ALLOC_H
+#define _ZYP_ALLOC_H
+/**
+ * @file
+ * Allocate through a struct zyp_allocator, or the standard functions when it
+ * is NULL
+ *
+ * The standard functions are called directly rather than through an
+ * allocator wrapping them, so the default case costs one branch.
+ */
+
+#include <zyphtine/alloc.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline void *zyp_alloc(const struct zyp_allocator *allocator,
+                              size_t size)
+{
+    if (!allocator) {
+        return malloc(size);
+    }
+    return allocator->allocate(allocator->user, size);
+}
+
+static inline void *zyp_calloc(const struct zyp_allocator *allocator,
+                               size_t size)
+{
+    if (!allocator) {
+        return calloc(1, size);
+    }
+    void *ptr = allocator->allocate(allocator->user, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+static inline void *zyp_realloc(const struct zyp_allocator *allocator,
+                                void *ptr, size_t old_size, size_t size)
+{
+    if (!allocator) {
+        return realloc(ptr, size);
+    }
+    return allocator->reallocate(allocator->user, ptr, old_size, size);
+}
+
+static inline void zyp_free(const struct zyp_allocator *allocator, void *ptr,
+                            size_t size)
+{
+    if (!allocator) {
+        free(ptr);
+        return;
+    }
+    allocator->deallocate(allocator->user, ptr, size);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "arena.h"
+#include "alloc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CHUNK_SIZE 4096
+
+struct zyp_arena_chunk {
+    struct zyp_arena_chunk *next;
+    size_t size;
+};
+
+/** Size of the chunk header, the data after it stays aligned */
+#define CHUNK_HEADER \
+    ((sizeof(struct zyp_arena_chunk) + ZYP_ARENA_ALIGN - 1) \
+     & ~(size_t)(ZYP_ARENA_ALIGN - 1))
+
+static inline char *chunk_data(struct zyp_arena_chunk *chunk)
+{
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+// Add a chunk of at least `size` bytes, and make it the current one
+static int arena_add_chunk(struct zyp_arena *arena, size_t size)
+{
+    // Double the arena, so it takes a few chunks to reach any size
+    if (size < arena->capacity) {
+        size = arena->capacity;
+    }
+    if (size < MIN_CHUNK_SIZE) {
+        size = MIN_CHUNK_SIZE;
+    }
+    if (size > SIZE_MAX - CHUNK_HEADER) {
+        return 1;
+    }
+    struct zyp_arena_chunk *chunk = zyp_alloc(arena->allocator,
+                                              CHUNK_HEADER + size);
+    if (!chunk) {
+        return 1;
+    }
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    arena->chunks = chunk;
+    arena->next = chunk_data(chunk);
+    arena->end = arena->next + size;
+    arena->last = NULL;
+    arena->capacity += size;
+    return 0;
+}
+
+void zyp_arena_init(struct zyp_arena *arena,
+                    const struct zyp_allocator *allocator)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->allocator = allocator;
+}
+
+void zyp_arena_release(struct zyp_arena *arena)
+{
+    struct zyp_arena_chunk *chunk = arena->chunks;
+    while (chunk) {
+        struct zyp_arena_chunk *next = chunk->next;
+        zyp_free(arena->allocator, chunk, CHUNK_HEADER + chunk->size);
+        chunk = next;
+    }
+    zyp_arena_init(arena, arena->allocator);
+}
+
+void zyp_arena_reset(struct zyp_arena *arena)
+{
+    struct zyp_arena_chunk *chunk = arena->chunks;
+    if (chunk && chunk->next) {
+        size_t capacity = arena->capacity;
+        zyp_arena_release(arena);
+        // Without the memory, the next allocation adds a chunk as it would
+        if (arena_add_chunk(arena, capacity)) {
+            return;
+        }
+        chunk = arena->chunks;
+    }
+    if (chunk) {
+        arena->next = chunk_data(chunk);
+        arena->last = NULL;
+    }
+}
+
+int zyp_arena_reserve(struct zyp_arena *arena, size_t size)
+{
+    if (size > SIZE_MAX - ZYP_ARENA_ALIGN) {
+        return 1;
+    }
+    size = (size + ZYP_ARENA_ALIGN - 1) & ~(size_t)(ZYP_ARENA_ALIGN - 1);
+    if (size <= (size_t)(arena->end - arena->next)) {
+        return 0;
+    }
+    return arena_add_chunk(arena, size);
+}
+
+void *zyp_arena_alloc(struct zyp_arena *arena, size_t size)
+{
+    if (size > SIZE_MAX - ZYP_ARENA_ALIGN) {
+        return NULL;
+    }
+    size = (size + ZYP_ARENA_ALIGN - 1) & ~(size_t)(ZYP_ARENA_ALIGN - 1);
+    if (size > (size_t)(arena->end - arena->next)
+        && arena_add_chunk(arena, size)) {
+        return NULL;
+    }
+    arena->last = arena->next;
+    arena->next += size;
+    return arena->last;
+}
+
+void *zyp_arena_grow(struct zyp_arena *arena, void *ptr, size_t old_size,
+                     size_t size)
+{
+    if (ptr && ptr == arena->last
+        && size <= (size_t)(arena->end - arena->last)) {
+        size_t aligned = (size + ZYP_ARENA_ALIGN - 1)
+                         & ~(size_t)(ZYP_ARENA_ALIGN - 1);
+        arena->next = arena->last + aligned;
+        return ptr;
+    }
+    void *p = zyp_arena_alloc(arena, size);
+    if (p && ptr && old_size) {
+        memcpy(p, ptr, old_size < size ? old_size : size);
+    }
+    return p;
+}
@@ -0,0 +1,102 @@
+#ifndef _ZYP_ARENA_H
+#define _ZYP_ARENA_H
+/**
+ * @file
+ * A bump allocator for the short-lived memory of a conversion
+ *
+ * Memory is taken from the end of the current chunk and is never freed one
+ * by one, the whole arena is reset at once instead. When a reset finds more
+ * than one chunk, they are replaced by a single chunk as large as all of
+ * them, so once the arena has seen the largest conversion, it does not call
+ * the system allocator any more.
+ */
+
+#include <zyphtine/alloc.h>
+
+#include <stddef.h>
+
+/** Alignment of every allocation */
+#define ZYP_ARENA_ALIGN 16
+
+struct zyp_arena_chunk;
+
+/**
+ * A bump allocator
+ * It is embedded in its owner and used with zyp_arena_*() functions.
+ */
+struct zyp_arena {
+    /** Chunks, the newest first */
+    struct zyp_arena_chunk *chunks;
+    /** Free space of the newest chunk is `next ... end` */
+    char *next;
+    char *end;
+    /** The last allocation, which can be grown in place */
+    char *last;
+    /** Total size of the chunks */
+    size_t capacity;
+    /** Allocator of the chunks, NULL for malloc() */
+    const struct zyp_allocator *allocator;
+};
+
+/**
+ * Initialize an empty arena, which allocates no memory until it is used
+ *
+ * @param arena arena object
+ * @param allocator allocator of the chunks, or NULL for malloc()
+ */
+void zyp_arena_init(struct zyp_arena *arena,
+                    const struct zyp_allocator *allocator);
+
+/**
+ * Free all the memory of the arena, keeping its allocator
+ *
+ * @param arena arena object
+ */
+void zyp_arena_release(struct zyp_arena *arena);
+
+/**
+ * Free all the allocations at once
+ * The memory is kept for the next allocations, and is merged into one
+ * chunk if the arena has grown.
+ *
+ * @param arena arena object
+ */
+void zyp_arena_reset(struct zyp_arena *arena);
+
+/**
+ * Make sure the next `size` bytes can be allocated without calling the
+ * system allocator
+ *
+ * @param arena arena object
+ * @param size size in bytes
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_arena_reserve(struct zyp_arena *arena, size_t size);
+
+/**
+ * Allocate memory aligned to ZYP_ARENA_ALIGN, which is valid until the
+ * arena is reset
+ *
+ * @param arena arena object
+ * @param size size in bytes
+ * @retval NULL fail to allocate memory
+ * @return allocated memory
+ */
+void *zyp_arena_alloc(struct zyp_arena *arena, size_t size);
+
+/**
+ * Grow an allocation, keeping its content
+ * The last allocation is grown in place when the chunk has room, otherwise
+ * the content is copied and the old memory is left until the reset.
+ *
+ * @param arena arena object
+ * @param ptr allocation to grow, can be NULL
+ * @param old_size size of the allocation
+ * @param size new size in bytes
+ * @retval NULL fail to allocate memory, `ptr` is still valid
+ * @return the grown allocation
+ */
+void *zyp_arena_grow(struct zyp_arena *arena, void *ptr, size_t old_size,
+                     size_t size);
+
+#endif
@@ -0,0 +1,223 @@
+#include "zyphtine.h"
+#include "alloc.h"
+
+#include <stdlib.h>
+
+static inline void ctx_touch(struct zyphtine_ctx *ctx, size_t pos)
+{
+    if (pos < ctx->dirty) {
+        ctx->dirty = pos;
+    }
+}
+
+// Drop the memory of the last conversion
+static inline void ctx_scratch_reset(struct zyphtine_ctx *ctx)
+{
+    zyp_converter_kbest_reset(&ctx->converter);
+    zyp_arena_reset(&ctx->arena);
+}
+
+// Stop following the shared dictionary, and drop its reference
+static void ctx_drop_shared(struct zyphtine_ctx *ctx)
+{
+    zyp_dict_close(ctx->shared_dict);
+    ctx->shared = NULL;
+    ctx->shared_dict = NULL;
+}
+
+// Move to the newest dictionary of the shared one
+static void ctx_sync_shared(struct zyphtine_ctx *ctx)
+{
+    if (!ctx->shared
+        || (ctx->shared_dict
+            && zyp_dict_shared_version(ctx->shared) == ctx->shared_version)) {
+        return;
+    }
+    struct zyp_dict *old = ctx->shared_dict;
+    ctx->shared_dict = zyp_dict_shared_get(ctx->shared,
+                                           &ctx->shared_version);
+    zyp_converter_set_dict(&ctx->converter, ctx->shared_dict);
+    zyp_arena_reset(&ctx->arena);
+    ctx->dirty = 0;
+    // The lattice pointing into the old dictionary is dropped
+    zyp_dict_close(old);
+}
+
+struct zyphtine_ctx *zyp_ctx_new(void)
+{
+    return zyp_ctx_new_with_allocator(NULL);
+}
+
+struct zyphtine_ctx *zyp_ctx_new_with_allocator(
+    const struct zyp_allocator *allocator)
+{
+    struct zyphtine_ctx *ctx = zyp_calloc(allocator, sizeof(*ctx));
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->allocator = allocator;
+    zyp_composer_init(&ctx->composer, ZYP_LAYOUT_STANDARD);
+    zyp_preedit_init(&ctx->preedit, allocator);
+    zyp_arena_init(&ctx->arena, allocator);
+    zyp_converter_init(&ctx->converter, &ctx->arena, allocator);
+    return ctx;
+}
+
+void zyp_ctx_free(struct zyphtine_ctx *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    zyp_converter_release(&ctx->converter);
+    zyp_arena_release(&ctx->arena);
+    zyp_preedit_release(&ctx->preedit);
+    ctx_drop_shared(ctx);
+    zyp_free(ctx->allocator, ctx, sizeof(*ctx));
+}
+
+void zyp_ctx_reset(struct zyphtine_ctx *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    zyp_composer_init(&ctx->composer, ZYP_LAYOUT_STANDARD);
+    zyp_preedit_clear(&ctx->preedit);
+    zyp_converter_clear(&ctx->converter);
+    zyp_arena_reset(&ctx->arena);
+    ctx->dirty = 0;
+    // An idle context should not keep an old shared dictionary alive, the
+    // current one is taken again by the next conversion
+    if (ctx->shared_dict) {
+        zyp_converter_set_dict(&ctx->converter, NULL);
+        zyp_dict_close(ctx->shared_dict);
+        ctx->shared_dict = NULL;
+    }
+}
+
+void zyp_ctx_set_dict(struct zyphtine_ctx *ctx, const struct zyp_dict *dict)
+{
+    if (!ctx) {
+        return;
+    }
+    zyp_converter_set_dict(&ctx->converter, dict);
+    zyp_arena_reset(&ctx->arena);
+    ctx->dirty = 0;
+    ctx_drop_shared(ctx);
+}
+
+void zyp_ctx_set_shared_dict(struct zyphtine_ctx *ctx,
+                             struct zyp_dict_shared *shared)
+{
+    if (!ctx) {
+        return;
+    }
+    struct zyp_dict *old = ctx->shared_dict;
+    ctx->shared = shared;
+    ctx->shared_dict = zyp_dict_shared_get(shared, &ctx->shared_version);
+    zyp_converter_set_dict(&ctx->converter, ctx->shared_dict);
+    zyp_arena_reset(&ctx->arena);
+    ctx->dirty = 0;
+    zyp_dict_close(old);
+}
+
+size_t zyp_ctx_preedit_length(const struct zyphtine_ctx *ctx)
+{
+    if (!ctx) {
+        return 0;
+    }
+    return zyp_preedit_length(&ctx->preedit);
+}
+
+int zyp_ctx_preedit_insert(struct zyphtine_ctx *ctx, size_t pos,
+                           const struct preedit_char *chars, size_t n)
+{
+    if (!ctx || (n && !chars)) {
+        return 1;
+    }
+    if (pos > zyp_preedit_length(&ctx->preedit)
+        || zyp_preedit_insert(&ctx->preedit, pos, chars, n)) {
+        return 1;
+    }
+    ctx_touch(ctx, pos);
+    return 0;
+}
+
+int zyp_ctx_preedit_remove(struct zyphtine_ctx *ctx, size_t pos, size_t n)
+{
+    if (!ctx) {
+        return 1;
+    }
+    size_t length = zyp_preedit_length(&ctx->preedit);
+    if (pos > length || n > length - pos) {
+        return 1;
+    }
+    ctx_touch(ctx, pos);
+    zyp_preedit_remove(&ctx->preedit, pos, n);
+    return 0;
+}
+
+int zyp_ctx_preedit_get(const struct zyphtine_ctx *ctx, size_t pos,
+                        struct preedit_char *out)
+{
+    if (!ctx || !out || pos >= zyp_preedit_length(&ctx->preedit)) {
+        return 1;
+    }
+    zyp_preedit_get(&ctx->preedit, pos, out);
+    return 0;
+}
+
+int zyp_ctx_preedit_set(struct zyphtine_ctx *ctx, size_t pos,
+                        const struct preedit_char *ch)
+{
+    if (!ctx || !ch || pos >= zyp_preedit_length(&ctx->preedit)) {
+        return 1;
+    }
+    zyp_preedit_set(&ctx->preedit, pos, ch);
+    ctx_touch(ctx, pos);
+    return 0;
+}
+
+int zyp_ctx_convert(struct zyphtine_ctx *ctx)
+{
+    if (!ctx) {
+        return 1;
+    }
+    ctx_sync_shared(ctx);
+    size_t length = zyp_preedit_length(&ctx->preedit);
+    if (ctx->dirty >= length && ctx->converter.length == length) {
+        return 0;
+    }
+    ctx_scratch_reset(ctx);
+    // The gap moves back to the caret with the next edit there
+    zyp_preedit_compact(&ctx->preedit);
+    if (zyp_converter_run(&ctx->converter, &ctx->preedit, ctx->dirty)) {
+        return 1;
+    }
+    ctx->dirty = length;
+    return 0;
+}
+
+int zyp_ctx_sentence_begin(struct zyphtine_ctx *ctx)
+{
+    if (zyp_ctx_convert(ctx)) {
+        return 1;
+    }
+    ctx_scratch_reset(ctx);
+    return 0;
+}
+
+bool zyp_ctx_sentence_next(struct zyphtine_ctx *ctx,
+                           struct preedit_char *chars)
+{
+    if (!ctx || !chars) {
+        return false;
+    }
+    size_t length = zyp_preedit_length(&ctx->preedit);
+    if (ctx->dirty < length || ctx->converter.length != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        zyp_preedit_get(&ctx->preedit, i, &chars[i]);
+    }
+    return zyp_converter_kbest_next(&ctx->converter, chars);
+}
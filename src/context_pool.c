@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "alloc.h"
+#include "spinlock.h"
+#include "zyphtine.h"
+
+#include <stdint.h>
+
+/** Charactors the buffers of a pooled context are allocated for */
+#define WARM_LENGTH 64
+/** Bytes of the arena allocated for a pooled context */
+#define WARM_ARENA_SIZE 32768
+
+struct zyp_ctx_pool {
+    uint32_t lock;
+    /** Idle contexts are `idle[0 ... count]` */
+    struct zyphtine_ctx **idle;
+    size_t count;
+    size_t capacity;
+    /** Allocator of the pool and its contexts, NULL for malloc() */
+    const struct zyp_allocator *allocator;
+};
+
+// Size in bytes of the idle array, which has room for one context at least
+static inline size_t pool_idle_size(size_t capacity)
+{
+    return (capacity ? capacity : 1) * sizeof(struct zyphtine_ctx *);
+}
+
+// Create a context with the buffers allocated
+static struct zyphtine_ctx *pool_new_ctx(const struct zyp_ctx_pool *pool)
+{
+    struct zyphtine_ctx *ctx = zyp_ctx_new_with_allocator(pool->allocator);
+    if (!ctx) {
+        return NULL;
+    }
+    if (zyp_preedit_reserve(&ctx->preedit, WARM_LENGTH)
+        || zyp_converter_reserve(&ctx->converter, WARM_LENGTH)
+        || zyp_arena_reserve(&ctx->arena, WARM_ARENA_SIZE)) {
+        zyp_ctx_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+struct zyp_ctx_pool *zyp_ctx_pool_new(size_t count)
+{
+    return zyp_ctx_pool_new_with_allocator(count, NULL);
+}
+
+struct zyp_ctx_pool *zyp_ctx_pool_new_with_allocator(
+    size_t count, const struct zyp_allocator *allocator)
+{
+    if (count > SIZE_MAX / sizeof(struct zyphtine_ctx *)) {
+        return NULL;
+    }
+    struct zyp_ctx_pool *pool = zyp_calloc(allocator, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->allocator = allocator;
+    pool->idle = zyp_alloc(allocator, pool_idle_size(count));
+    if (!pool->idle) {
+        zyp_free(allocator, pool, sizeof(*pool));
+        return NULL;
+    }
+    pool->capacity = count;
+    for (; pool->count < count; pool->count++) {
+        pool->idle[pool->count] = pool_new_ctx(pool);
+        if (!pool->idle[pool->count]) {
+            zyp_ctx_pool_free(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void zyp_ctx_pool_free(struct zyp_ctx_pool *pool)
+{
+    if (!pool) {
+        return;
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        zyp_ctx_free(pool->idle[i]);
+    }
+    const struct zyp_allocator *allocator = pool->allocator;
+    zyp_free(allocator, pool->idle, pool_idle_size(pool->capacity));
+    zyp_free(allocator, pool, sizeof(*pool));
+}
+
+struct zyphtine_ctx *zyp_ctx_pool_acquire(struct zyp_ctx_pool *pool)
+{
+    if (!pool) {
+        return NULL;
+    }
+    struct zyphtine_ctx *ctx = NULL;
+    zyp_spin_lock(&pool->lock);
+    if (pool->count) {
+        ctx = pool->idle[--pool->count];
+    }
+    zyp_spin_unlock(&pool->lock);
+    return ctx ? ctx : pool_new_ctx(pool);
+}
+
+void zyp_ctx_pool_release(struct zyp_ctx_pool *pool,
+                          struct zyphtine_ctx *ctx)
+{
+    if (!pool || !ctx) {
+        return;
+    }
+    zyp_ctx_reset(ctx);
+    zyp_spin_lock(&pool->lock);
+    if (pool->count < pool->capacity) {
+        pool->idle[pool->count++] = ctx;
+        ctx = NULL;
+    }
+    zyp_spin_unlock(&pool->lock);
+    zyp_ctx_free(ctx);
+}
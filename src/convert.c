@@ -0,0 +1,765 @@
+#include "convert.h"
+#include "alloc.h"
+#include "utf8.h"
+#include "utf8_view.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Score of a charactor not found as a phrase of the dictionary */
+#define FALLBACK_SCORE (-(32 << CONVERT_SCORE_SHIFT))
+#define INITIAL_NODES 256
+#define INITIAL_POSITIONS 64
+/** Nodes copied by a heap merge, more than the right spine of any heap */
+#define HEAP_MERGE_NODES 64
+/** Arrays grown together by converter_grow() */
+#define MAX_GROW_ARRAYS 3
+
+#define ARENA_RESERVE(arena, array, capacity, need) \
+    arena_reserve((arena), (void **)&(array), &(capacity), (need), \
+                  sizeof(*(array)))
+
+// Grow an array of the arena to hold `need` elements, by doubling
+static int arena_reserve(struct zyp_arena *arena, void **array,
+                         size_t *capacity, size_t need, size_t size)
+{
+    if (need <= *capacity) {
+        return 0;
+    }
+    size_t cap = *capacity ? *capacity : INITIAL_NODES;
+    while (cap < need) {
+        cap *= 2;
+    }
+    void *p = zyp_arena_grow(arena, *array, *capacity * size, cap * size);
+    if (!p) {
+        return 1;
+    }
+    *array = p;
+    *capacity = cap;
+    return 0;
+}
+
+/**
+ * Score of going from node `prev` to node `next`, added to the unigram score
+ * of `next`. It is the bigram score of the phrases, or 0 if the pair is not
+ * known and the phrases are taken as independent.
+ */
+static inline int32_t convert_transition(const struct zyp_converter *conv,
+                                         const struct convert_node *prev,
+                                         const struct convert_node *next)
+{
+    if (prev->phrase_id == CONVERT_NONE || next->phrase_id == CONVERT_NONE) {
+        return 0;
+    }
+    return zyp_dict_bigram(conv->dict, prev->phrase_id, next->phrase_id);
+}
+
+void zyp_converter_init(struct zyp_converter *conv, struct zyp_arena *arena,
+                        const struct zyp_allocator *allocator)
+{
+    memset(conv, 0, sizeof(*conv));
+    conv->arena = arena;
+    conv->allocator = allocator;
+}
+
+void zyp_converter_release(struct zyp_converter *conv)
+{
+    const struct zyp_allocator *allocator = conv->allocator;
+    zyp_free(allocator, conv->nodes,
+             conv->node_capacity * sizeof(*conv->nodes));
+    zyp_free(allocator, conv->end_nodes,
+             conv->node_capacity * sizeof(*conv->end_nodes));
+    zyp_free(allocator, conv->end_first,
+             conv->capacity * sizeof(*conv->end_first));
+    zyp_free(allocator, conv->start_first,
+             conv->capacity * sizeof(*conv->start_first));
+    zyp_free(allocator, conv->path, conv->capacity * sizeof(*conv->path));
+    zyp_converter_init(conv, conv->arena, allocator);
+}
+
+void zyp_converter_set_dict(struct zyp_converter *conv,
+                            const struct zyp_dict *dict)
+{
+    conv->dict = dict;
+    conv->length = 0;
+    zyp_converter_kbest_reset(conv);
+    conv->norm = dict_log2(zyp_dict_total_frequency(dict) + 1);
+}
+
+/**
+ * Grow `count` arrays of `old` elements to `capacity` elements, keeping
+ * their content. The new arrays are all allocated before any is replaced,
+ * so on failure the arrays and their capacity are left as they were.
+ */
+static int converter_grow(const struct zyp_allocator *allocator,
+                          void **const arrays[], const size_t sizes[],
+                          size_t count, size_t old, size_t capacity)
+{
+    void *grown[MAX_GROW_ARRAYS];
+    for (size_t i = 0; i < count; i++) {
+        grown[i] = zyp_alloc(allocator, capacity * sizes[i]);
+        if (!grown[i]) {
+            while (i--) {
+                zyp_free(allocator, grown[i], capacity * sizes[i]);
+            }
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (old) {
+            memcpy(grown[i], *arrays[i], old * sizes[i]);
+        }
+        zyp_free(allocator, *arrays[i], old * sizes[i]);
+        *arrays[i] = grown[i];
+    }
+    return 0;
+}
+
+// Make room for the arrays indexed by positions
+static int converter_reserve(struct zyp_converter *conv, size_t n)
+{
+    if (n + 2 > conv->capacity) {
+        size_t capacity = conv->capacity ? conv->capacity : INITIAL_POSITIONS;
+        while (capacity < n + 2) {
+            capacity *= 2;
+        }
+        void **const arrays[] = {
+            (void **)&conv->end_first,
+            (void **)&conv->start_first,
+            (void **)&conv->path,
+        };
+        const size_t sizes[] = {
+            sizeof(*conv->end_first),
+            sizeof(*conv->start_first),
+            sizeof(*conv->path),
+        };
+        if (converter_grow(conv->allocator, arrays, sizes, 3, conv->capacity,
+                           capacity)) {
+            return 1;
+        }
+        conv->capacity = capacity;
+    }
+    return 0;
+}
+
+// Make room for `need` nodes
+static int converter_reserve_nodes(struct zyp_converter *conv, size_t need)
+{
+    if (need <= conv->node_capacity) {
+        return 0;
+    }
+    size_t capacity = conv->node_capacity ? conv->node_capacity
+                                          : INITIAL_NODES;
+    while (capacity < need) {
+        capacity *= 2;
+    }
+    void **const arrays[] = {
+        (void **)&conv->nodes,
+        (void **)&conv->end_nodes,
+    };
+    const size_t sizes[] = {
+        sizeof(*conv->nodes),
+        sizeof(*conv->end_nodes),
+    };
+    if (converter_grow(conv->allocator, arrays, sizes, 2,
+                       conv->node_capacity, capacity)) {
+        return 1;
+    }
+    conv->node_capacity = capacity;
+    return 0;
+}
+
+int zyp_converter_reserve(struct zyp_converter *conv, size_t n)
+{
+    return converter_reserve(conv, n)
+           || converter_reserve_nodes(conv, n * CONVERT_MAX_CANDIDATES);
+}
+
+void zyp_converter_clear(struct zyp_converter *conv)
+{
+    zyp_converter_kbest_reset(conv);
+    conv->length = 0;
+    conv->node_count = 0;
+    conv->path_length = 0;
+}
+
+static struct convert_node *converter_add_node(struct zyp_converter *conv)
+{
+    if (converter_reserve_nodes(conv, conv->node_count + 1)) {
+        return NULL;
+    }
+    struct convert_node *node = &conv->nodes[conv->node_count++];
+    node->best = 0;
+    node->back = CONVERT_NONE;
+    node->on_path = false;
+    return node;
+}
+
+// Check that the text has one charactor for each position of the span, and
+// agrees with the charactors selected by user
+static int phrase_fits(struct utf8_view text, const uint32_t *chars,
+                       const uint8_t *flags, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint32_t cp;
+        if (!utf8_view_next(&text, &cp) || !cp) {
+            return 0;
+        }
+        if ((flags[i] & PREEDIT_USER_SELECTED) && chars[i] != cp) {
+            return 0;
+        }
+    }
+    return utf8_view_is_empty(text);
+}
+
+// Add the nodes starting at `pos`, return 1 if fail to allocate memory
+static int converter_add_span_nodes(struct zyp_converter *conv,
+                                    const struct zyp_preedit *p, size_t pos,
+                                    size_t len)
+{
+    int has_single = 0;
+
+    if (len && conv->dict) {
+        struct zyp_dict_match matches[CONVERT_MAX_PHRASE_LENGTH];
+        size_t count = zyp_dict_prefix_search(conv->dict, p->sylls + pos,
+                                              len, matches,
+                                              CONVERT_MAX_PHRASE_LENGTH);
+        for (size_t m = 0; m < count; m++) {
+            size_t kept = 0;
+            for (size_t k = 0; k < matches[m].count
+                               && kept < CONVERT_MAX_CANDIDATES; k++) {
+                const struct zyp_dict_phrase *phrase = &matches[m].phrases[k];
+                const char *text = zyp_dict_phrase_text(conv->dict, phrase);
+                if (!text
+                    || !phrase_fits(utf8_view_make(text, phrase->text_length),
+                                    p->chars + pos, p->flags + pos,
+                                    matches[m].length)) {
+                    continue;
+                }
+                struct convert_node *node = converter_add_node(conv);
+                if (!node) {
+                    return 1;
+                }
+                node->text = text;
+                node->ch = 0;
+                node->start = (uint32_t)pos;
+                node->len = (uint32_t)matches[m].length;
+                node->phrase_id = zyp_dict_phrase_id(conv->dict, phrase);
+                node->score = dict_log2((uint64_t)phrase->frequency + 1)
+                              - conv->norm;
+                kept++;
+            }
+            if (matches[m].length == 1 && kept) {
+                has_single = 1;
+            }
+        }
+    }
+
+    // Every position has a single charactor node, so a path always exists
+    if (!has_single) {
+        struct convert_node *node = converter_add_node(conv);
+        if (!node) {
+            return 1;
+        }
+        uint16_t syll = p->sylls[pos];
+        uint32_t c = p->chars[pos];
+        if (syll && !(p->flags[pos] & PREEDIT_USER_SELECTED) && conv->dict) {
+            zyp_dict_chars(conv->dict, syll, &c, 1);
+        }
+        node->text = NULL;
+        node->ch = c;
+        node->start = (uint32_t)pos;
+        node->len = 1;
+        node->phrase_id = CONVERT_NONE;
+        node->score = syll ? FALLBACK_SCORE : 0;
+    }
+    return 0;
+}
+
+// Sort the nodes ending after `from` by their end positions with a counting
+// sort, the nodes ending before are kept in their places
+static void converter_index_ends(struct zyp_converter *conv, size_t from,
+                                 size_t n)
+{
+    uint32_t *first = conv->end_first;
+    uint32_t base = 0;
+    if (from) {
+        base = first[from + 1];
+    } else {
+        first[0] = 0;
+    }
+    memset(first + from + 1, 0, (n + 1 - from) * sizeof(*first));
+
+    // A node starting before `from - CONVERT_MAX_PHRASE_LENGTH + 1` ends
+    // before `from`
+    size_t lo = from + 1 > CONVERT_MAX_PHRASE_LENGTH
+                ? conv->start_first[from + 1 - CONVERT_MAX_PHRASE_LENGTH] : 0;
+    for (size_t i = lo; i < conv->node_count; i++) {
+        const struct convert_node *node = &conv->nodes[i];
+        if (node->start + node->len > from) {
+            first[node->start + node->len]++;
+        }
+    }
+    uint32_t sum = base;
+    for (size_t i = from + 1; i <= n + 1; i++) {
+        sum += first[i];
+        first[i] = sum;
+    }
+    // Fill backward, so `first[i]` ends up at the first node ending at `i`,
+    // and the nodes ending at `i` keep their order
+    for (size_t i = conv->node_count; i-- > lo;) {
+        const struct convert_node *node = &conv->nodes[i];
+        if (node->start + node->len > from) {
+            conv->end_nodes[--first[node->start + node->len]] = (uint32_t)i;
+        }
+    }
+}
+
+static void converter_viterbi(struct zyp_converter *conv, size_t from)
+{
+    for (size_t i = from; i < conv->node_count; i++) {
+        struct convert_node *node = &conv->nodes[i];
+        if (node->start == 0) {
+            node->best = node->score;
+            continue;
+        }
+        const uint32_t *prev = conv->end_nodes + conv->end_first[node->start];
+        const uint32_t *last = conv->end_nodes
+                               + conv->end_first[node->start + 1];
+        for (; prev < last; prev++) {
+            const struct convert_node *p = &conv->nodes[*prev];
+            int32_t best = p->best + convert_transition(conv, p, node)
+                           + node->score;
+            if (node->back == CONVERT_NONE || best > node->best) {
+                node->best = best;
+                node->back = *prev;
+            }
+        }
+    }
+}
+
+static void node_fill(const struct convert_node *node, struct zyp_preedit *p)
+{
+    uint32_t *chars = p->chars + node->start;
+    uint8_t *flags = p->flags + node->start;
+    if (node->text) {
+        const char *text = node->text;
+        for (uint32_t k = 0; k < node->len; k++) {
+            size_t size;
+            chars[k] = utf8_decode(text, &size);
+            flags[k] &= (uint8_t)~PREEDIT_SEG_POINT;
+            text += size;
+        }
+    } else {
+        chars[0] = node->ch;
+    }
+    flags[0] |= PREEDIT_SEG_POINT;
+}
+
+// Fill a sentence of the k-best enumeration, like node_fill()
+static void node_fill_sentence(const struct convert_node *node,
+                               struct preedit_char *chars)
+{
+    struct preedit_char *ch = &chars[node->start];
+    if (node->text) {
+        const char *text = node->text;
+        for (uint32_t k = 0; k < node->len; k++) {
+            size_t size;
+            ch[k].selected_char = utf8_decode(text, &size);
+            ch[k].seg_point = 0;
+            text += size;
+        }
+    } else {
+        ch->selected_char = node->ch;
+    }
+    ch->seg_point = 1;
+}
+
+// Follow the best path backward until it joins the last path, and replace
+// the rest of the last path with it
+static void converter_fill(struct zyp_converter *conv, struct zyp_preedit *p,
+                           size_t n)
+{
+    uint32_t best = CONVERT_NONE;
+    const uint32_t *last = conv->end_nodes + conv->end_first[n + 1];
+    for (const uint32_t *i = conv->end_nodes + conv->end_first[n]; i < last;
+         i++) {
+        if (best == CONVERT_NONE
+            || conv->nodes[*i].best > conv->nodes[best].best) {
+            best = *i;
+        }
+    }
+
+    size_t count = 0;
+    uint32_t join = best;
+    while (join != CONVERT_NONE && !conv->nodes[join].on_path) {
+        join = conv->nodes[join].back;
+        count++;
+    }
+    while (conv->path_length
+           && conv->path[conv->path_length - 1] != join) {
+        conv->nodes[conv->path[--conv->path_length]].on_path = false;
+    }
+
+    conv->path_length += count;
+    for (size_t i = conv->path_length; best != join; i--) {
+        struct convert_node *node = &conv->nodes[best];
+        node->on_path = true;
+        conv->path[i - 1] = best;
+        node_fill(node, p);
+        best = node->back;
+    }
+}
+
+int zyp_converter_run(struct zyp_converter *conv, struct zyp_preedit *p,
+                      size_t dirty)
+{
+    const size_t n = zyp_preedit_length(p);
+    zyp_converter_kbest_reset(conv);
+    if (dirty > conv->length) {
+        dirty = conv->length;
+    }
+    if (dirty > n) {
+        dirty = n;
+    }
+    if (!n) {
+        zyp_converter_clear(conv);
+        return 0;
+    }
+    if (converter_reserve(conv, n)) {
+        return 1;
+    }
+
+    // Drop the nodes which may depend on the changed charactors
+    size_t from = dirty + 1 > CONVERT_MAX_PHRASE_LENGTH
+                  ? dirty + 1 - CONVERT_MAX_PHRASE_LENGTH : 0;
+    size_t keep = from ? conv->start_first[from] : 0;
+    while (conv->path_length
+           && conv->path[conv->path_length - 1] >= keep) {
+        conv->path_length--;
+    }
+    conv->node_count = keep;
+    conv->length = 0;
+
+    size_t run_end = from;
+    for (size_t i = from; i < n; i++) {
+        // Phrases do not span the charactors without a syllable
+        if (run_end <= i) {
+            run_end = i;
+            while (run_end < n && p->sylls[run_end]) {
+                run_end++;
+            }
+        }
+        size_t len = run_end - i;
+        if (len > CONVERT_MAX_PHRASE_LENGTH) {
+            len = CONVERT_MAX_PHRASE_LENGTH;
+        }
+        conv->start_first[i] = (uint32_t)conv->node_count;
+        if (converter_add_span_nodes(conv, p, i, len)) {
+            return 1;
+        }
+    }
+    conv->start_first[n] = (uint32_t)conv->node_count;
+
+    converter_index_ends(conv, from, n);
+    converter_viterbi(conv, keep);
+    converter_fill(conv, p, n);
+    conv->length = n;
+    return 0;
+}
+
+void zyp_converter_kbest_reset(struct zyp_converter *conv)
+{
+    memset(&conv->kbest, 0, sizeof(conv->kbest));
+}
+
+static int sidetrack_compare(const void *a, const void *b)
+{
+    const struct convert_sidetrack *x = (const struct convert_sidetrack *)a;
+    const struct convert_sidetrack *y = (const struct convert_sidetrack *)b;
+    if (x->delta != y->delta) {
+        return x->delta < y->delta ? -1 : 1;
+    }
+    return (x->prev > y->prev) - (x->prev < y->prev);
+}
+
+static inline uint32_t heap_rank(const struct convert_kbest *kb, uint32_t h)
+{
+    return h == CONVERT_NONE ? 0 : kb->heap[h].rank;
+}
+
+// Merge heap `b` into heap `a`. The nodes on the merge path are copied, so
+// `a` is left unchanged and shares the rest of its nodes with the result.
+// The caller reserves HEAP_MERGE_NODES nodes.
+static uint32_t heap_merge(struct convert_kbest *kb, uint32_t a, uint32_t b)
+{
+    if (a == CONVERT_NONE) {
+        return b;
+    }
+    if (b == CONVERT_NONE) {
+        return a;
+    }
+    if (kb->heap[b].key < kb->heap[a].key) {
+        uint32_t t = a;
+        a = b;
+        b = t;
+    }
+    uint32_t copy = (uint32_t)kb->heap_count++;
+    kb->heap[copy] = kb->heap[a];
+    uint32_t right = heap_merge(kb, kb->heap[a].right, b);
+
+    struct convert_heap_node *node = &kb->heap[copy];
+    node->right = right;
+    if (heap_rank(kb, node->left) < heap_rank(kb, right)) {
+        node->right = node->left;
+        node->left = right;
+    }
+    node->rank = heap_rank(kb, node->right) + 1;
+    return copy;
+}
+
+// Collect the sidetracks of every node and the end, and build their heaps
+static int kbest_build(struct zyp_converter *conv)
+{
+    struct convert_kbest *kb = &conv->kbest;
+    struct zyp_arena *arena = conv->arena;
+    const size_t end = conv->node_count;
+    const uint32_t best_end = conv->path[conv->path_length - 1];
+    if (ARENA_RESERVE(arena, kb->side_first, kb->side_first_capacity,
+                      end + 2)
+        || ARENA_RESERVE(arena, kb->roots, kb->root_capacity, end + 1)) {
+        return 1;
+    }
+
+    size_t count = 0;
+    for (size_t v = 0; v <= end; v++) {
+        kb->side_first[v] = (uint32_t)count;
+        const struct convert_node *node = NULL;
+        size_t pos = conv->length;
+        uint32_t back = best_end;
+        int32_t best = conv->nodes[best_end].best;
+        if (v < end) {
+            node = &conv->nodes[v];
+            pos = node->start;
+            back = node->back;
+            best = node->best;
+        }
+        if (!pos) {
+            continue;
+        }
+
+        const uint32_t *prev = conv->end_nodes + conv->end_first[pos];
+        const uint32_t *last = conv->end_nodes + conv->end_first[pos + 1];
+        if (ARENA_RESERVE(arena, kb->sides, kb->side_capacity,
+                          count + (size_t)(last - prev))) {
+            return 1;
+        }
+        for (; prev < last; prev++) {
+            if (*prev == back) {
+                continue;
+            }
+            const struct convert_node *p = &conv->nodes[*prev];
+            int32_t score = p->best;
+            if (node) {
+                score += convert_transition(conv, p, node) + node->score;
+            }
+            kb->sides[count].prev = *prev;
+            kb->sides[count].delta = best - score;
+            count++;
+        }
+        qsort(kb->sides + kb->side_first[v], count - kb->side_first[v],
+              sizeof(kb->sides[0]), sidetrack_compare);
+    }
+    kb->side_first[end + 1] = (uint32_t)count;
+
+    // The heap of a node is the heap of its previous node on the best path,
+    // with its own smallest sidetrack inserted
+    kb->heap_count = 0;
+    for (size_t v = 0; v <= end; v++) {
+        uint32_t back = v < end ? conv->nodes[v].back : best_end;
+        uint32_t root = back == CONVERT_NONE ? CONVERT_NONE : kb->roots[back];
+        if (kb->side_first[v + 1] > kb->side_first[v]) {
+            if (ARENA_RESERVE(arena, kb->heap, kb->heap_capacity,
+                              kb->heap_count + HEAP_MERGE_NODES + 1)) {
+                return 1;
+            }
+            uint32_t single = (uint32_t)kb->heap_count++;
+            kb->heap[single].node = (uint32_t)v;
+            kb->heap[single].key = kb->sides[kb->side_first[v]].delta;
+            kb->heap[single].left = CONVERT_NONE;
+            kb->heap[single].right = CONVERT_NONE;
+            kb->heap[single].rank = 1;
+            root = heap_merge(kb, root, single);
+        }
+        kb->roots[v] = root;
+    }
+    return 0;
+}
+
+// Push a candidate, the caller reserves room for it
+static void kbest_push(struct convert_kbest *kb, uint32_t prev, uint32_t node,
+                       uint32_t rank, uint32_t heap, int32_t deficit)
+{
+    uint32_t c = (uint32_t)kb->cand_count++;
+    kb->cands[c].prev = prev;
+    kb->cands[c].node = node;
+    kb->cands[c].rank = rank;
+    kb->cands[c].heap = heap;
+    kb->cands[c].deficit = deficit;
+
+    size_t i = kb->queue_count++;
+    while (i) {
+        size_t parent = (i - 1) / 2;
+        if (kb->cands[kb->queue[parent]].deficit <= deficit) {
+            break;
+        }
+        kb->queue[i] = kb->queue[parent];
+        i = parent;
+    }
+    kb->queue[i] = c;
+}
+
+static uint32_t kbest_pop(struct convert_kbest *kb)
+{
+    uint32_t top = kb->queue[0];
+    uint32_t moved = kb->queue[--kb->queue_count];
+    int32_t deficit = kb->cands[moved].deficit;
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= kb->queue_count) {
+            break;
+        }
+        if (child + 1 < kb->queue_count
+            && kb->cands[kb->queue[child + 1]].deficit
+               < kb->cands[kb->queue[child]].deficit) {
+            child++;
+        }
+        if (kb->cands[kb->queue[child]].deficit >= deficit) {
+            break;
+        }
+        kb->queue[i] = kb->queue[child];
+        i = child;
+    }
+    kb->queue[i] = moved;
+    return top;
+}
+
+// Push the successors of candidate `c`: the next sidetracks in the heap
+// it was taken from, and the smallest sidetrack behind it
+static void kbest_expand(struct zyp_converter *conv, uint32_t c)
+{
+    struct convert_kbest *kb = &conv->kbest;
+    const struct convert_candidate cand = kb->cands[c];
+    const int32_t base = cand.prev == CONVERT_NONE
+                         ? 0 : kb->cands[cand.prev].deficit;
+    const uint32_t first = kb->side_first[cand.node];
+
+    if (cand.rank == 0) {
+        const uint32_t children[] = {
+            kb->heap[cand.heap].left, kb->heap[cand.heap].right,
+        };
+        for (size_t i = 0; i < 2; i++) {
+            uint32_t h = children[i];
+            if (h != CONVERT_NONE) {
+                kbest_push(kb, cand.prev, kb->heap[h].node, 0, h,
+                           base + kb->heap[h].key);
+            }
+        }
+    }
+    if (first + cand.rank + 1 < kb->side_first[cand.node + 1]) {
+        kbest_push(kb, cand.prev, cand.node, cand.rank + 1, CONVERT_NONE,
+                   base + kb->sides[first + cand.rank + 1].delta);
+    }
+    uint32_t root = kb->roots[kb->sides[first + cand.rank].prev];
+    if (root != CONVERT_NONE) {
+        kbest_push(kb, c, kb->heap[root].node, 0, root,
+                   cand.deficit + kb->heap[root].key);
+    }
+}
+
+// Write the sentence of candidate `c`, walking back from the end and taking
+// its sidetracks on the way
+static void kbest_write(struct zyp_converter *conv, uint32_t c,
+                        struct preedit_char *chars)
+{
+    struct convert_kbest *kb = &conv->kbest;
+    size_t count = 0;
+    for (; c != CONVERT_NONE; c = kb->cands[c].prev) {
+        kb->walk[count++] = c;
+    }
+
+    const uint32_t end = (uint32_t)conv->node_count;
+    uint32_t v = end;
+    for (;;) {
+        uint32_t next;
+        const struct convert_candidate *side = count
+                                               ? &kb->cands[kb->walk[count - 1]]
+                                               : NULL;
+        if (side && side->node == v) {
+            next = kb->sides[kb->side_first[v] + side->rank].prev;
+            count--;
+        } else {
+            next = v == end ? conv->path[conv->path_length - 1]
+                            : conv->nodes[v].back;
+        }
+        if (next == CONVERT_NONE) {
+            break;
+        }
+        node_fill_sentence(&conv->nodes[next], chars);
+        v = next;
+    }
+}
+
+bool zyp_converter_kbest_next(struct zyp_converter *conv,
+                              struct preedit_char *chars)
+{
+    struct convert_kbest *kb = &conv->kbest;
+    struct zyp_arena *arena = conv->arena;
+    if (!conv->length) {
+        return false;
+    }
+    if (kb->count == 0) {
+        for (size_t i = 0; i < conv->path_length; i++) {
+            node_fill_sentence(&conv->nodes[conv->path[i]], chars);
+        }
+        kb->count = 1;
+        return true;
+    }
+
+    if (!kb->ready) {
+        if (kbest_build(conv)
+            || ARENA_RESERVE(arena, kb->walk, kb->walk_capacity,
+                             conv->length)) {
+            return false;
+        }
+        kb->cand_count = 0;
+        kb->queue_count = 0;
+        kb->ready = true;
+        uint32_t root = kb->roots[conv->node_count];
+        if (root != CONVERT_NONE) {
+            if (ARENA_RESERVE(arena, kb->cands, kb->cand_capacity, 1)
+                || ARENA_RESERVE(arena, kb->queue, kb->queue_capacity, 1)) {
+                kb->ready = false;
+                return false;
+            }
+            kbest_push(kb, CONVERT_NONE, kb->heap[root].node, 0, root,
+                       kb->heap[root].key);
+        }
+    }
+    if (!kb->queue_count) {
+        return false;
+    }
+    // Reserve for the successors first, so no candidate is lost on failure
+    if (ARENA_RESERVE(arena, kb->cands, kb->cand_capacity,
+                      kb->cand_count + 4)
+        || ARENA_RESERVE(arena, kb->queue, kb->queue_capacity,
+                         kb->queue_count + 4)) {
+        return false;
+    }
+    uint32_t c = kbest_pop(kb);
+    kbest_expand(conv, c);
+    kbest_write(conv, c, chars);
+    kb->count++;
+    return true;
+}
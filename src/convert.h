@@ -0,0 +1,255 @@
+#ifndef _ZYP_CONVERT_H
+#define _ZYP_CONVERT_H
+/**
+ * @file
+ * Convert a syllable sequence into phrases, by finding the best path of a
+ * lattice with the Viterbi algorithm
+ */
+
+#include <zyphtine/alloc.h>
+#include <zyphtine/context.h>
+#include <zyphtine/dict.h>
+#include "arena.h"
+#include "dict_bigram.h"
+#include "preedit.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The longest phrase in syllables considered by the conversion */
+#define CONVERT_MAX_PHRASE_LENGTH 16
+/** The number of the most frequent phrases kept for each span */
+#define CONVERT_MAX_CANDIDATES 6
+/** Mark of a missing node, or a node without a dictionary phrase */
+#define CONVERT_NONE UINT32_MAX
+/** Scores are base 2 logarithms in fixed point with this many fraction bits */
+#define CONVERT_SCORE_SHIFT DICT_SCORE_SHIFT
+
+/**
+ * A node of the lattice, which is a phrase candidate covering a span of the
+ * preedit buffer
+ */
+struct convert_node {
+    /** Text of the phrase, or NULL for a single charactor `ch` */
+    const char *text;
+    uint32_t ch;
+    uint32_t start;
+    uint32_t len;
+    /** Identifier of the dictionary phrase, or CONVERT_NONE */
+    uint32_t phrase_id;
+    /** Log probability of the phrase, see CONVERT_SCORE_SHIFT */
+    int32_t score;
+    /** Score of the best path ending with this node */
+    int32_t best;
+    /** The previous node of the best path, or CONVERT_NONE */
+    uint32_t back;
+    /** The node is on the path chosen by the last conversion */
+    bool on_path;
+};
+
+/**
+ * A sidetrack is a previous node other than the one on the best path to a
+ * node, `delta` is how much lower the score of going through it is.
+ */
+struct convert_sidetrack {
+    uint32_t prev;
+    int32_t delta;
+};
+
+/**
+ * A node of the persistent leftist heaps, ordered by the smallest sidetrack
+ * `key` of lattice node `node`
+ */
+struct convert_heap_node {
+    uint32_t node;
+    int32_t key;
+    uint32_t left;
+    uint32_t right;
+    uint32_t rank;
+};
+
+/**
+ * A sentence in the k-best enumeration, which is the sentence `prev` with
+ * one more sidetrack, the `rank`-th sidetrack of lattice node `node`.
+ * `heap` is the heap node holding the sidetrack when `rank` is 0.
+ */
+struct convert_candidate {
+    uint32_t prev;
+    uint32_t node;
+    uint32_t rank;
+    uint32_t heap;
+    /** Sum of the deltas of the sidetracks */
+    int32_t deficit;
+};
+
+/**
+ * State of the k-best enumeration, with Eppstein's algorithm.
+ * The arrays are allocated from the arena of the converter, and are dropped
+ * with the enumeration.
+ * A sentence is the best path with a sequence of sidetracks. The sidetracks
+ * which can be taken walking back from a node are kept in a heap, which
+ * shares its nodes with the heap of the previous node on the best path.
+ * The sentences form a heap too, each having at most 4 successors with a
+ * larger deficit, so each sentence after the first costs `O(log k)`.
+ */
+struct convert_kbest {
+    /** Number of sentences enumerated */
+    size_t count;
+    /** The heaps are built */
+    bool ready;
+
+    /** Sidetracks of each node sorted by `delta`, the last node is the end */
+    struct convert_sidetrack *sides;
+    size_t side_capacity;
+    uint32_t *side_first;
+    size_t side_first_capacity;
+    /** Root of the heap of each node, or CONVERT_NONE */
+    uint32_t *roots;
+    size_t root_capacity;
+    struct convert_heap_node *heap;
+    size_t heap_count;
+    size_t heap_capacity;
+
+    struct convert_candidate *cands;
+    size_t cand_count;
+    size_t cand_capacity;
+    /** Binary heap of candidates ordered by `deficit` */
+    uint32_t *queue;
+    size_t queue_count;
+    size_t queue_capacity;
+    /** Sidetracks of the sentence being written */
+    uint32_t *walk;
+    size_t walk_capacity;
+};
+
+/**
+ * The converter keeps its working memory between conversions, so it does
+ * not allocate memory once the buffers are large enough. The memory of the
+ * k-best enumeration lives only until the next conversion, and is taken from
+ * an arena which the owner resets after zyp_converter_kbest_reset().
+ *
+ * The lattice and the scores of the last conversion are kept too. The nodes
+ * starting at a position depend only on the next CONVERT_MAX_PHRASE_LENGTH
+ * charactors, and the best path to a node depends only on the nodes before
+ * it. So after a change at position `d`, the nodes starting before
+ * `d - CONVERT_MAX_PHRASE_LENGTH + 1` are reused as they are, and the new
+ * path is written until it joins the last path.
+ */
+struct zyp_converter {
+    const struct zyp_dict *dict;
+    /** Arena of the k-best enumeration, owned by the caller */
+    struct zyp_arena *arena;
+    /** Allocator of the other arrays, NULL for malloc() */
+    const struct zyp_allocator *allocator;
+    /** Log2 of the total frequency of the dictionary */
+    int32_t norm;
+    /** Number of charactors of the last conversion */
+    size_t length;
+
+    /** Nodes sorted by their start positions */
+    struct convert_node *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    /** Index of the first node starting at each position */
+    uint32_t *start_first;
+    /**
+     * Nodes ending before position `i` are
+     * `end_nodes[end_first[i] ... end_first[i + 1]]`
+     */
+    uint32_t *end_nodes;
+    uint32_t *end_first;
+    /** Nodes of the path chosen by the last conversion, in order */
+    uint32_t *path;
+    size_t path_length;
+
+    struct convert_kbest kbest;
+    /** Capacity of the arrays indexed by positions */
+    size_t capacity;
+};
+
+/**
+ * Initialize an empty converter
+ *
+ * @param conv converter object
+ * @param arena arena for the k-best enumeration, which should outlive the
+ * converter
+ * @param allocator allocator of the other arrays, or NULL for malloc()
+ */
+void zyp_converter_init(struct zyp_converter *conv, struct zyp_arena *arena,
+                        const struct zyp_allocator *allocator);
+
+/**
+ * Free the working memory of the converter
+ *
+ * @param conv converter object
+ */
+void zyp_converter_release(struct zyp_converter *conv);
+
+/**
+ * Set the dictionary used by the converter
+ *
+ * @param conv converter object
+ * @param dict dictionary object, can be NULL
+ */
+void zyp_converter_set_dict(struct zyp_converter *conv,
+                            const struct zyp_dict *dict);
+
+/**
+ * Make room for converting `n` charactors, so the conversions up to that
+ * length allocate little memory
+ *
+ * @param conv converter object
+ * @param n number of charactors
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_converter_reserve(struct zyp_converter *conv, size_t n);
+
+/**
+ * Drop the lattice of the last conversion, keeping the memory and the
+ * dictionary
+ *
+ * @param conv converter object
+ */
+void zyp_converter_clear(struct zyp_converter *conv);
+
+/**
+ * Convert the preedit buffer, and fill the selected charactors and the
+ * PREEDIT_SEG_POINT flags
+ * Only the charactors from `dirty` may have changed since the last
+ * conversion, the charactors before it are neither read nor written unless
+ * the path through them changes.
+ * @see zyp_ctx_convert()
+ *
+ * @param conv converter object
+ * @param p preedit buffer, compacted by zyp_preedit_compact()
+ * @param dirty position of the first charactor changed since the last
+ * conversion
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_converter_run(struct zyp_converter *conv, struct zyp_preedit *p,
+                      size_t dirty);
+
+/**
+ * Restart the enumeration of the sentences
+ * The memory of the enumeration is dropped, after this the arena can be
+ * reset. zyp_converter_run() and zyp_converter_set_dict() restart it too.
+ *
+ * @param conv converter object
+ */
+void zyp_converter_kbest_reset(struct zyp_converter *conv);
+
+/**
+ * Get the next sentence of the last conversion in the order of score
+ * The first sentence is the best path, found by the conversion.
+ * @see zyp_ctx_sentence_next()
+ *
+ * @param conv converter object
+ * @param chars preedit charactors to fill `selected_char` and `seg_point`
+ * @return true if a sentence is written, false if there are no more
+ * sentences or fail to allocate memory
+ */
+bool zyp_converter_kbest_next(struct zyp_converter *conv,
+                              struct preedit_char *chars);
+
+#endif
@@ -0,0 +1,43 @@
+#include "cpu.h"
+
+static unsigned features_allowed = ~0u;
+static unsigned features_detected;
+static int detected;
+
+static unsigned cpu_detect(void)
+{
+    unsigned features = 0;
+#if ZYP_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        features |= ZYP_CPU_SSE2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        features |= ZYP_CPU_SSSE3;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        features |= ZYP_CPU_SSE41;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        features |= ZYP_CPU_AVX2;
+    }
+#endif
+    return features;
+}
+
+unsigned zyp_cpu_features(void)
+{
+    // Racing threads detect and store the same value. The release store of
+    // `detected` publishes the features to the acquire load of other threads
+    if (!__atomic_load_n(&detected, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&features_detected, cpu_detect(), __ATOMIC_RELAXED);
+        __atomic_store_n(&detected, 1, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&features_detected, __ATOMIC_RELAXED)
+           & __atomic_load_n(&features_allowed, __ATOMIC_RELAXED);
+}
+
+void zyp_cpu_restrict(unsigned mask)
+{
+    __atomic_store_n(&features_allowed, mask, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,38 @@
+#ifndef _ZYP_CPU_H
+#define _ZYP_CPU_H
+/**
+ * @file
+ * Runtime detection of CPU features, for choosing SIMD kernels
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+/** The compiler can build x86 SIMD kernels with target attributes */
+#define ZYP_HAVE_X86_SIMD 1
+#define ZYP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ZYP_HAVE_X86_SIMD 0
+#endif
+
+#define ZYP_CPU_SSE2    (1u << 0)   ///< SSE2
+#define ZYP_CPU_SSSE3   (1u << 1)   ///< SSSE3
+#define ZYP_CPU_SSE41   (1u << 2)   ///< SSE4.1
+#define ZYP_CPU_AVX2    (1u << 3)   ///< AVX2
+
+/**
+ * Get the SIMD features usable on the running CPU
+ * The result is detected once and cached.
+ *
+ * @return bitwise OR of `ZYP_CPU_*` flags
+ */
+unsigned zyp_cpu_features(void);
+
+/**
+ * Restrict the features reported by zyp_cpu_features()
+ * This is used to exercise and compare the fallback kernels.
+ *
+ * @param mask features allowed to be used
+ */
+void zyp_cpu_restrict(unsigned mask);
+
+#endif
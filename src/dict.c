@@ -0,0 +1,467 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_bigram.h"
+#include "dict_format.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Here are the hidden structure definition
+struct zyp_dict {
+    const unsigned char *base;
+    size_t size;
+    /** The image is mapped by zyp_dict_open(), and should be unmapped */
+    bool mapped;
+    /** References taken by the opening and zyp_dict_ref() */
+    uint32_t refs;
+
+    const struct dict_key *keys;
+    size_t key_count;
+    const uint16_t *sylls;
+    size_t syll_count;
+    const struct zyp_dict_phrase *phrases;
+    size_t phrase_count;
+    const char *text;
+    size_t text_size;
+    /** The trie is optional, binary search the keys without it */
+    const struct dict_trie_node *trie;
+    size_t trie_size;
+    /** The charactor table is optional too, see DICT_TAG_CHAR */
+    const uint32_t *char_offsets;
+    const uint32_t *chars;
+    const uint32_t *char_freqs;
+    /** Optional, computed from the phrases without it */
+    const struct dict_stats *stats;
+    /** Optional, the phrases are independent without it */
+    struct dict_bigram bigram;
+    bool has_bigram;
+};
+
+// Find a section and check its bounds, return NULL if it is missing
+static const void *dict_section(const struct zyp_dict *dict, uint32_t tag,
+                                size_t elemsz, size_t *count)
+{
+    const struct dict_header *hdr = (const struct dict_header *)dict->base;
+    const struct dict_section *sec =
+        (const struct dict_section *)(dict->base + sizeof(*hdr));
+    for (uint32_t i = 0; i < hdr->section_count; i++) {
+        if (sec[i].tag != tag) {
+            continue;
+        }
+        if (sec[i].offset % DICT_ALIGN || sec[i].offset > dict->size
+                || sec[i].size > dict->size - sec[i].offset
+                || sec[i].size % elemsz) {
+            return NULL;
+        }
+        *count = sec[i].size / elemsz;
+        return dict->base + sec[i].offset;
+    }
+    return NULL;
+}
+
+static int dict_load_chars(struct zyp_dict *dict)
+{
+    size_t size;
+    const uint32_t *table = dict_section(dict, DICT_TAG_CHAR,
+                                         sizeof(uint32_t), &size);
+    if (!table) {
+        return 0;
+    }
+    if (size < ZYP_SYLLABLE_INDEX_COUNT + 1) {
+        return 1;
+    }
+    // Check the offsets once, so the queries can trust them
+    uint32_t count = table[ZYP_SYLLABLE_INDEX_COUNT];
+    if (size - (ZYP_SYLLABLE_INDEX_COUNT + 1) != 2 * (size_t)count) {
+        return 1;
+    }
+    for (size_t i = 0; i < ZYP_SYLLABLE_INDEX_COUNT; i++) {
+        if (table[i] > table[i + 1]) {
+            return 1;
+        }
+    }
+    dict->char_offsets = table;
+    dict->chars = table + ZYP_SYLLABLE_INDEX_COUNT + 1;
+    dict->char_freqs = dict->chars + count;
+    return 0;
+}
+
+static int dict_load(struct zyp_dict *dict)
+{
+    const struct dict_header *hdr = (const struct dict_header *)dict->base;
+    if (!dict_host_is_le() || dict->size < sizeof(*hdr)
+            || memcmp(hdr->magic, DICT_MAGIC, sizeof(hdr->magic))
+            || hdr->version != DICT_VERSION
+            || hdr->file_size != dict->size
+            || hdr->section_count > (dict->size - sizeof(*hdr))
+                                    / sizeof(struct dict_section)) {
+        return 1;
+    }
+
+    dict->keys = dict_section(dict, DICT_TAG_KEYS, sizeof(struct dict_key),
+                              &dict->key_count);
+    dict->sylls = dict_section(dict, DICT_TAG_SYLL, sizeof(uint16_t),
+                               &dict->syll_count);
+    dict->phrases = dict_section(dict, DICT_TAG_PHRS,
+                                 sizeof(struct zyp_dict_phrase),
+                                 &dict->phrase_count);
+    dict->text = dict_section(dict, DICT_TAG_TEXT, 1, &dict->text_size);
+    dict->trie = dict_section(dict, DICT_TAG_TRIE,
+                              sizeof(struct dict_trie_node),
+                              &dict->trie_size);
+    if (!dict->keys || !dict->sylls || !dict->phrases || !dict->text) {
+        return 1;
+    }
+    size_t count;
+    dict->stats = dict_section(dict, DICT_TAG_STAT, sizeof(struct dict_stats),
+                               &count);
+    if (dict->stats && count != 1) {
+        return 1;
+    }
+    const void *bigram = dict_section(dict, DICT_TAG_BIGR, 1, &count);
+    if (bigram) {
+        if (dict_bigram_load(&dict->bigram, bigram, count)) {
+            return 1;
+        }
+        dict->has_bigram = true;
+    }
+    return dict_load_chars(dict);
+}
+
+struct zyp_dict *zyp_dict_open_memory(const void *data, size_t size)
+{
+    if (!data || ((uintptr_t)data % DICT_ALIGN)) {
+        return NULL;
+    }
+    struct zyp_dict *dict = (struct zyp_dict *)calloc(1, sizeof(*dict));
+    if (!dict) {
+        return NULL;
+    }
+
+    dict->base = (const unsigned char *)data;
+    dict->size = size;
+    dict->refs = 1;
+    if (dict_load(dict)) {
+        free(dict);
+        return NULL;
+    }
+    return dict;
+}
+
+struct zyp_dict *zyp_dict_open(const char *path)
+{
+    if (!path) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    // A shared read-only mapping lets processes share the page cache
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    struct zyp_dict *dict = zyp_dict_open_memory(data, size);
+    if (!dict) {
+        munmap(data, size);
+        return NULL;
+    }
+    dict->mapped = true;
+    return dict;
+}
+
+struct zyp_dict *zyp_dict_ref(struct zyp_dict *dict)
+{
+    if (dict) {
+        __atomic_add_fetch(&dict->refs, 1, __ATOMIC_RELAXED);
+    }
+    return dict;
+}
+
+void zyp_dict_close(struct zyp_dict *dict)
+{
+    if (!dict) {
+        return;
+    }
+    // The last reference sees every use of the other references
+    if (__atomic_sub_fetch(&dict->refs, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    if (dict->mapped) {
+        munmap((void *)dict->base, dict->size);
+    }
+    free(dict);
+}
+
+static int syllables_compare(const uint16_t *a, size_t alen,
+                             const uint16_t *b, size_t blen)
+{
+    size_t len = alen < blen ? alen : blen;
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+// Get the phrases of a key, return 0 if the key is broken
+static size_t key_phrases(const struct zyp_dict *dict, size_t index,
+                          const struct zyp_dict_phrase **phrases)
+{
+    if (index >= dict->key_count) {
+        return 0;
+    }
+    const struct dict_key *key = &dict->keys[index];
+    if (key->phrase_first > dict->phrase_count
+            || key->phrase_count > dict->phrase_count - key->phrase_first) {
+        return 0;
+    }
+    *phrases = dict->phrases + key->phrase_first;
+    return key->phrase_count;
+}
+
+static size_t bsearch_lookup(const struct zyp_dict *dict,
+                             const uint16_t *sylls, size_t len,
+                             const struct zyp_dict_phrase **phrases)
+{
+    size_t lo = 0, hi = dict->key_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct dict_key *key = &dict->keys[mid];
+        if (key->syll_offset > dict->syll_count
+                || key->syll_count > dict->syll_count - key->syll_offset) {
+            return 0;
+        }
+        int cmp = syllables_compare(dict->sylls + key->syll_offset,
+                                    key->syll_count, sylls, len);
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else if (cmp > 0) {
+            hi = mid;
+        } else {
+            return key_phrases(dict, mid, phrases);
+        }
+    }
+    return 0;
+}
+
+// Follow the label from the node, return DICT_TRIE_NONE if there is no child
+static inline uint32_t trie_child(const struct zyp_dict *dict, uint32_t node,
+                                  uint32_t label)
+{
+    uint64_t child = (uint64_t)dict->trie[node].base + label;
+    if (child >= dict->trie_size || dict->trie[child].check != node) {
+        return DICT_TRIE_NONE;
+    }
+    return (uint32_t)child;
+}
+
+// Step from the node with a syllable, return DICT_TRIE_NONE at a dead end
+static inline uint32_t trie_step(const struct zyp_dict *dict, uint32_t node,
+                                 uint16_t syll)
+{
+    uint16_t index = zyp_syllable_to_index(syll);
+    if (index == ZYP_SYLLABLE_INDEX_INVALID) {
+        return DICT_TRIE_NONE;
+    }
+    return trie_child(dict, node, (uint32_t)index + 1);
+}
+
+size_t zyp_dict_lookup(const struct zyp_dict *dict, const uint16_t *sylls,
+                       size_t len, const struct zyp_dict_phrase **phrases)
+{
+    if (!dict || !sylls || !len || !phrases) {
+        return 0;
+    }
+    if (!dict->trie_size) {
+        return bsearch_lookup(dict, sylls, len, phrases);
+    }
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < len && node != DICT_TRIE_NONE; i++) {
+        node = trie_step(dict, node, sylls[i]);
+    }
+    if (node == DICT_TRIE_NONE) {
+        return 0;
+    }
+    uint32_t leaf = trie_child(dict, node, DICT_TRIE_END);
+    if (leaf == DICT_TRIE_NONE) {
+        return 0;
+    }
+    return key_phrases(dict, dict->trie[leaf].base, phrases);
+}
+
+size_t zyp_dict_prefix_search(const struct zyp_dict *dict,
+                              const uint16_t *sylls, size_t len,
+                              struct zyp_dict_match *matches, size_t n)
+{
+    if (!dict || !sylls || !matches) {
+        return 0;
+    }
+
+    size_t count = 0;
+    if (!dict->trie_size) {
+        for (size_t i = 1; i <= len && count < n; i++) {
+            struct zyp_dict_match *m = &matches[count];
+            if ((m->count = bsearch_lookup(dict, sylls, i, &m->phrases))) {
+                m->length = i;
+                count++;
+            }
+        }
+        return count;
+    }
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < len && count < n; i++) {
+        node = trie_step(dict, node, sylls[i]);
+        if (node == DICT_TRIE_NONE) {
+            break;
+        }
+        uint32_t leaf = trie_child(dict, node, DICT_TRIE_END);
+        if (leaf == DICT_TRIE_NONE) {
+            continue;
+        }
+        struct zyp_dict_match *m = &matches[count];
+        if ((m->count = key_phrases(dict, dict->trie[leaf].base,
+                                    &m->phrases))) {
+            m->length = i + 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t zyp_dict_chars(const struct zyp_dict *dict, uint16_t syll,
+                      uint32_t *chars, size_t n)
+{
+    if (!dict || !dict->char_offsets || !chars) {
+        return 0;
+    }
+    uint16_t index = zyp_syllable_to_index(syll);
+    if (index == ZYP_SYLLABLE_INDEX_INVALID) {
+        return 0;
+    }
+
+    const uint32_t *offsets = dict->char_offsets;
+    if (ZYP_SYLLABLE_TONE(syll)) {
+        // Already sorted, the top candidates are a slice
+        size_t count = offsets[index + 1] - offsets[index];
+        if (count > n) {
+            count = n;
+        }
+        memcpy(chars, dict->chars + offsets[index], count * sizeof(uint32_t));
+        return count;
+    }
+
+    // The tones of a syllable are adjacent in the dense index, merge them
+    uint32_t pos[ZYP_TONE_5 + 1], end[ZYP_TONE_5 + 1];
+    int runs = 0;
+    for (int tone = 0; tone <= ZYP_TONE_5; tone++) {
+        if (offsets[index + tone] < offsets[index + tone + 1]) {
+            pos[runs] = offsets[index + tone];
+            end[runs] = offsets[index + tone + 1];
+            runs++;
+        }
+    }
+    size_t count = 0;
+    while (count < n && runs) {
+        int best = 0;
+        for (int r = 1; r < runs; r++) {
+            if (dict->char_freqs[pos[r]] > dict->char_freqs[pos[best]]) {
+                best = r;
+            }
+        }
+        uint32_t cp = dict->chars[pos[best]++];
+        if (pos[best] == end[best]) {
+            runs--;
+            pos[best] = pos[runs];
+            end[best] = end[runs];
+        }
+        // A charactor may have several tones, keep the most frequent one
+        size_t i = 0;
+        while (i < count && chars[i] != cp) {
+            i++;
+        }
+        if (i == count) {
+            chars[count++] = cp;
+        }
+    }
+    return count;
+}
+
+const char *zyp_dict_phrase_text(const struct zyp_dict *dict,
+                                 const struct zyp_dict_phrase *phrase)
+{
+    if (!dict || phrase < dict->phrases
+            || phrase >= dict->phrases + dict->phrase_count) {
+        return NULL;
+    }
+    if (phrase->text_offset >= dict->text_size
+            || phrase->text_length >= dict->text_size - phrase->text_offset
+            || dict->text[phrase->text_offset + phrase->text_length]) {
+        return NULL;
+    }
+    return dict->text + phrase->text_offset;
+}
+
+uint32_t zyp_dict_phrase_id(const struct zyp_dict *dict,
+                            const struct zyp_dict_phrase *phrase)
+{
+    if (!dict || phrase < dict->phrases
+            || phrase >= dict->phrases + dict->phrase_count) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)(phrase - dict->phrases);
+}
+
+uint64_t zyp_dict_total_frequency(const struct zyp_dict *dict)
+{
+    if (!dict) {
+        return 0;
+    }
+    if (dict->stats) {
+        return dict->stats->total_frequency;
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < dict->phrase_count; i++) {
+        total += dict->phrases[i].frequency;
+    }
+    return total;
+}
+
+int32_t zyp_dict_bigram(const struct zyp_dict *dict, uint32_t prev,
+                        uint32_t next)
+{
+    int32_t score;
+    if (!dict || !dict->has_bigram
+            || !dict_bigram_lookup(&dict->bigram, prev, next, &score)) {
+        return 0;
+    }
+    return score;
+}
+
+size_t zyp_dict_phrase_count(const struct zyp_dict *dict)
+{
+    if (!dict) {
+        return 0;
+    }
+    return dict->phrase_count;
+}
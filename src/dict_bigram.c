@@ -0,0 +1,274 @@
+#include "dict_bigram.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Average number of pairs in a bucket */
+#define BUCKET_SIZE 4
+/** A larger bucket is unlikely, and makes the seed to be changed */
+#define MAX_BUCKET_PAIRS 64
+#define MAX_DISPLACEMENT UINT16_MAX
+#define MAX_ATTEMPTS 8
+
+int32_t dict_log2(uint64_t x)
+{
+    if (!x) {
+        return 0;
+    }
+    int32_t ip = 0;
+    uint64_t y = x;
+    for (int shift = 32; shift; shift >>= 1) {
+        if (y >> shift) {
+            y >>= shift;
+            ip += shift;
+        }
+    }
+    // Mantissa in [2^31, 2^32), which is [1, 2) with 31 fraction bits.
+    // The fraction bits come from squaring it, one bit per square.
+    uint64_t m = ip >= 31 ? x >> (ip - 31) : x << (31 - ip);
+    int32_t frac = 0;
+    for (int32_t bit = 1 << (DICT_SCORE_SHIFT - 1); bit; bit >>= 1) {
+        m = (m * m) >> 31;
+        if (m >> 32) {
+            m >>= 1;
+            frac |= bit;
+        }
+    }
+    return ip << DICT_SCORE_SHIFT | frac;
+}
+
+static inline size_t align_up(size_t n)
+{
+    return (n + DICT_ALIGN - 1) & ~(size_t)(DICT_ALIGN - 1);
+}
+
+// Offsets of the displacements and the slots, and the section size
+static size_t bigram_layout(uint32_t bucket_count, uint32_t slot_count,
+                            size_t *slot_offset)
+{
+    *slot_offset = align_up(sizeof(struct dict_bigram_header)
+                            + (size_t)bucket_count * sizeof(uint16_t));
+    return *slot_offset + (size_t)slot_count * sizeof(uint32_t);
+}
+
+// Working memory of the construction
+struct bigram_work {
+    const struct dict_bigram_entry *entries;
+    size_t count;
+    uint64_t *h;
+    uint64_t *g;
+    /** Pairs sorted by bucket, bucket `b` is `order[first[b]...]` */
+    uint32_t *order;
+    uint32_t *first;
+    /** Buckets sorted by size in descending order */
+    uint32_t *buckets;
+    uint8_t *codes;
+};
+
+// Place the pairs of a bucket, return 1 if no displacement fits
+static int bigram_place_bucket(const struct bigram_work *w,
+                               const struct dict_bigram *lm, uint32_t bucket,
+                               uint16_t *displacements, uint32_t *slots)
+{
+    const uint32_t *members = w->order + w->first[bucket];
+    const uint32_t size = w->first[bucket + 1] - w->first[bucket];
+    uint32_t placed[MAX_BUCKET_PAIRS];
+
+    for (uint32_t d = 0; d <= MAX_DISPLACEMENT; d++) {
+        uint32_t k = 0;
+        for (; k < size; k++) {
+            uint32_t i = members[k];
+            uint32_t s = dict_bigram_slot(w->h[i], w->g[i], d,
+                                          lm->slot_count);
+            if (slots[s]) {
+                break;
+            }
+            uint32_t j = 0;
+            while (j < k && placed[j] != s) {
+                j++;
+            }
+            if (j < k) {
+                break;
+            }
+            placed[k] = s;
+        }
+        if (k < size) {
+            continue;
+        }
+        for (k = 0; k < size; k++) {
+            uint32_t i = members[k];
+            slots[placed[k]] = dict_bigram_fingerprint(w->g[i]) << 8
+                               | w->codes[i];
+        }
+        displacements[bucket] = (uint16_t)d;
+        return 0;
+    }
+    return 1;
+}
+
+// Try a seed and a table size, return 1 if some bucket can not be placed
+static int bigram_place(struct bigram_work *w, struct dict_bigram *lm,
+                        uint16_t *displacements, uint32_t *slots)
+{
+    const uint32_t bucket_count = lm->bucket_count;
+    uint32_t *first = w->first;
+    memset(first, 0, ((size_t)bucket_count + 2) * sizeof(*first));
+    for (size_t i = 0; i < w->count; i++) {
+        dict_bigram_hash(lm->seed, w->entries[i].prev, w->entries[i].next,
+                         &w->h[i], &w->g[i]);
+        uint32_t b = dict_bigram_reduce((uint32_t)(w->h[i] >> 32),
+                                        bucket_count);
+        if (++first[b + 2] > MAX_BUCKET_PAIRS) {
+            return 1;
+        }
+    }
+
+    // Counting sort of the pairs by bucket, and the buckets by size
+    uint32_t size_count[MAX_BUCKET_PAIRS + 1] = { 0 };
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        size_count[first[b + 2]]++;
+    }
+    uint32_t size_first[MAX_BUCKET_PAIRS + 1];
+    uint32_t sum = 0;
+    for (int size = MAX_BUCKET_PAIRS; size >= 0; size--) {
+        size_first[size] = sum;
+        sum += size_count[size];
+    }
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        w->buckets[size_first[first[b + 2]]++] = b;
+    }
+    for (uint32_t b = 2; b < bucket_count + 2; b++) {
+        first[b] += first[b - 1];
+    }
+    for (size_t i = 0; i < w->count; i++) {
+        uint32_t b = dict_bigram_reduce((uint32_t)(w->h[i] >> 32),
+                                        bucket_count);
+        w->order[first[b + 1]++] = (uint32_t)i;
+    }
+
+    memset(displacements, 0, (size_t)bucket_count * sizeof(uint16_t));
+    memset(slots, 0, (size_t)lm->slot_count * sizeof(uint32_t));
+    for (uint32_t k = 0; k < bucket_count; k++) {
+        uint32_t b = w->buckets[k];
+        if (first[b + 1] == first[b]) {
+            break;
+        }
+        if (bigram_place_bucket(w, lm, b, displacements, slots)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Quantize the scores to evenly spaced levels between the extremes
+static void bigram_quantize(struct bigram_work *w, struct dict_bigram *lm)
+{
+    int32_t lo = w->entries[0].score, hi = lo;
+    for (size_t i = 1; i < w->count; i++) {
+        int32_t score = w->entries[i].score;
+        lo = score < lo ? score : lo;
+        hi = score > hi ? score : hi;
+    }
+    int64_t step = ((int64_t)hi - lo + 254) / 255;
+    lm->base = lo;
+    lm->step = step ? (int32_t)step : 1;
+    for (size_t i = 0; i < w->count; i++) {
+        int64_t code = ((int64_t)w->entries[i].score - lo + lm->step / 2)
+                       / lm->step;
+        w->codes[i] = (uint8_t)(code > 255 ? 255 : code);
+    }
+}
+
+int dict_bigram_build(const struct dict_bigram_entry *entries, size_t count,
+                      void **image, size_t *size)
+{
+    if (!entries || !count || count > UINT32_MAX / 2) {
+        return 1;
+    }
+    struct bigram_work w = {
+        .entries = entries,
+        .count = count,
+    };
+    struct dict_bigram lm = {
+        .bucket_count = (uint32_t)((count + BUCKET_SIZE - 1) / BUCKET_SIZE),
+        .slot_count = (uint32_t)(count + count / 64 + 1),
+    };
+    w.h = malloc(count * sizeof(*w.h));
+    w.g = malloc(count * sizeof(*w.g));
+    w.order = malloc(count * sizeof(*w.order));
+    w.first = malloc(((size_t)lm.bucket_count + 2) * sizeof(*w.first));
+    w.buckets = malloc((size_t)lm.bucket_count * sizeof(*w.buckets));
+    w.codes = malloc(count);
+    unsigned char *data = NULL;
+    int err = 1;
+    if (!w.h || !w.g || !w.order || !w.first || !w.buckets || !w.codes) {
+        goto out;
+    }
+    bigram_quantize(&w, &lm);
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        size_t slot_offset;
+        size_t total = bigram_layout(lm.bucket_count, lm.slot_count,
+                                     &slot_offset);
+        free(data);
+        data = calloc(1, total);
+        if (!data) {
+            goto out;
+        }
+        lm.seed = dict_bigram_mix((uint64_t)attempt + 1);
+        uint16_t *displacements =
+            (uint16_t *)(data + sizeof(struct dict_bigram_header));
+        uint32_t *slots = (uint32_t *)(data + slot_offset);
+        if (bigram_place(&w, &lm, displacements, slots)) {
+            // A sparser table is easier to place
+            lm.slot_count += (uint32_t)(count / 32 + 1);
+            continue;
+        }
+
+        struct dict_bigram_header hdr = {
+            .seed = lm.seed,
+            .bucket_count = lm.bucket_count,
+            .slot_count = lm.slot_count,
+            .base = lm.base,
+            .step = lm.step,
+        };
+        memcpy(data, &hdr, sizeof(hdr));
+        *image = data;
+        *size = total;
+        data = NULL;
+        err = 0;
+        break;
+    }
+
+out:
+    free(data);
+    free(w.h);
+    free(w.g);
+    free(w.order);
+    free(w.first);
+    free(w.buckets);
+    free(w.codes);
+    return err;
+}
+
+int dict_bigram_load(struct dict_bigram *lm, const void *data, size_t size)
+{
+    const struct dict_bigram_header *hdr =
+        (const struct dict_bigram_header *)data;
+    if (size < sizeof(*hdr) || !hdr->bucket_count || !hdr->slot_count) {
+        return 1;
+    }
+    size_t slot_offset;
+    if (bigram_layout(hdr->bucket_count, hdr->slot_count, &slot_offset)
+            != size) {
+        return 1;
+    }
+    lm->seed = hdr->seed;
+    lm->bucket_count = hdr->bucket_count;
+    lm->slot_count = hdr->slot_count;
+    lm->base = hdr->base;
+    lm->step = hdr->step;
+    lm->displacements = (const uint16_t *)(hdr + 1);
+    lm->slots = (const uint32_t *)((const unsigned char *)data + slot_offset);
+    return 0;
+}
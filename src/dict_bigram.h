@@ -0,0 +1,139 @@
+#ifndef _ZYP_DICT_BIGRAM_H
+#define _ZYP_DICT_BIGRAM_H
+/**
+ * @file
+ * Bigram scores of phrase pairs, in a minimal perfect hash table with
+ * quantized scores, see DICT_TAG_BIGR
+ *
+ * A lookup reads one displacement and one slot, which are two cache lines.
+ */
+
+#include "dict_format.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Scores are base 2 logarithms in fixed point with this many fraction bits,
+ * the same as the conversion scores
+ */
+#define DICT_SCORE_SHIFT 8
+
+/** A phrase pair and its score, the input of the table */
+struct dict_bigram_entry {
+    uint32_t prev;
+    uint32_t next;
+    int32_t score;
+};
+
+/** A bigram table, pointing into a dictionary image */
+struct dict_bigram {
+    uint64_t seed;
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    int32_t base;
+    int32_t step;
+    const uint16_t *displacements;
+    const uint32_t *slots;
+};
+
+// The finalizer of splitmix64
+static inline uint64_t dict_bigram_mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9u;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBu;
+    return x ^ (x >> 31);
+}
+
+// Map a 32-bit hash to `[0, n)`
+static inline uint32_t dict_bigram_reduce(uint32_t h, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)h * n) >> 32);
+}
+
+/**
+ * The hashes of a phrase pair. The bucket is chosen by `h`, and the slot by
+ * `h` and `g` with the displacement `d` of the bucket, as
+ * `reduce(low(h) + d * odd(high(g)))`. The fingerprint is the low 24 bits
+ * of `g`, or 1 if they are 0.
+ */
+static inline void dict_bigram_hash(uint64_t seed, uint32_t prev,
+                                    uint32_t next, uint64_t *h, uint64_t *g)
+{
+    *h = dict_bigram_mix(((uint64_t)prev << 32 | next) ^ seed);
+    *g = dict_bigram_mix(*h);
+}
+
+static inline uint32_t dict_bigram_fingerprint(uint64_t g)
+{
+    uint32_t fp = (uint32_t)g & 0xFFFFFF;
+    return fp ? fp : 1;
+}
+
+static inline uint32_t dict_bigram_slot(uint64_t h, uint64_t g, uint32_t d,
+                                        uint32_t slot_count)
+{
+    uint32_t step = (uint32_t)(g >> 32) | 1;
+    return dict_bigram_reduce((uint32_t)h + d * step, slot_count);
+}
+
+/**
+ * Get the score of a phrase pair
+ * A pair not in the table matches a slot with a probability of 2^-24.
+ *
+ * @param lm bigram table
+ * @param prev identifier of the previous phrase
+ * @param next identifier of the next phrase
+ * @param score where to store the score
+ * @return 1 if the pair is found, 0 otherwise
+ */
+static inline int dict_bigram_lookup(const struct dict_bigram *lm,
+                                     uint32_t prev, uint32_t next,
+                                     int32_t *score)
+{
+    uint64_t h, g;
+    dict_bigram_hash(lm->seed, prev, next, &h, &g);
+    uint32_t d = lm->displacements[dict_bigram_reduce((uint32_t)(h >> 32),
+                                                      lm->bucket_count)];
+    uint32_t slot = lm->slots[dict_bigram_slot(h, g, d, lm->slot_count)];
+    if (slot >> 8 != dict_bigram_fingerprint(g)) {
+        return 0;
+    }
+    *score = lm->base + (int32_t)(slot & 0xFF) * lm->step;
+    return 1;
+}
+
+/**
+ * Base 2 logarithm of `x`, in fixed point with DICT_SCORE_SHIFT fraction
+ * bits, 0 if `x` is 0
+ *
+ * @param x positive integer
+ * @return logarithm of `x`
+ */
+int32_t dict_log2(uint64_t x);
+
+/**
+ * Build the bigram section of the phrase pairs
+ * The scores are quantized to 256 evenly spaced levels.
+ *
+ * @param entries phrase pairs, which should be unique
+ * @param count number of pairs, at least 1
+ * @param image where to store the newly allocated section
+ * @param size where to store the size of the section
+ * @return 0 if successful, 1 if fail to build the hash table or fail to
+ * allocate memory
+ */
+int dict_bigram_build(const struct dict_bigram_entry *entries, size_t count,
+                      void **image, size_t *size);
+
+/**
+ * Check a bigram section and point the table into it
+ *
+ * @param lm bigram table to be filled
+ * @param data section data, aligned to DICT_ALIGN
+ * @param size size of the section
+ * @return 0 if successful, 1 if the section is not valid
+ */
+int dict_bigram_load(struct dict_bigram *lm, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,742 @@
+#include "dict_builder.h"
+#include "dict_bigram.h"
+#include "dict_format.h"
+#include "dict_trie.h"
+#include "utf8.h"
+
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_MAX_KEY_LENGTH UINT16_MAX
+#define COPY_BUFFER_SIZE 65536
+/** Bigram scores beyond this are clamped, so they do not widen the levels */
+#define MAX_BIGRAM_SCORE (24 << DICT_SCORE_SHIFT)
+
+// A section spilled to a temporary file while building
+struct section_file {
+    FILE *fp;
+    uint64_t length;
+};
+
+// A growable buffer in memory
+struct byte_buf {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+};
+
+// A phrase of the current key, and its index before sorting
+struct pending_phrase {
+    struct zyp_dict_phrase phrase;
+    uint32_t local;
+};
+
+// A phrase pair, by the numbers of the phrases
+struct bigram_record {
+    uint32_t prev;
+    uint32_t next;
+    uint32_t count;
+};
+
+// A single charactor phrase, for the charactor table
+struct char_entry {
+    uint32_t index;
+    uint32_t cp;
+    uint32_t frequency;
+};
+
+// Here are the hidden structure definition
+struct zyp_dict_builder {
+    struct section_file keys;
+    struct section_file sylls;
+    struct section_file phrases;
+    struct section_file text;
+    /** The current key, written out once its phrases are complete */
+    struct dict_key key;
+    struct byte_buf key_sylls;
+    bool has_key;
+    /**
+     * Phrases of the current key, the text offsets point into
+     * `pending_text` until the key is flushed
+     */
+    struct byte_buf pending;
+    struct byte_buf pending_text;
+    /**
+     * Open addressing hash table to find the duplicated text, each slot is
+     * a pending phrase index plus 1, or 0 if the slot is empty
+     */
+    uint32_t *slots;
+    size_t slot_count;
+    /** Single charactor phrases, in the order of syllables and frequency */
+    struct byte_buf chars;
+    struct dict_stats stats;
+    /**
+     * Phrase identifier of each added phrase number. It is the pending
+     * phrase index for the numbers of the current key, from `key_number`.
+     */
+    struct byte_buf ids;
+    uint32_t key_number;
+    /** Position of each pending phrase after sorting */
+    struct byte_buf ranks;
+    struct byte_buf bigrams;
+    /** Set on write errors, the builder can not recover from them */
+    bool failed;
+};
+
+static int buf_reserve(struct byte_buf *buf, size_t size)
+{
+    if (size <= buf->capacity) {
+        return 0;
+    }
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    unsigned char *data = (unsigned char *)realloc(buf->data, capacity);
+    if (!data) {
+        return 1;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 0;
+}
+
+static int buf_append(struct byte_buf *buf, const void *data, size_t size)
+{
+    if (buf_reserve(buf, buf->length + size)) {
+        return 1;
+    }
+    memcpy(buf->data + buf->length, data, size);
+    buf->length += size;
+    return 0;
+}
+
+static int section_append(struct section_file *sec, const void *data,
+                          size_t size)
+{
+    if (fwrite(data, 1, size, sec->fp) != size) {
+        return 1;
+    }
+    sec->length += size;
+    return 0;
+}
+
+struct zyp_dict_builder *zyp_dict_builder_new(void)
+{
+    struct zyp_dict_builder *b =
+        (struct zyp_dict_builder *)calloc(1, sizeof(struct zyp_dict_builder));
+    if (!b) {
+        return NULL;
+    }
+    // Sections are kept on disk, so the dictionary size is not bounded by RAM
+    if (!(b->keys.fp = tmpfile()) || !(b->sylls.fp = tmpfile())
+            || !(b->phrases.fp = tmpfile()) || !(b->text.fp = tmpfile())) {
+        zyp_dict_builder_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+void zyp_dict_builder_free(struct zyp_dict_builder *b)
+{
+    if (!b) {
+        return;
+    }
+    struct section_file *sections[] = {
+        &b->keys, &b->sylls, &b->phrases, &b->text,
+    };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        if (sections[i]->fp) {
+            fclose(sections[i]->fp);
+        }
+    }
+    free(b->key_sylls.data);
+    free(b->pending.data);
+    free(b->pending_text.data);
+    free(b->slots);
+    free(b->chars.data);
+    free(b->ids.data);
+    free(b->ranks.data);
+    free(b->bigrams.data);
+    free(b);
+}
+
+// FNV-1a
+static uint32_t text_hash(const unsigned char *text, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ text[i]) * 16777619u;
+    }
+    return h;
+}
+
+static inline const struct zyp_dict_phrase *pending_get(
+    const struct zyp_dict_builder *b, size_t index)
+{
+    return &((const struct pending_phrase *)b->pending.data)[index].phrase;
+}
+
+static inline size_t pending_count(const struct zyp_dict_builder *b)
+{
+    return b->pending.length / sizeof(struct pending_phrase);
+}
+
+// Find the slot of the text, which is either empty or holding the text
+static size_t slot_find(const struct zyp_dict_builder *b,
+                        const unsigned char *text, size_t len)
+{
+    size_t mask = b->slot_count - 1;
+    size_t i = text_hash(text, len) & mask;
+    while (b->slots[i]) {
+        const struct zyp_dict_phrase *p = pending_get(b, b->slots[i] - 1);
+        if (p->text_length == len
+                && !memcmp(b->pending_text.data + p->text_offset, text, len)) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Keep the load factor under 1/2
+static int slots_reserve(struct zyp_dict_builder *b, size_t count)
+{
+    if (count * 2 <= b->slot_count) {
+        return 0;
+    }
+    size_t slot_count = b->slot_count ? b->slot_count * 2 : 64;
+    while (count * 2 > slot_count) {
+        slot_count *= 2;
+    }
+    uint32_t *slots = (uint32_t *)calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return 1;
+    }
+    free(b->slots);
+    b->slots = slots;
+    b->slot_count = slot_count;
+
+    size_t pending = pending_count(b);
+    for (size_t i = 0; i < pending; i++) {
+        const struct zyp_dict_phrase *p = pending_get(b, i);
+        b->slots[slot_find(b, b->pending_text.data + p->text_offset,
+                           p->text_length)] = (uint32_t)(i + 1);
+    }
+    return 0;
+}
+
+// Empty the slots used by the pending phrases, cheaper than clearing all
+static void slots_clear(struct zyp_dict_builder *b)
+{
+    size_t mask = b->slot_count - 1;
+    size_t pending = pending_count(b);
+    for (size_t i = 0; i < pending; i++) {
+        const struct zyp_dict_phrase *p = pending_get(b, i);
+        size_t slot = text_hash(b->pending_text.data + p->text_offset,
+                                p->text_length) & mask;
+        // Slots cleared before may break the probing chain, skip them
+        while (b->slots[slot] != i + 1) {
+            slot = (slot + 1) & mask;
+        }
+        b->slots[slot] = 0;
+    }
+}
+
+static int phrase_compare(const void *a, const void *b)
+{
+    const struct zyp_dict_phrase *pa =
+        &((const struct pending_phrase *)a)->phrase;
+    const struct zyp_dict_phrase *pb =
+        &((const struct pending_phrase *)b)->phrase;
+    if (pa->frequency != pb->frequency) {
+        return pa->frequency > pb->frequency ? -1 : 1;
+    }
+    // Keep the insertion order for equal frequencies
+    return (pa->text_offset > pb->text_offset)
+           - (pa->text_offset < pb->text_offset);
+}
+
+// Sort the phrases of the current key, and write the key out
+static int builder_flush_key(struct zyp_dict_builder *b)
+{
+    if (!b->has_key) {
+        return 0;
+    }
+    slots_clear(b);
+    struct pending_phrase *pending = (struct pending_phrase *)b->pending.data;
+    size_t count = pending_count(b);
+    qsort(pending, count, sizeof(struct pending_phrase), phrase_compare);
+
+    // Turn the phrase numbers of the key into phrase identifiers
+    b->ranks.length = 0;
+    if (buf_reserve(&b->ranks, count * sizeof(uint32_t))) {
+        return 1;
+    }
+    uint32_t *ranks = (uint32_t *)b->ranks.data;
+    for (size_t i = 0; i < count; i++) {
+        ranks[pending[i].local] = (uint32_t)i;
+    }
+    uint32_t *ids = (uint32_t *)b->ids.data;
+    size_t numbers = b->ids.length / sizeof(uint32_t);
+    for (size_t n = b->key_number; n < numbers; n++) {
+        ids[n] = b->key.phrase_first + ranks[ids[n]];
+    }
+    b->key_number = (uint32_t)numbers;
+
+    // Single charactors of a syllable also go to the charactor table
+    const bool single = b->key.syll_count == 1;
+    const uint32_t index =
+        zyp_syllable_to_index(*(const uint16_t *)b->key_sylls.data);
+
+    // Write the text in the phrase order, so a lookup touches less pages
+    for (size_t i = 0; i < count; i++) {
+        struct zyp_dict_phrase *phrase = &pending[i].phrase;
+        const unsigned char *text = b->pending_text.data
+                                    + phrase->text_offset;
+        if (b->text.length + phrase->text_length + 1 > UINT32_MAX) {
+            return 1;
+        }
+        phrase->text_offset = (uint32_t)b->text.length;
+        if (section_append(&b->text, text, phrase->text_length + 1)
+                || section_append(&b->phrases, phrase, sizeof(*phrase))) {
+            return 1;
+        }
+        b->stats.total_frequency += phrase->frequency;
+
+        size_t size;
+        struct char_entry entry = {
+            .index = index,
+            .cp = utf8_decode((const char *)text, &size),
+            .frequency = phrase->frequency,
+        };
+        if (single && size == phrase->text_length
+                && buf_append(&b->chars, &entry, sizeof(entry))) {
+            return 1;
+        }
+    }
+    if (section_append(&b->sylls, b->key_sylls.data,
+                              b->key_sylls.length)
+            || section_append(&b->keys, &b->key, sizeof(b->key))) {
+        return 1;
+    }
+    b->pending.length = 0;
+    b->pending_text.length = 0;
+    b->has_key = false;
+    return 0;
+}
+
+// Compare with the current key, return -1, 0 or 1 like strcmp()
+static int builder_compare_key(const struct zyp_dict_builder *b,
+                               const uint16_t *sylls, size_t len)
+{
+    if (!b->key_sylls.length) {
+        return 1;
+    }
+    const uint16_t *last = (const uint16_t *)b->key_sylls.data;
+    size_t lastlen = b->key.syll_count;
+    size_t n = lastlen < len ? lastlen : len;
+    for (size_t i = 0; i < n; i++) {
+        if (sylls[i] != last[i]) {
+            return sylls[i] < last[i] ? -1 : 1;
+        }
+    }
+    return (len > lastlen) - (len < lastlen);
+}
+
+static int builder_new_key(struct zyp_dict_builder *b, const uint16_t *sylls,
+                           size_t len)
+{
+    if (builder_flush_key(b)) {
+        return 1;
+    }
+    uint64_t syll_offset = b->sylls.length / sizeof(uint16_t);
+    uint64_t phrase_first = b->phrases.length / sizeof(struct zyp_dict_phrase);
+    if (syll_offset + len > UINT32_MAX || phrase_first > UINT32_MAX) {
+        return 1;
+    }
+    b->key = (struct dict_key){
+        .syll_offset = (uint32_t)syll_offset,
+        .syll_count = (uint16_t)len,
+        .phrase_first = (uint32_t)phrase_first,
+    };
+    b->key_sylls.length = 0;
+    if (buf_append(&b->key_sylls, sylls, len * sizeof(uint16_t))) {
+        return 1;
+    }
+    b->has_key = true;
+    return 0;
+}
+
+static int builder_add(struct zyp_dict_builder *b, const uint16_t *sylls,
+                       size_t len, const char *text, size_t textlen,
+                       uint32_t frequency)
+{
+    int cmp = builder_compare_key(b, sylls, len);
+    if (cmp < 0 || (cmp == 0 && !b->has_key)) {
+        return 1;
+    }
+    if (cmp > 0 && builder_new_key(b, sylls, len)) {
+        b->failed = true;
+        return 1;
+    }
+
+    // Merge the duplicated text
+    size_t count = pending_count(b);
+    if (count >= UINT32_MAX || slots_reserve(b, count + 1)
+            || b->ids.length / sizeof(uint32_t) >= UINT32_MAX
+            || buf_reserve(&b->ids, b->ids.length + sizeof(uint32_t))) {
+        return 1;
+    }
+    size_t slot = slot_find(b, (const unsigned char *)text, textlen);
+    if (b->slots[slot]) {
+        uint32_t local = b->slots[slot] - 1;
+        struct zyp_dict_phrase *p =
+            &((struct pending_phrase *)b->pending.data)[local].phrase;
+        if (p->frequency < frequency) {
+            p->frequency = frequency;
+        }
+        return buf_append(&b->ids, &local, sizeof(local));
+    }
+
+    if (b->pending_text.length + textlen + 1 > UINT32_MAX) {
+        return 1;
+    }
+    struct pending_phrase phrase = {
+        .phrase = {
+            .text_offset = (uint32_t)b->pending_text.length,
+            .text_length = (uint32_t)textlen,
+            .frequency = frequency,
+        },
+        .local = (uint32_t)count,
+    };
+    if (buf_append(&b->pending_text, text, textlen)
+            || buf_append(&b->pending_text, "", 1)
+            || buf_append(&b->pending, &phrase, sizeof(phrase))
+            || buf_append(&b->ids, &phrase.local, sizeof(phrase.local))) {
+        return 1;
+    }
+    b->slots[slot] = (uint32_t)(count + 1);
+    b->key.phrase_count++;
+    return 0;
+}
+
+int zyp_dict_builder_add(struct zyp_dict_builder *b, const uint16_t *sylls,
+                         size_t len, const char *text, size_t textlen,
+                         uint32_t frequency)
+{
+    if (!b || b->failed || !sylls || !len || len > DICT_MAX_KEY_LENGTH
+            || !text || !textlen || memchr(text, '\0', textlen)) {
+        return 1;
+    }
+    // The trie is labeled by the dense indexes
+    for (size_t i = 0; i < len; i++) {
+        if (zyp_syllable_to_index(sylls[i]) == ZYP_SYLLABLE_INDEX_INVALID) {
+            return 1;
+        }
+    }
+    return builder_add(b, sylls, len, text, textlen, frequency);
+}
+
+int zyp_dict_builder_add_bigram(struct zyp_dict_builder *b, uint32_t prev,
+                                uint32_t next, uint32_t count)
+{
+    size_t numbers = b ? b->ids.length / sizeof(uint32_t) : 0;
+    if (!b || b->failed || prev >= numbers || next >= numbers) {
+        return 1;
+    }
+    struct bigram_record rec = { prev, next, count };
+    return buf_append(&b->bigrams, &rec, sizeof(rec));
+}
+
+static inline uint64_t align_up(uint64_t n)
+{
+    return (n + DICT_ALIGN - 1) & ~(uint64_t)(DICT_ALIGN - 1);
+}
+
+static int write_padding(FILE *fp, uint64_t size)
+{
+    static const unsigned char padding[DICT_ALIGN];
+    return fwrite(padding, 1, size, fp) != size;
+}
+
+static int copy_section(FILE *fp, const struct section_file *sec)
+{
+    unsigned char buf[COPY_BUFFER_SIZE];
+    if (fflush(sec->fp) || fseek(sec->fp, 0, SEEK_SET)) {
+        return 1;
+    }
+    uint64_t left = sec->length;
+    while (left) {
+        size_t n = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+        if (fread(buf, 1, n, sec->fp) != n || fwrite(buf, 1, n, fp) != n) {
+            return 1;
+        }
+        left -= n;
+    }
+    // Later additions go to the end again
+    return fseek(sec->fp, 0, SEEK_END) != 0;
+}
+
+// Read a section back into memory
+static void *section_load(const struct section_file *sec)
+{
+    void *data = malloc(sec->length ? (size_t)sec->length : 1);
+    if (!data) {
+        return NULL;
+    }
+    if (fflush(sec->fp) || fseek(sec->fp, 0, SEEK_SET)
+            || fread(data, 1, (size_t)sec->length, sec->fp) != sec->length
+            || fseek(sec->fp, 0, SEEK_END)) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static int build_trie(struct zyp_dict_builder *b,
+                      struct dict_trie_node **nodes, size_t *node_count)
+{
+    struct dict_key *keys = (struct dict_key *)section_load(&b->keys);
+    uint16_t *sylls = (uint16_t *)section_load(&b->sylls);
+    int err = !keys || !sylls
+              || dict_trie_build(keys,
+                                 b->keys.length / sizeof(struct dict_key),
+                                 sylls, nodes, node_count);
+    free(keys);
+    free(sylls);
+    return err;
+}
+
+// Lay out the charactor table, see DICT_TAG_CHAR
+static uint32_t *build_chars(const struct zyp_dict_builder *b, size_t *size)
+{
+    const struct char_entry *entries = (const struct char_entry *)b->chars.data;
+    size_t count = b->chars.length / sizeof(struct char_entry);
+    if (count > UINT32_MAX) {
+        return NULL;
+    }
+    *size = (ZYP_SYLLABLE_INDEX_COUNT + 1 + 2 * count) * sizeof(uint32_t);
+    uint32_t *table = (uint32_t *)malloc(*size);
+    if (!table) {
+        return NULL;
+    }
+
+    uint32_t *offsets = table;
+    uint32_t *chars = offsets + ZYP_SYLLABLE_INDEX_COUNT + 1;
+    uint32_t *freqs = chars + count;
+    size_t i = 0;
+    for (uint32_t index = 0; index <= ZYP_SYLLABLE_INDEX_COUNT; index++) {
+        offsets[index] = (uint32_t)i;
+        // The entries are added in the order of the syllables
+        for (; i < count && entries[i].index == index; i++) {
+            chars[i] = entries[i].cp;
+            freqs[i] = entries[i].frequency;
+        }
+    }
+    return table;
+}
+
+static int bigram_compare(const void *a, const void *b)
+{
+    const struct bigram_record *x = (const struct bigram_record *)a;
+    const struct bigram_record *y = (const struct bigram_record *)b;
+    if (x->prev != y->prev) {
+        return x->prev < y->prev ? -1 : 1;
+    }
+    return (x->next > y->next) - (x->next < y->next);
+}
+
+// Compute the bigram scores from the counts, and build their section.
+// The score is log2(P(next | prev) / P(next)), see zyp_dict_bigram().
+static int build_bigram(const struct zyp_dict_builder *b, void **image,
+                        size_t *size)
+{
+    size_t count = b->bigrams.length / sizeof(struct bigram_record);
+    *image = NULL;
+    *size = 0;
+    if (!count) {
+        return 0;
+    }
+    const uint32_t *ids = (const uint32_t *)b->ids.data;
+    struct bigram_record *pairs = malloc(count * sizeof(*pairs));
+    struct dict_bigram_entry *entries = malloc(count * sizeof(*entries));
+    struct zyp_dict_phrase *phrases =
+        (struct zyp_dict_phrase *)section_load(&b->phrases);
+    int err = 1;
+    if (!pairs || !entries || !phrases) {
+        goto out;
+    }
+    memcpy(pairs, b->bigrams.data, b->bigrams.length);
+    for (size_t i = 0; i < count; i++) {
+        pairs[i].prev = ids[pairs[i].prev];
+        pairs[i].next = ids[pairs[i].next];
+    }
+    qsort(pairs, count, sizeof(*pairs), bigram_compare);
+
+    const int32_t norm = dict_log2(b->stats.total_frequency);
+    size_t n = 0;
+    for (size_t i = 0; i < count;) {
+        uint64_t sum = 0;
+        size_t j = i;
+        for (; j < count && !bigram_compare(&pairs[i], &pairs[j]); j++) {
+            sum += pairs[j].count;
+        }
+        // A phrase of frequency 0 is counted as seen once, as the phrase
+        // occurs in the pair at least
+        uint64_t prev_freq = phrases[pairs[i].prev].frequency;
+        uint64_t next_freq = phrases[pairs[i].next].frequency;
+        int64_t score = (int64_t)dict_log2(sum) + norm
+                        - dict_log2(prev_freq ? prev_freq : 1)
+                        - dict_log2(next_freq ? next_freq : 1);
+        if (score > MAX_BIGRAM_SCORE) {
+            score = MAX_BIGRAM_SCORE;
+        } else if (score < -MAX_BIGRAM_SCORE) {
+            score = -MAX_BIGRAM_SCORE;
+        }
+        entries[n].prev = pairs[i].prev;
+        entries[n].next = pairs[i].next;
+        entries[n].score = (int32_t)score;
+        n++;
+        i = j;
+    }
+    err = dict_bigram_build(entries, n, image, size);
+
+out:
+    free(pairs);
+    free(entries);
+    free(phrases);
+    return err;
+}
+
+static int write_image(struct zyp_dict_builder *b, FILE *fp,
+                       const struct dict_trie_node *nodes, size_t node_count,
+                       const uint32_t *chars, size_t chars_size,
+                       const void *bigram, size_t bigram_size)
+{
+    // Sections are either spilled to a file, or kept in memory
+    const struct {
+        uint32_t tag;
+        const struct section_file *sec;
+        const void *data;
+        uint64_t size;
+    } sections[] = {
+        { DICT_TAG_KEYS, &b->keys, NULL, b->keys.length },
+        { DICT_TAG_SYLL, &b->sylls, NULL, b->sylls.length },
+        { DICT_TAG_PHRS, &b->phrases, NULL, b->phrases.length },
+        { DICT_TAG_TEXT, &b->text, NULL, b->text.length },
+        { DICT_TAG_TRIE, NULL, nodes,
+          node_count * sizeof(struct dict_trie_node) },
+        { DICT_TAG_CHAR, NULL, chars, chars_size },
+        { DICT_TAG_STAT, NULL, &b->stats, sizeof(b->stats) },
+        { DICT_TAG_BIGR, NULL, bigram, bigram_size },
+    };
+    // The bigram section is left out without any pair
+    const size_t count = sizeof(sections) / sizeof(sections[0])
+                         - (bigram_size ? 0 : 1);
+
+    struct dict_section dir[sizeof(sections) / sizeof(sections[0])];
+    const size_t dir_size = count * sizeof(dir[0]);
+    uint64_t offset = align_up(sizeof(struct dict_header) + dir_size);
+    for (size_t i = 0; i < count; i++) {
+        dir[i] = (struct dict_section){
+            .tag = sections[i].tag,
+            .offset = offset,
+            .size = sections[i].size,
+        };
+        offset = align_up(offset + sections[i].size);
+    }
+
+    struct dict_header hdr = {
+        .magic = DICT_MAGIC,
+        .version = DICT_VERSION,
+        .section_count = (uint32_t)count,
+        .file_size = offset,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+            || fwrite(dir, dir_size, 1, fp) != 1) {
+        return 1;
+    }
+    uint64_t pos = sizeof(hdr) + dir_size;
+    for (size_t i = 0; i < count; i++) {
+        if (write_padding(fp, dir[i].offset - pos)) {
+            return 1;
+        }
+        if (sections[i].sec ? copy_section(fp, sections[i].sec)
+                : fwrite(sections[i].data, 1, (size_t)sections[i].size, fp)
+                  != sections[i].size) {
+            return 1;
+        }
+        pos = dir[i].offset + dir[i].size;
+    }
+    return write_padding(fp, offset - pos);
+}
+
+int zyp_dict_builder_write(struct zyp_dict_builder *b, const char *path)
+{
+    if (!b || b->failed || !path || !dict_host_is_le()) {
+        return 1;
+    }
+    if (builder_flush_key(b)) {
+        b->failed = true;
+        return 1;
+    }
+
+    struct dict_trie_node *nodes;
+    size_t node_count;
+    if (build_trie(b, &nodes, &node_count)) {
+        return 1;
+    }
+    size_t chars_size;
+    uint32_t *chars = build_chars(b, &chars_size);
+    if (!chars) {
+        free(nodes);
+        return 1;
+    }
+    void *bigram;
+    size_t bigram_size;
+    if (build_bigram(b, &bigram, &bigram_size)) {
+        free(nodes);
+        free(chars);
+        return 1;
+    }
+
+    size_t pathlen = strlen(path);
+    char *tmppath = (char *)malloc(pathlen + sizeof(".tmp"));
+    if (!tmppath) {
+        free(nodes);
+        free(chars);
+        free(bigram);
+        return 1;
+    }
+    memcpy(tmppath, path, pathlen);
+    memcpy(tmppath + pathlen, ".tmp", sizeof(".tmp"));
+
+    FILE *fp = fopen(tmppath, "wb");
+    if (!fp) {
+        free(tmppath);
+        free(nodes);
+        free(chars);
+        free(bigram);
+        return 1;
+    }
+    int err = write_image(b, fp, nodes, node_count, chars, chars_size,
+                          bigram, bigram_size);
+    err |= fclose(fp) != 0;
+    if (!err) {
+        err = rename(tmppath, path) != 0;
+    }
+    if (err) {
+        remove(tmppath);
+    }
+    free(tmppath);
+    free(nodes);
+    free(chars);
+    free(bigram);
+    return err;
+}
@@ -0,0 +1,85 @@
+#ifndef _ZYP_DICT_BUILDER_H
+#define _ZYP_DICT_BUILDER_H
+/**
+ * @file
+ * Build binary dictionary images, which are read by zyp_dict_open()
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A dictionary builder
+ * Phrases should be added in the order of their syllable sequences, so the
+ * builder only keeps the phrases of the current sequence in memory, and
+ * spills everything else to temporary files.
+ * @see zyp_dict_builder_new()
+ */
+struct zyp_dict_builder;
+
+/**
+ * @brief Create a new dictionary builder
+ *
+ * @retval NULL fail to allocate memory
+ * @return newly created builder
+ */
+struct zyp_dict_builder *zyp_dict_builder_new(void);
+
+/**
+ * @brief Free the builder
+ *
+ * @param b builder object
+ */
+void zyp_dict_builder_free(struct zyp_dict_builder *b);
+
+/**
+ * @brief Add a phrase
+ * The syllable sequence should be greater than or equal to the sequence of
+ * the last added phrase, sequences are compared syllable by syllable, and a
+ * prefix is less than the longer sequence.
+ * Adding the same text twice under a sequence keeps the higher frequency.
+ * Phrases are numbered from 0 in the order they are added, for
+ * zyp_dict_builder_add_bigram(), and the same text added twice under a
+ * sequence has two numbers of the same phrase.
+ *
+ * @param b builder object
+ * @param sylls syllable sequence
+ * @param len length of the sequence
+ * @param text UTF-8 text, not necessarily null terminated
+ * @param textlen size in bytes of the text
+ * @param frequency frequency of the phrase
+ * @return 0 if successful, 1 if out of order, a syllable is not legal, or
+ * fail to allocate memory
+ */
+int zyp_dict_builder_add(struct zyp_dict_builder *b, const uint16_t *sylls,
+                         size_t len, const char *text, size_t textlen,
+                         uint32_t frequency);
+
+/**
+ * @brief Add an occurrence count of a phrase pair
+ * The bigram scores are computed from the counts and the phrase frequencies
+ * when the image is written. The counts of the same pair are summed.
+ * @see zyp_dict_bigram()
+ *
+ * @param b builder object
+ * @param prev number of the previous phrase, see zyp_dict_builder_add()
+ * @param next number of the next phrase
+ * @param count number of times `next` follows `prev`
+ * @return 0 if successful, 1 if a phrase is not added yet or fail to
+ * allocate memory
+ */
+int zyp_dict_builder_add_bigram(struct zyp_dict_builder *b, uint32_t prev,
+                                uint32_t next, uint32_t count);
+
+/**
+ * @brief Write the dictionary image to a file
+ * The image is written to a temporary file next to the path first, and then
+ * renamed, so readers never see a partial file.
+ *
+ * @param b builder object
+ * @param path path to the dictionary file
+ * @return 0 if successful, 1 otherwise
+ */
+int zyp_dict_builder_write(struct zyp_dict_builder *b, const char *path);
+
+#endif
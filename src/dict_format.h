@@ -0,0 +1,132 @@
+#ifndef _ZYP_DICT_FORMAT_H
+#define _ZYP_DICT_FORMAT_H
+/**
+ * @file
+ * On-disk layout of the binary dictionary, shared by the reader and the
+ * builder.
+ *
+ * All integers are little-endian. The file begins with a header and a
+ * section directory, followed by the sections, each aligned to 8 bytes:
+ *
+ * | Tag    | Content                                                   |
+ * |--------|-----------------------------------------------------------|
+ * | `KEYS` | struct dict_key array, sorted by syllable sequence        |
+ * | `SYLL` | uint16_t syllable pool referenced by the keys             |
+ * | `PHRS` | struct zyp_dict_phrase array, grouped by key              |
+ * | `TEXT` | null terminated UTF-8 strings referenced by the phrases   |
+ * | `TRIE` | struct dict_trie_node array, a double-array trie of keys  |
+ * | `CHAR` | single charactors of each syllable, see DICT_TAG_CHAR     |
+ * | `STAT` | struct dict_stats                                         |
+ * | `BIGR` | bigram scores of phrase pairs, see DICT_TAG_BIGR          |
+ *
+ * Readers should ignore the sections they do not know, so new sections can
+ * be added without bumping the version.
+ */
+
+#include <stdint.h>
+
+#define DICT_MAGIC "ZYPDICT"
+#define DICT_VERSION 1
+#define DICT_ALIGN 8
+
+#define DICT_TAG(a, b, c, d) \
+    ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 \
+     | (uint32_t)(d) << 24)
+
+#define DICT_TAG_KEYS DICT_TAG('K', 'E', 'Y', 'S')
+#define DICT_TAG_SYLL DICT_TAG('S', 'Y', 'L', 'L')
+#define DICT_TAG_PHRS DICT_TAG('P', 'H', 'R', 'S')
+#define DICT_TAG_TEXT DICT_TAG('T', 'E', 'X', 'T')
+#define DICT_TAG_TRIE DICT_TAG('T', 'R', 'I', 'E')
+/**
+ * The charactor table is three uint32_t arrays:
+ * - `offsets[ZYP_SYLLABLE_INDEX_COUNT + 1]`, the charactors of the syllable
+ *   with dense index `i` are in `[offsets[i], offsets[i + 1])`
+ * - `chars[offsets[ZYP_SYLLABLE_INDEX_COUNT]]`, Unicode code points
+ * - `freqs[offsets[ZYP_SYLLABLE_INDEX_COUNT]]`, frequencies of the charactors
+ *
+ * The charactors of a syllable are sorted by frequency in descending order.
+ */
+#define DICT_TAG_CHAR DICT_TAG('C', 'H', 'A', 'R')
+#define DICT_TAG_STAT DICT_TAG('S', 'T', 'A', 'T')
+/**
+ * The bigram section begins with struct dict_bigram_header, followed by
+ * `bucket_count` uint16_t displacements padded to DICT_ALIGN, and
+ * `slot_count` uint32_t slots. See dict_bigram.h for the hash functions.
+ *
+ * A phrase pair hashes to a bucket, and the displacement of the bucket
+ * chooses its slot, so every pair has a slot of its own. A slot holds a
+ * 24-bit fingerprint of the pair in the high bits, to reject the pairs not
+ * in the table, and an 8-bit code of the score in the low bits. The
+ * fingerprint of an empty slot is 0.
+ */
+#define DICT_TAG_BIGR DICT_TAG('B', 'I', 'G', 'R')
+
+/** Mark of the free trie nodes, and the parent of the root */
+#define DICT_TRIE_NONE UINT32_MAX
+/** Label of the end of a key, the syllables are labeled by dense index + 1 */
+#define DICT_TRIE_END 0
+
+struct dict_header {
+    /** "ZYPDICT" and a null charactor */
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    /** Size of the whole file, to detect truncation */
+    uint64_t file_size;
+};
+
+struct dict_section {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct dict_key {
+    /** Position of the first syllable in the syllable pool */
+    uint32_t syll_offset;
+    uint16_t syll_count;
+    uint16_t reserved;
+    /** Position of the first phrase in the phrase array */
+    uint32_t phrase_first;
+    uint32_t phrase_count;
+};
+
+struct dict_stats {
+    /** Sum of the phrase frequencies, to turn them into probabilities */
+    uint64_t total_frequency;
+    uint64_t reserved;
+};
+
+struct dict_bigram_header {
+    uint64_t seed;
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    /** Score of code `c` is `base + c * step` */
+    int32_t base;
+    int32_t step;
+};
+
+/**
+ * A node of the double-array trie, the root is node 0.
+ * The child of node `s` with label `c` is node `t = s.base + c` if
+ * `t.check == s`. The child labeled DICT_TRIE_END is a leaf, and its `base`
+ * is the index of the key instead.
+ */
+struct dict_trie_node {
+    uint32_t base;
+    uint32_t check;
+};
+
+/**
+ * Check if the host stores integers in little-endian, which is required to
+ * access the mapping directly
+ */
+static inline int dict_host_is_le(void)
+{
+    const uint16_t probe = 1;
+    return *(const unsigned char *)&probe == 1;
+}
+
+#endif
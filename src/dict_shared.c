@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <zyphtine/dict.h>
+#include "spinlock.h"
+
+#include <stdlib.h>
+
+struct zyp_dict_shared {
+    struct zyp_dict *current;
+    uint64_t version;
+    /**
+     * Readers between announcing themselves and taking the reference, in
+     * two groups, so a publisher waits for a group which new readers do not
+     * join
+     */
+    uint32_t readers[2];
+    /** Group of the new readers */
+    uint32_t group;
+    /** A publisher is running */
+    uint32_t publishing;
+};
+
+// Wait for the readers of a group to take their references
+static void shared_wait_group(struct zyp_dict_shared *shared, uint32_t group)
+{
+    unsigned spins = 0;
+    while (__atomic_load_n(&shared->readers[group], __ATOMIC_ACQUIRE)) {
+        zyp_spin_wait(&spins);
+    }
+}
+
+struct zyp_dict_shared *zyp_dict_shared_new(struct zyp_dict *dict)
+{
+    if (!dict) {
+        return NULL;
+    }
+    struct zyp_dict_shared *shared = calloc(1, sizeof(*shared));
+    if (!shared) {
+        return NULL;
+    }
+    shared->current = dict;
+    return shared;
+}
+
+void zyp_dict_shared_free(struct zyp_dict_shared *shared)
+{
+    if (!shared) {
+        return;
+    }
+    zyp_dict_close(shared->current);
+    free(shared);
+}
+
+void zyp_dict_shared_publish(struct zyp_dict_shared *shared,
+                             struct zyp_dict *dict)
+{
+    if (!shared || !dict) {
+        return;
+    }
+    zyp_spin_lock(&shared->publishing);
+
+    // The version follows the pointer, so a reader seeing the new version
+    // sees the new dictionary
+    struct zyp_dict *old = __atomic_exchange_n(&shared->current, dict,
+                                               __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&shared->version, 1, __ATOMIC_SEQ_CST);
+
+    // A reader announced after its group is waited for loads the new
+    // pointer. Both groups are waited for, since a slow reader may join the
+    // group it read long ago, and each is waited for while the new readers
+    // join the other one.
+    uint32_t group = __atomic_fetch_xor(&shared->group, 1, __ATOMIC_SEQ_CST)
+                     & 1;
+    shared_wait_group(shared, group);
+    __atomic_fetch_xor(&shared->group, 1, __ATOMIC_SEQ_CST);
+    shared_wait_group(shared, group ^ 1);
+
+    zyp_dict_close(old);
+    zyp_spin_unlock(&shared->publishing);
+}
+
+struct zyp_dict *zyp_dict_shared_get(struct zyp_dict_shared *shared,
+                                     uint64_t *version)
+{
+    if (!shared) {
+        return NULL;
+    }
+    uint32_t group = __atomic_load_n(&shared->group, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&shared->readers[group], 1, __ATOMIC_SEQ_CST);
+    if (version) {
+        *version = __atomic_load_n(&shared->version, __ATOMIC_SEQ_CST);
+    }
+    struct zyp_dict *dict = zyp_dict_ref(
+        __atomic_load_n(&shared->current, __ATOMIC_SEQ_CST));
+    __atomic_sub_fetch(&shared->readers[group], 1, __ATOMIC_RELEASE);
+    return dict;
+}
+
+uint64_t zyp_dict_shared_version(const struct zyp_dict_shared *shared)
+{
+    if (!shared) {
+        return 0;
+    }
+    return __atomic_load_n(&shared->version, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,256 @@
+#include "dict_trie.h"
+
+#include <zyphtine/syllable.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LABEL_COUNT (ZYP_SYLLABLE_INDEX_COUNT + 1)
+#define LABEL_INVALID UINT32_MAX
+/** Buckets of the child counts, by log2 */
+#define WIDTH_BUCKETS 13
+
+struct trie_builder {
+    struct dict_trie_node *nodes;
+    /** Whether a node is taken, which is faster to scan than the nodes */
+    unsigned char *used;
+    /** One past the last taken node */
+    size_t length;
+    size_t capacity;
+    /** Where to search for free nodes, the nodes before it are mostly taken */
+    size_t first_free;
+    /**
+     * Where the last node of a width bucket fits. Nodes are never freed, so
+     * a wide node hardly fits before the previous one of the similar width.
+     */
+    size_t width_hint[WIDTH_BUCKETS];
+};
+
+// A subtree to place, holding the keys in [lo, hi) sharing `depth` labels
+struct trie_task {
+    uint32_t node;
+    uint32_t depth;
+    size_t lo;
+    size_t hi;
+};
+
+// Keys in [lo, hi) having the same label at a depth
+struct trie_group {
+    uint32_t label;
+    size_t lo;
+    size_t hi;
+};
+
+static int trie_reserve(struct trie_builder *tb, size_t size)
+{
+    if (size <= tb->capacity) {
+        return 0;
+    }
+    if (size >= DICT_TRIE_NONE) {
+        return 1;
+    }
+    size_t capacity = tb->capacity ? tb->capacity : 4096;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    struct dict_trie_node *nodes = (struct dict_trie_node *)realloc(
+        tb->nodes, capacity * sizeof(struct dict_trie_node));
+    if (!nodes) {
+        return 1;
+    }
+    tb->nodes = nodes;
+    unsigned char *used = (unsigned char *)realloc(tb->used, capacity);
+    if (!used) {
+        return 1;
+    }
+    tb->used = used;
+
+    for (size_t i = tb->capacity; i < capacity; i++) {
+        tb->nodes[i] = (struct dict_trie_node){ 0, DICT_TRIE_NONE };
+    }
+    memset(tb->used + tb->capacity, 0, capacity - tb->capacity);
+    tb->capacity = capacity;
+    return 0;
+}
+
+static inline uint32_t key_label(const struct dict_key *key,
+                                 const uint16_t *sylls, uint32_t depth)
+{
+    if (key->syll_count == depth) {
+        return DICT_TRIE_END;
+    }
+    uint16_t index = zyp_syllable_to_index(sylls[key->syll_offset + depth]);
+    if (index == ZYP_SYLLABLE_INDEX_INVALID) {
+        return LABEL_INVALID;
+    }
+    return (uint32_t)index + 1;
+}
+
+static inline size_t next_free(const struct trie_builder *tb, size_t pos)
+{
+    if (pos >= tb->length) {
+        return pos;
+    }
+    const unsigned char *p = memchr(tb->used + pos, 0, tb->length - pos);
+    return p ? (size_t)(p - tb->used) : tb->length;
+}
+
+// First fit: anchor the smallest label at each free node until all fit
+static int trie_find_base(struct trie_builder *tb,
+                          const struct trie_group *groups, size_t n,
+                          size_t *base)
+{
+    const uint32_t first = groups[0].label, last = groups[n - 1].label;
+    size_t bucket = 0;
+    while ((n >> bucket) > 1 && bucket < WIDTH_BUCKETS - 1) {
+        bucket++;
+    }
+    size_t start = tb->first_free;
+    if (start < tb->width_hint[bucket]) {
+        start = tb->width_hint[bucket];
+    }
+    start = next_free(tb, start > first ? start : first);
+    size_t pos = start, tried = 0;
+    for (;; pos = next_free(tb, pos + 1)) {
+        size_t b = pos - first;
+        if (trie_reserve(tb, b + last + 1)) {
+            return 1;
+        }
+        tried++;
+        bool fit = true;
+        for (size_t i = 1; i < n && fit; i++) {
+            fit = !tb->used[b + groups[i].label];
+        }
+        if (fit) {
+            break;
+        }
+    }
+
+    // Give up the holes of a dense area, otherwise every search scans them
+    size_t span = pos - start + 1;
+    if (!bucket && (span - tried) * 20 >= span * 19) {
+        tb->first_free = pos;
+    }
+    tb->width_hint[bucket] = pos;
+    *base = pos - first;
+    return 0;
+}
+
+static int trie_place(struct trie_builder *tb, const struct trie_task *task,
+                      const struct dict_key *keys, const uint16_t *sylls,
+                      struct trie_group *groups, struct trie_task **stack,
+                      size_t *stack_length, size_t *stack_capacity)
+{
+    // The keys are sorted, so the keys with the same label are adjacent
+    size_t n = 0;
+    for (size_t i = task->lo; i < task->hi;) {
+        uint32_t label = key_label(&keys[i], sylls, task->depth);
+        if (label == LABEL_INVALID || (n && label <= groups[n - 1].label)) {
+            return 1;
+        }
+        size_t j = i + 1;
+        while (j < task->hi
+                && key_label(&keys[j], sylls, task->depth) == label) {
+            j++;
+        }
+        // Duplicated keys
+        if (label == DICT_TRIE_END && j - i > 1) {
+            return 1;
+        }
+        groups[n++] = (struct trie_group){ label, i, j };
+        i = j;
+    }
+
+    size_t base;
+    if (trie_find_base(tb, groups, n, &base)) {
+        return 1;
+    }
+    tb->nodes[task->node].base = (uint32_t)base;
+
+    if (*stack_length + n > *stack_capacity) {
+        size_t capacity = *stack_capacity ? *stack_capacity * 2 : 256;
+        while (capacity < *stack_length + n) {
+            capacity *= 2;
+        }
+        struct trie_task *grown = (struct trie_task *)realloc(
+            *stack, capacity * sizeof(struct trie_task));
+        if (!grown) {
+            return 1;
+        }
+        *stack = grown;
+        *stack_capacity = capacity;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        size_t t = base + groups[i].label;
+        tb->used[t] = 1;
+        tb->nodes[t].check = task->node;
+        if (t >= tb->length) {
+            tb->length = t + 1;
+        }
+        if (groups[i].label == DICT_TRIE_END) {
+            tb->nodes[t].base = (uint32_t)groups[i].lo;
+        } else {
+            (*stack)[(*stack_length)++] = (struct trie_task){
+                .node = (uint32_t)t,
+                .depth = task->depth + 1,
+                .lo = groups[i].lo,
+                .hi = groups[i].hi,
+            };
+        }
+    }
+    tb->first_free = next_free(tb, tb->first_free);
+    return 0;
+}
+
+int dict_trie_build(const struct dict_key *keys, size_t count,
+                    const uint16_t *sylls, struct dict_trie_node **nodes,
+                    size_t *node_count)
+{
+    if (count >= DICT_TRIE_NONE) {
+        return 1;
+    }
+
+    struct trie_builder tb = { 0 };
+    struct trie_group *groups =
+        (struct trie_group *)malloc(LABEL_COUNT * sizeof(struct trie_group));
+    struct trie_task *stack = NULL;
+    size_t stack_length = 0, stack_capacity = 0;
+    int err = 1;
+    if (!groups || trie_reserve(&tb, 1)) {
+        goto out;
+    }
+
+    // The root
+    tb.used[0] = 1;
+    tb.length = 1;
+    tb.first_free = 1;
+    if (count) {
+        const struct trie_task root = { .node = 0, .depth = 0, .lo = 0,
+                                        .hi = count };
+        if (trie_place(&tb, &root, keys, sylls, groups, &stack,
+                       &stack_length, &stack_capacity)) {
+            goto out;
+        }
+    }
+    while (stack_length) {
+        struct trie_task task = stack[--stack_length];
+        if (trie_place(&tb, &task, keys, sylls, groups, &stack,
+                       &stack_length, &stack_capacity)) {
+            goto out;
+        }
+    }
+
+    *nodes = tb.nodes;
+    *node_count = tb.length;
+    tb.nodes = NULL;
+    err = 0;
+
+out:
+    free(tb.nodes);
+    free(tb.used);
+    free(groups);
+    free(stack);
+    return err;
+}
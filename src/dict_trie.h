@@ -0,0 +1,29 @@
+#ifndef _ZYP_DICT_TRIE_H
+#define _ZYP_DICT_TRIE_H
+/**
+ * @file
+ * Build the double-array trie of the dictionary keys
+ */
+
+#include "dict_format.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Build a double-array trie of the keys
+ * The keys should be sorted and unique, and their syllables should be legal.
+ *
+ * @param keys sorted key array
+ * @param count number of keys
+ * @param sylls syllable pool referenced by the keys
+ * @param nodes where to store the newly allocated node array
+ * @param node_count where to store the number of nodes
+ * @return 0 if successful, 1 if the keys are not valid or fail to allocate
+ * memory
+ */
+int dict_trie_build(const struct dict_key *keys, size_t count,
+                    const uint16_t *sylls, struct dict_trie_node **nodes,
+                    size_t *node_count);
+
+#endif
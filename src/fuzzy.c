@@ -0,0 +1,242 @@
+#include <zyphtine/fuzzy.h>
+#include <zyphtine/syllable.h>
+#include "cpu.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if ZYP_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define BATCH_KEYS 64
+#define MAX_RULES 5
+#define MAX_LANES 16
+
+// Flip the field to the representative if it equals `from`
+struct fuzzy_rule {
+    uint16_t field;
+    uint16_t from;
+    uint16_t flip;
+};
+
+struct fuzzy_params {
+    /** Bits kept before applying the rules */
+    uint16_t keep;
+    int nrules;
+    struct fuzzy_rule rules[MAX_RULES];
+};
+
+static const struct {
+    unsigned flag;
+    uint16_t field;
+    uint16_t from;
+    uint16_t to;
+} FUZZY_PAIRS[MAX_RULES] = {
+    { ZYP_FUZZY_ZH_Z, ZYP_SYLLABLE_INITIAL(0xFFFF),
+      ZYP_BOPOMOFO_ZH, ZYP_BOPOMOFO_Z },
+    { ZYP_FUZZY_CH_C, ZYP_SYLLABLE_INITIAL(0xFFFF),
+      ZYP_BOPOMOFO_CH, ZYP_BOPOMOFO_C },
+    { ZYP_FUZZY_SH_S, ZYP_SYLLABLE_INITIAL(0xFFFF),
+      ZYP_BOPOMOFO_SH, ZYP_BOPOMOFO_S },
+    { ZYP_FUZZY_AN_ANG, ZYP_SYLLABLE_RHYME(0xFFFF),
+      ZYP_BOPOMOFO_ANG, ZYP_BOPOMOFO_AN },
+    { ZYP_FUZZY_EN_ENG, ZYP_SYLLABLE_RHYME(0xFFFF),
+      ZYP_BOPOMOFO_ENG, ZYP_BOPOMOFO_EN },
+};
+
+// Compare `n` keys with the repeating pattern, set a bit for each equal one
+typedef void (*eq_kernel)(const uint16_t *keys, size_t n,
+                          const uint16_t *pattern, size_t len,
+                          const struct fuzzy_params *fp, uint64_t *bits);
+
+static void fuzzy_params_init(struct fuzzy_params *fp, unsigned fuzzy)
+{
+    fp->keep = (fuzzy & ZYP_FUZZY_TONE) ? (uint16_t)~ZYP_SYLLABLE_TONE(0xFFFF)
+                                        : (uint16_t)0xFFFF;
+    fp->nrules = 0;
+    for (int i = 0; i < MAX_RULES; i++) {
+        if (fuzzy & FUZZY_PAIRS[i].flag) {
+            struct fuzzy_rule *r = &fp->rules[fp->nrules++];
+            r->field = FUZZY_PAIRS[i].field;
+            r->from = FUZZY_PAIRS[i].from;
+            r->flip = FUZZY_PAIRS[i].from ^ FUZZY_PAIRS[i].to;
+        }
+    }
+}
+
+static inline uint16_t fuzzy_apply(uint16_t syll, const struct fuzzy_params *fp)
+{
+    syll &= fp->keep;
+    for (int i = 0; i < fp->nrules; i++) {
+        const struct fuzzy_rule *r = &fp->rules[i];
+        if ((syll & r->field) == r->from) {
+            syll ^= r->flip;
+        }
+    }
+    return syll;
+}
+
+static void eq_bits_scalar_from(const uint16_t *keys, size_t i, size_t n,
+                                const uint16_t *pattern, size_t phase,
+                                size_t len, const struct fuzzy_params *fp,
+                                uint64_t *bits)
+{
+    for (; i < n; i++) {
+        if (fuzzy_apply(keys[i], fp) == pattern[phase]) {
+            bits[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        if (++phase == len) {
+            phase = 0;
+        }
+    }
+}
+
+static void eq_bits_scalar(const uint16_t *keys, size_t n,
+                           const uint16_t *pattern, size_t len,
+                           const struct fuzzy_params *fp, uint64_t *bits)
+{
+    eq_bits_scalar_from(keys, 0, n, pattern, 0, len, fp, bits);
+}
+
+#if ZYP_HAVE_X86_SIMD
+ZYP_TARGET("sse2")
+static void eq_bits_sse2(const uint16_t *keys, size_t n,
+                         const uint16_t *pattern, size_t len,
+                         const struct fuzzy_params *fp, uint64_t *bits)
+{
+    __m128i keep = _mm_set1_epi16((short)fp->keep);
+    __m128i field[MAX_RULES], from[MAX_RULES], flip[MAX_RULES];
+    for (int r = 0; r < fp->nrules; r++) {
+        field[r] = _mm_set1_epi16((short)fp->rules[r].field);
+        from[r] = _mm_set1_epi16((short)fp->rules[r].from);
+        flip[r] = _mm_set1_epi16((short)fp->rules[r].flip);
+    }
+
+    size_t i = 0, phase = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(keys + i));
+        v = _mm_and_si128(v, keep);
+        for (int r = 0; r < fp->nrules; r++) {
+            __m128i hit = _mm_cmpeq_epi16(_mm_and_si128(v, field[r]), from[r]);
+            v = _mm_xor_si128(v, _mm_and_si128(hit, flip[r]));
+        }
+        __m128i p = _mm_loadu_si128((const __m128i *)(pattern + phase));
+        __m128i eq = _mm_cmpeq_epi16(v, p);
+        unsigned m = (unsigned)_mm_movemask_epi8(
+                _mm_packs_epi16(eq, _mm_setzero_si128()));
+        bits[i / 64] |= (uint64_t)m << (i % 64);
+        phase = (phase + 8) % len;
+    }
+    eq_bits_scalar_from(keys, i, n, pattern, phase, len, fp, bits);
+}
+
+ZYP_TARGET("avx2")
+static void eq_bits_avx2(const uint16_t *keys, size_t n,
+                         const uint16_t *pattern, size_t len,
+                         const struct fuzzy_params *fp, uint64_t *bits)
+{
+    __m256i keep = _mm256_set1_epi16((short)fp->keep);
+    __m256i field[MAX_RULES], from[MAX_RULES], flip[MAX_RULES];
+    for (int r = 0; r < fp->nrules; r++) {
+        field[r] = _mm256_set1_epi16((short)fp->rules[r].field);
+        from[r] = _mm256_set1_epi16((short)fp->rules[r].from);
+        flip[r] = _mm256_set1_epi16((short)fp->rules[r].flip);
+    }
+
+    size_t i = 0, phase = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(keys + i));
+        v = _mm256_and_si256(v, keep);
+        for (int r = 0; r < fp->nrules; r++) {
+            __m256i hit = _mm256_cmpeq_epi16(_mm256_and_si256(v, field[r]),
+                                             from[r]);
+            v = _mm256_xor_si256(v, _mm256_and_si256(hit, flip[r]));
+        }
+        __m256i p = _mm256_loadu_si256((const __m256i *)(pattern + phase));
+        __m256i eq = _mm256_cmpeq_epi16(v, p);
+        __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(eq),
+                                         _mm256_extracti128_si256(eq, 1));
+        unsigned m = (unsigned)_mm_movemask_epi8(packed);
+        bits[i / 64] |= (uint64_t)m << (i % 64);
+        phase = (phase + 16) % len;
+    }
+    eq_bits_scalar_from(keys, i, n, pattern, phase, len, fp, bits);
+}
+#endif
+
+static eq_kernel select_kernel(void)
+{
+#if ZYP_HAVE_X86_SIMD
+    unsigned features = zyp_cpu_features();
+    if (features & ZYP_CPU_AVX2) {
+        return eq_bits_avx2;
+    }
+    if (features & ZYP_CPU_SSE2) {
+        return eq_bits_sse2;
+    }
+#endif
+    return eq_bits_scalar;
+}
+
+// Check if all bits in [start, start + len) are set, len is at most 64
+static inline bool bits_all_set(const uint64_t *bits, size_t start, size_t len)
+{
+    size_t word = start / 64, shift = start % 64;
+    uint64_t w = bits[word] >> shift;
+    if (shift + len > 64) {
+        w |= bits[word + 1] << (64 - shift);
+    }
+    uint64_t want = (len == 64) ? ~(uint64_t)0 : ((uint64_t)1 << len) - 1;
+    return (w & want) == want;
+}
+
+uint16_t zyp_fuzzy_normalize(uint16_t syll, unsigned fuzzy)
+{
+    struct fuzzy_params fp;
+    fuzzy_params_init(&fp, fuzzy);
+    return fuzzy_apply(syll, &fp);
+}
+
+size_t zyp_fuzzy_match(const uint16_t *query, size_t len,
+                       const uint16_t *keys, size_t count, unsigned fuzzy,
+                       uint32_t *matches, size_t cap)
+{
+    if (!query || !keys || !matches || !len || len > ZYP_FUZZY_MAX_LENGTH) {
+        return 0;
+    }
+
+    struct fuzzy_params fp;
+    fuzzy_params_init(&fp, fuzzy);
+
+    // The query repeated, so a vector at any phase can be loaded directly
+    uint16_t pattern[ZYP_FUZZY_MAX_LENGTH + MAX_LANES];
+    for (size_t i = 0; i < len + MAX_LANES; i++) {
+        pattern[i] = fuzzy_apply(query[i % len], &fp);
+    }
+
+    eq_kernel kernel = select_kernel();
+    // One bit per syllable of a batch
+    uint64_t bits[ZYP_FUZZY_MAX_LENGTH * BATCH_KEYS / 64];
+    size_t found = 0;
+    for (size_t base = 0; base < count && found < cap; base += BATCH_KEYS) {
+        size_t nkeys = count - base < BATCH_KEYS ? count - base : BATCH_KEYS;
+        memset(bits, 0, sizeof(uint64_t) * (len * BATCH_KEYS / 64));
+        kernel(keys + base * len, nkeys * len, pattern, len, &fp, bits);
+
+        if (cap - found >= nkeys) {
+            // Enough room for the whole batch, store without branching
+            for (size_t k = 0; k < nkeys; k++) {
+                matches[found] = (uint32_t)(base + k);
+                found += bits_all_set(bits, k * len, len);
+            }
+            continue;
+        }
+        for (size_t k = 0; k < nkeys && found < cap; k++) {
+            if (bits_all_set(bits, k * len, len)) {
+                matches[found++] = (uint32_t)(base + k);
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file
+ * Build time generator of the legal syllable tables used by syllable.c
+ *
+ * Usage: gen-syllable-table <output header>
+ */
+#include <zyphtine/syllable.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SYLLABLE_SPACE 0x4000
+#define TONE_SLOTS 6
+#define END 0xFFFF
+
+// Finals(韻) as medial and rhyme combinations
+#define NONE    0
+#define A       ZYP_BOPOMOFO_A
+#define O       ZYP_BOPOMOFO_O
+#define E       ZYP_BOPOMOFO_E
+#define EH      ZYP_BOPOMOFO_EH
+#define AI      ZYP_BOPOMOFO_AI
+#define EI      ZYP_BOPOMOFO_EI
+#define AU      ZYP_BOPOMOFO_AU
+#define OU      ZYP_BOPOMOFO_OU
+#define AN      ZYP_BOPOMOFO_AN
+#define EN      ZYP_BOPOMOFO_EN
+#define ANG     ZYP_BOPOMOFO_ANG
+#define ENG     ZYP_BOPOMOFO_ENG
+#define ER      ZYP_BOPOMOFO_ER
+#define I       ZYP_BOPOMOFO_I
+#define IA      (ZYP_BOPOMOFO_I | A)
+#define IO      (ZYP_BOPOMOFO_I | O)
+#define IE      (ZYP_BOPOMOFO_I | EH)
+#define IAI     (ZYP_BOPOMOFO_I | AI)
+#define IAU     (ZYP_BOPOMOFO_I | AU)
+#define IOU     (ZYP_BOPOMOFO_I | OU)
+#define IAN     (ZYP_BOPOMOFO_I | AN)
+#define IN      (ZYP_BOPOMOFO_I | EN)
+#define IANG    (ZYP_BOPOMOFO_I | ANG)
+#define ING     (ZYP_BOPOMOFO_I | ENG)
+#define U       ZYP_BOPOMOFO_U
+#define UA      (ZYP_BOPOMOFO_U | A)
+#define UO      (ZYP_BOPOMOFO_U | O)
+#define UAI     (ZYP_BOPOMOFO_U | AI)
+#define UEI     (ZYP_BOPOMOFO_U | EI)
+#define UAN     (ZYP_BOPOMOFO_U | AN)
+#define UEN     (ZYP_BOPOMOFO_U | EN)
+#define UANG    (ZYP_BOPOMOFO_U | ANG)
+#define UENG    (ZYP_BOPOMOFO_U | ENG)
+#define YU      ZYP_BOPOMOFO_YU
+#define YUE     (ZYP_BOPOMOFO_YU | EH)
+#define YUAN    (ZYP_BOPOMOFO_YU | AN)
+#define YUN     (ZYP_BOPOMOFO_YU | EN)
+#define YUNG    (ZYP_BOPOMOFO_YU | ENG)
+
+struct initial_finals {
+    uint16_t initial;
+    uint16_t finals[40];
+};
+
+// Standard Mandarin syllables, in Zhuyin
+static const struct initial_finals SYLLABLES[] = {
+    { 0, { A, O, E, EH, AI, EI, AU, OU, AN, EN, ANG, ENG, ER,
+           I, IA, IO, IE, IAI, IAU, IOU, IAN, IN, IANG, ING,
+           U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG,
+           YU, YUE, YUAN, YUN, YUNG, END } },
+    { ZYP_BOPOMOFO_B, { A, O, AI, EI, AU, AN, EN, ANG, ENG,
+                        I, IE, IAU, IAN, IN, ING, U, END } },
+    { ZYP_BOPOMOFO_P, { A, O, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        I, IE, IAU, IAN, IN, ING, U, END } },
+    { ZYP_BOPOMOFO_M, { A, O, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        I, IE, IAU, IOU, IAN, IN, ING, U, END } },
+    { ZYP_BOPOMOFO_F, { A, O, EI, OU, AN, EN, ANG, ENG, U, END } },
+    { ZYP_BOPOMOFO_D, { A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        I, IA, IE, IAU, IOU, IAN, ING,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+    { ZYP_BOPOMOFO_T, { A, E, AI, AU, OU, AN, ANG, ENG,
+                        I, IE, IAU, IAN, ING,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+    { ZYP_BOPOMOFO_N, { A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        I, IE, IAU, IOU, IAN, IN, IANG, ING,
+                        U, UO, UAN, UENG, YU, YUE, END } },
+    { ZYP_BOPOMOFO_L, { A, O, E, AI, EI, AU, OU, AN, ANG, ENG,
+                        I, IA, IE, IAU, IOU, IAN, IN, IANG, ING,
+                        U, UO, UAN, UEN, UENG, YU, YUE, END } },
+    { ZYP_BOPOMOFO_G, { A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG, END } },
+    { ZYP_BOPOMOFO_K, { A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG, END } },
+    { ZYP_BOPOMOFO_H, { A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG, END } },
+    { ZYP_BOPOMOFO_J, { I, IA, IE, IAU, IOU, IAN, IN, IANG, ING,
+                        YU, YUE, YUAN, YUN, YUNG, END } },
+    { ZYP_BOPOMOFO_Q, { I, IA, IE, IAU, IOU, IAN, IN, IANG, ING,
+                        YU, YUE, YUAN, YUN, YUNG, END } },
+    { ZYP_BOPOMOFO_X, { I, IA, IE, IAU, IOU, IAN, IN, IANG, ING,
+                        YU, YUE, YUAN, YUN, YUNG, END } },
+    { ZYP_BOPOMOFO_ZH, { NONE, A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                         U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG, END } },
+    { ZYP_BOPOMOFO_CH, { NONE, A, E, AI, AU, OU, AN, EN, ANG, ENG,
+                         U, UA, UO, UAI, UEI, UAN, UEN, UANG, UENG, END } },
+    { ZYP_BOPOMOFO_SH, { NONE, A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                         U, UA, UO, UAI, UEI, UAN, UEN, UANG, END } },
+    { ZYP_BOPOMOFO_R, { NONE, E, AU, OU, AN, EN, ANG, ENG,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+    { ZYP_BOPOMOFO_Z, { NONE, A, E, AI, EI, AU, OU, AN, EN, ANG, ENG,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+    { ZYP_BOPOMOFO_C, { NONE, A, E, AI, AU, OU, AN, EN, ANG, ENG,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+    { ZYP_BOPOMOFO_S, { NONE, A, E, AI, AU, OU, AN, EN, ANG, ENG,
+                        U, UO, UEI, UAN, UEN, UENG, END } },
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output header>\n", argv[0]);
+        return 1;
+    }
+
+    static bool legal_base[SYLLABLE_SPACE];
+    for (size_t i = 0; i < sizeof(SYLLABLES) / sizeof(SYLLABLES[0]); i++) {
+        const struct initial_finals *entry = &SYLLABLES[i];
+        for (const uint16_t *f = entry->finals; *f != END; f++) {
+            uint16_t base = entry->initial | *f;
+            if (!base || legal_base[base]) {
+                fprintf(stderr, "bad syllable entry 0x%04x\n", base);
+                return 1;
+            }
+            legal_base[base] = true;
+        }
+    }
+
+    // Bases are enumerated in ascending order and the tone takes the lowest
+    // bits, so the dense index keeps the numeric order of syllables.
+    static uint16_t to_index[SYLLABLE_SPACE];
+    static uint16_t from_index[SYLLABLE_SPACE];
+    static uint64_t bits[SYLLABLE_SPACE / 64];
+    unsigned count = 0;
+    for (unsigned syll = 0; syll < SYLLABLE_SPACE; syll++) {
+        to_index[syll] = ZYP_SYLLABLE_INDEX_INVALID;
+        if (legal_base[syll & ~0x0007u] && (syll & 0x0007u) < TONE_SLOTS) {
+            to_index[syll] = (uint16_t)count;
+            from_index[count++] = (uint16_t)syll;
+            bits[syll / 64] |= (uint64_t)1 << (syll % 64);
+        }
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by gen_syllable_table.c, do not edit\n\n");
+    fprintf(out, "#if ZYP_SYLLABLE_INDEX_COUNT != %u\n", count);
+    fprintf(out, "#error \"ZYP_SYLLABLE_INDEX_COUNT should be %u\"\n", count);
+    fprintf(out, "#endif\n\n");
+
+    fprintf(out, "static const uint64_t LEGAL_SYLLABLE_BITS[%d] = {\n",
+            SYLLABLE_SPACE / 64);
+    for (unsigned i = 0; i < SYLLABLE_SPACE / 64; i++) {
+        fprintf(out, "%s0x%016llxu,%s", (i % 4) ? " " : "    ",
+                (unsigned long long)bits[i], (i % 4 == 3) ? "\n" : "");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const uint16_t SYLLABLE_TO_INDEX[%d] = {\n",
+            SYLLABLE_SPACE);
+    for (unsigned i = 0; i < SYLLABLE_SPACE; i++) {
+        fprintf(out, "%s0x%04x,%s", (i % 8) ? " " : "    ",
+                to_index[i], (i % 8 == 7) ? "\n" : "");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const uint16_t SYLLABLE_FROM_INDEX[%u] = {\n",
+            count);
+    for (unsigned i = 0; i < count; i++) {
+        fprintf(out, "%s0x%04x,%s", (i % 8) ? " " : "    ",
+                from_index[i], (i % 8 == 7 || i == count - 1) ? "\n" : "");
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out)) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include <zyphtine/keyboard.h>
+#include <zyphtine/syllable.h>
+
+#include <stddef.h>
+
+#define KEY_COUNT 128
+#define KEY_CANDIDATES 2
+
+// Here are the hidden structure definition
+struct zyp_keymap {
+    /** Symbols of each key, in the order of preference */
+    uint16_t keys[KEY_COUNT][KEY_CANDIDATES];
+    /** Replacement of an initial when followed by ㄧ or ㄩ, index by initial */
+    uint16_t palatals[22];
+    /** The initial which becomes ㄦ if a tone follows it directly */
+    uint16_t alone_initial;
+};
+
+#define INITIAL_INDEX(init) ((init) >> 9)
+
+static const struct zyp_keymap KEYMAP_STANDARD = {
+    .keys = {
+        ['1'] = { ZYP_BOPOMOFO_B },   ['q'] = { ZYP_BOPOMOFO_P },
+        ['a'] = { ZYP_BOPOMOFO_M },   ['z'] = { ZYP_BOPOMOFO_F },
+        ['2'] = { ZYP_BOPOMOFO_D },   ['w'] = { ZYP_BOPOMOFO_T },
+        ['s'] = { ZYP_BOPOMOFO_N },   ['x'] = { ZYP_BOPOMOFO_L },
+        ['e'] = { ZYP_BOPOMOFO_G },   ['d'] = { ZYP_BOPOMOFO_K },
+        ['c'] = { ZYP_BOPOMOFO_H },   ['r'] = { ZYP_BOPOMOFO_J },
+        ['f'] = { ZYP_BOPOMOFO_Q },   ['v'] = { ZYP_BOPOMOFO_X },
+        ['5'] = { ZYP_BOPOMOFO_ZH },  ['t'] = { ZYP_BOPOMOFO_CH },
+        ['g'] = { ZYP_BOPOMOFO_SH },  ['b'] = { ZYP_BOPOMOFO_R },
+        ['y'] = { ZYP_BOPOMOFO_Z },   ['h'] = { ZYP_BOPOMOFO_C },
+        ['n'] = { ZYP_BOPOMOFO_S },
+        ['u'] = { ZYP_BOPOMOFO_I },   ['j'] = { ZYP_BOPOMOFO_U },
+        ['m'] = { ZYP_BOPOMOFO_YU },
+        ['8'] = { ZYP_BOPOMOFO_A },   ['i'] = { ZYP_BOPOMOFO_O },
+        ['k'] = { ZYP_BOPOMOFO_E },   [','] = { ZYP_BOPOMOFO_EH },
+        ['9'] = { ZYP_BOPOMOFO_AI },  ['o'] = { ZYP_BOPOMOFO_EI },
+        ['l'] = { ZYP_BOPOMOFO_AU },  ['.'] = { ZYP_BOPOMOFO_OU },
+        ['0'] = { ZYP_BOPOMOFO_AN },  ['p'] = { ZYP_BOPOMOFO_EN },
+        [';'] = { ZYP_BOPOMOFO_ANG }, ['/'] = { ZYP_BOPOMOFO_ENG },
+        ['-'] = { ZYP_BOPOMOFO_ER },
+        [' '] = { ZYP_TONE_1 },       ['6'] = { ZYP_TONE_2 },
+        ['3'] = { ZYP_TONE_3 },       ['4'] = { ZYP_TONE_4 },
+        ['7'] = { ZYP_TONE_5 },
+    },
+};
+
+static const struct zyp_keymap KEYMAP_ETEN = {
+    .keys = {
+        ['b'] = { ZYP_BOPOMOFO_B },   ['p'] = { ZYP_BOPOMOFO_P },
+        ['m'] = { ZYP_BOPOMOFO_M },   ['f'] = { ZYP_BOPOMOFO_F },
+        ['d'] = { ZYP_BOPOMOFO_D },   ['t'] = { ZYP_BOPOMOFO_T },
+        ['n'] = { ZYP_BOPOMOFO_N },   ['l'] = { ZYP_BOPOMOFO_L },
+        ['v'] = { ZYP_BOPOMOFO_G },   ['k'] = { ZYP_BOPOMOFO_K },
+        ['h'] = { ZYP_BOPOMOFO_H },   ['g'] = { ZYP_BOPOMOFO_J },
+        ['7'] = { ZYP_BOPOMOFO_Q },   ['c'] = { ZYP_BOPOMOFO_X },
+        [','] = { ZYP_BOPOMOFO_ZH },  ['.'] = { ZYP_BOPOMOFO_CH },
+        ['/'] = { ZYP_BOPOMOFO_SH },  ['j'] = { ZYP_BOPOMOFO_R },
+        [';'] = { ZYP_BOPOMOFO_Z },   ['\''] = { ZYP_BOPOMOFO_C },
+        ['s'] = { ZYP_BOPOMOFO_S },
+        ['e'] = { ZYP_BOPOMOFO_I },   ['x'] = { ZYP_BOPOMOFO_U },
+        ['u'] = { ZYP_BOPOMOFO_YU },
+        ['a'] = { ZYP_BOPOMOFO_A },   ['o'] = { ZYP_BOPOMOFO_O },
+        ['r'] = { ZYP_BOPOMOFO_E },   ['w'] = { ZYP_BOPOMOFO_EH },
+        ['i'] = { ZYP_BOPOMOFO_AI },  ['q'] = { ZYP_BOPOMOFO_EI },
+        ['z'] = { ZYP_BOPOMOFO_AU },  ['y'] = { ZYP_BOPOMOFO_OU },
+        ['8'] = { ZYP_BOPOMOFO_AN },  ['9'] = { ZYP_BOPOMOFO_EN },
+        ['0'] = { ZYP_BOPOMOFO_ANG }, ['-'] = { ZYP_BOPOMOFO_ENG },
+        ['='] = { ZYP_BOPOMOFO_ER },
+        [' '] = { ZYP_TONE_1 },       ['2'] = { ZYP_TONE_2 },
+        ['3'] = { ZYP_TONE_3 },       ['4'] = { ZYP_TONE_4 },
+        ['1'] = { ZYP_TONE_5 },
+    },
+};
+
+static const struct zyp_keymap KEYMAP_HSU = {
+    .keys = {
+        ['b'] = { ZYP_BOPOMOFO_B },
+        ['p'] = { ZYP_BOPOMOFO_P },
+        ['m'] = { ZYP_BOPOMOFO_M, ZYP_BOPOMOFO_AN },
+        ['f'] = { ZYP_BOPOMOFO_F, ZYP_TONE_3 },
+        ['d'] = { ZYP_BOPOMOFO_D, ZYP_TONE_2 },
+        ['t'] = { ZYP_BOPOMOFO_T },
+        ['n'] = { ZYP_BOPOMOFO_N, ZYP_BOPOMOFO_EN },
+        ['l'] = { ZYP_BOPOMOFO_L, ZYP_BOPOMOFO_ENG },
+        ['g'] = { ZYP_BOPOMOFO_G, ZYP_BOPOMOFO_E },
+        ['k'] = { ZYP_BOPOMOFO_K, ZYP_BOPOMOFO_ANG },
+        ['h'] = { ZYP_BOPOMOFO_H, ZYP_BOPOMOFO_O },
+        ['j'] = { ZYP_BOPOMOFO_ZH, ZYP_TONE_4 },
+        ['v'] = { ZYP_BOPOMOFO_CH },
+        ['c'] = { ZYP_BOPOMOFO_SH },
+        ['r'] = { ZYP_BOPOMOFO_R },
+        ['z'] = { ZYP_BOPOMOFO_Z },
+        ['a'] = { ZYP_BOPOMOFO_C, ZYP_BOPOMOFO_EI },
+        ['s'] = { ZYP_BOPOMOFO_S, ZYP_TONE_5 },
+        ['e'] = { ZYP_BOPOMOFO_I, ZYP_BOPOMOFO_EH },
+        ['x'] = { ZYP_BOPOMOFO_U },
+        ['u'] = { ZYP_BOPOMOFO_YU },
+        ['y'] = { ZYP_BOPOMOFO_A },
+        ['i'] = { ZYP_BOPOMOFO_AI },
+        ['w'] = { ZYP_BOPOMOFO_AU },
+        ['o'] = { ZYP_BOPOMOFO_OU },
+        [' '] = { ZYP_TONE_1 },
+    },
+    .palatals = {
+        [INITIAL_INDEX(ZYP_BOPOMOFO_ZH)] = ZYP_BOPOMOFO_J,
+        [INITIAL_INDEX(ZYP_BOPOMOFO_CH)] = ZYP_BOPOMOFO_Q,
+        [INITIAL_INDEX(ZYP_BOPOMOFO_SH)] = ZYP_BOPOMOFO_X,
+    },
+    .alone_initial = ZYP_BOPOMOFO_L,
+};
+
+static const struct zyp_keymap KEYMAP_ETEN26 = {
+    .keys = {
+        ['b'] = { ZYP_BOPOMOFO_B },
+        ['p'] = { ZYP_BOPOMOFO_P, ZYP_BOPOMOFO_OU },
+        ['m'] = { ZYP_BOPOMOFO_M, ZYP_BOPOMOFO_AN },
+        ['f'] = { ZYP_BOPOMOFO_F, ZYP_TONE_2 },
+        ['d'] = { ZYP_BOPOMOFO_D, ZYP_TONE_5 },
+        ['t'] = { ZYP_BOPOMOFO_T, ZYP_BOPOMOFO_ANG },
+        ['n'] = { ZYP_BOPOMOFO_N, ZYP_BOPOMOFO_EN },
+        ['l'] = { ZYP_BOPOMOFO_L, ZYP_BOPOMOFO_ENG },
+        ['v'] = { ZYP_BOPOMOFO_G },
+        ['k'] = { ZYP_BOPOMOFO_K, ZYP_TONE_4 },
+        ['h'] = { ZYP_BOPOMOFO_H, ZYP_BOPOMOFO_ER },
+        ['g'] = { ZYP_BOPOMOFO_ZH },
+        ['y'] = { ZYP_BOPOMOFO_CH },
+        ['c'] = { ZYP_BOPOMOFO_SH },
+        ['j'] = { ZYP_BOPOMOFO_R, ZYP_TONE_3 },
+        ['q'] = { ZYP_BOPOMOFO_Z, ZYP_BOPOMOFO_EI },
+        ['w'] = { ZYP_BOPOMOFO_C, ZYP_BOPOMOFO_EH },
+        ['s'] = { ZYP_BOPOMOFO_S },
+        ['e'] = { ZYP_BOPOMOFO_I },
+        ['x'] = { ZYP_BOPOMOFO_U },
+        ['u'] = { ZYP_BOPOMOFO_YU },
+        ['a'] = { ZYP_BOPOMOFO_A },
+        ['o'] = { ZYP_BOPOMOFO_O },
+        ['r'] = { ZYP_BOPOMOFO_E },
+        ['i'] = { ZYP_BOPOMOFO_AI },
+        ['z'] = { ZYP_BOPOMOFO_AU },
+        [' '] = { ZYP_TONE_1 },
+    },
+    .palatals = {
+        [INITIAL_INDEX(ZYP_BOPOMOFO_G)] = ZYP_BOPOMOFO_Q,
+        [INITIAL_INDEX(ZYP_BOPOMOFO_ZH)] = ZYP_BOPOMOFO_J,
+        [INITIAL_INDEX(ZYP_BOPOMOFO_SH)] = ZYP_BOPOMOFO_X,
+    },
+    .alone_initial = ZYP_BOPOMOFO_H,
+};
+
+static const struct zyp_keymap *const KEYMAPS[ZYP_LAYOUT_COUNT] = {
+    [ZYP_LAYOUT_STANDARD] = &KEYMAP_STANDARD,
+    [ZYP_LAYOUT_ETEN] = &KEYMAP_ETEN,
+    [ZYP_LAYOUT_HSU] = &KEYMAP_HSU,
+    [ZYP_LAYOUT_ETEN26] = &KEYMAP_ETEN26,
+};
+
+// Field mask of each position: none, initial, medial, rhyme and tone
+static const uint16_t POSITION_MASKS[5] = {
+    0x0000, 0x3E00, 0x0180, 0x0078, 0x0007,
+};
+
+// Get the position of a single symbol
+static inline unsigned symbol_position(uint16_t sym)
+{
+    if (ZYP_SYLLABLE_TONE(sym)) {
+        return 4;
+    } else if (ZYP_SYLLABLE_RHYME(sym)) {
+        return 3;
+    } else if (ZYP_SYLLABLE_MEDIAL(sym)) {
+        return 2;
+    } else {
+        return 1;
+    }
+}
+
+// Get the position of the last typed symbol, 0 if nothing is typed
+static inline unsigned composition_position(uint16_t syll)
+{
+    if (ZYP_SYLLABLE_RHYME(syll)) {
+        return 3;
+    } else if (ZYP_SYLLABLE_MEDIAL(syll)) {
+        return 2;
+    } else if (ZYP_SYLLABLE_INITIAL(syll)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+int zyp_composer_init(struct zyp_composer *comp, enum zyp_layout layout)
+{
+    if (!comp || (unsigned)layout >= ZYP_LAYOUT_COUNT) {
+        return 1;
+    }
+    comp->keymap = KEYMAPS[layout];
+    comp->syll = 0;
+    comp->unconverted_initial = 0;
+    return 0;
+}
+
+int zyp_composer_set_layout(struct zyp_composer *comp, enum zyp_layout layout)
+{
+    return zyp_composer_init(comp, layout);
+}
+
+enum zyp_key_result zyp_composer_key(struct zyp_composer *comp, int key,
+                                     uint16_t *syll)
+{
+    if (!comp || key < 0 || key >= KEY_COUNT) {
+        return ZYP_KEY_IGNORED;
+    }
+
+    const struct zyp_keymap *map = comp->keymap;
+    const uint16_t *cands = map->keys[key];
+    unsigned pos = composition_position(comp->syll);
+
+    // Take the first symbol which can follow the typed ones
+    uint16_t sym = 0;
+    unsigned sympos = 0;
+    for (int i = 0; i < KEY_CANDIDATES && cands[i]; i++) {
+        unsigned p = symbol_position(cands[i]);
+        if ((p == 4 && pos) || (p < 4 && p > pos)) {
+            sym = cands[i];
+            sympos = p;
+            break;
+        }
+    }
+
+    if (!sym) {
+        // Otherwise, replace the symbol at the same position
+        sym = cands[0];
+        sympos = symbol_position(sym);
+        if (!sym || sympos == 4) {
+            return ZYP_KEY_IGNORED;
+        }
+    }
+
+    uint16_t cur = (comp->syll & ~POSITION_MASKS[sympos]) | sym;
+    if (sympos == 4) {
+        if (map->alone_initial && (comp->syll == map->alone_initial)) {
+            cur = ZYP_BOPOMOFO_ER | sym;
+        }
+        comp->syll = 0;
+        comp->unconverted_initial = 0;
+        if (syll) {
+            *syll = cur;
+        }
+        return ZYP_KEY_COMMITTED;
+    }
+
+    if (sympos == 1) {
+        // A new initial is typed as it is
+        comp->unconverted_initial = 0;
+    } else if (sympos == 2) {
+        if (sym == ZYP_BOPOMOFO_I || sym == ZYP_BOPOMOFO_YU) {
+            uint16_t palatal =
+                map->palatals[INITIAL_INDEX(ZYP_SYLLABLE_INITIAL(cur))];
+            if (palatal) {
+                comp->unconverted_initial = ZYP_SYLLABLE_INITIAL(cur);
+                cur = (cur & ~POSITION_MASKS[1]) | palatal;
+            }
+        } else if (comp->unconverted_initial) {
+            // The medial which converted the initial is replaced
+            cur = (cur & ~POSITION_MASKS[1]) | comp->unconverted_initial;
+            comp->unconverted_initial = 0;
+        }
+    }
+    comp->syll = cur;
+    return ZYP_KEY_ABSORBED;
+}
+
+bool zyp_composer_backspace(struct zyp_composer *comp)
+{
+    if (!comp) {
+        return false;
+    }
+    unsigned pos = composition_position(comp->syll);
+    if (!pos) {
+        return false;
+    }
+    comp->syll &= ~POSITION_MASKS[pos];
+    if (comp->unconverted_initial && pos <= 2) {
+        // The medial which converted the initial, or the initial, is removed
+        if (pos == 2) {
+            comp->syll = (comp->syll & ~POSITION_MASKS[1])
+                         | comp->unconverted_initial;
+        }
+        comp->unconverted_initial = 0;
+    }
+    return true;
+}
@@ -0,0 +1,165 @@
+#include "preedit.h"
+#include "alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 64
+
+static inline uint8_t preedit_flags(const struct preedit_char *ch)
+{
+    return (ch->user_selected ? PREEDIT_USER_SELECTED : 0)
+           | (ch->seg_point ? PREEDIT_SEG_POINT : 0);
+}
+
+// Move `n` charactors of the arrays from index `src` to index `dest`
+static void preedit_move(struct zyp_preedit *p, size_t dest, size_t src,
+                         size_t n)
+{
+    if (!n || dest == src) {
+        return;
+    }
+    memmove(p->sylls + dest, p->sylls + src, n * sizeof(*p->sylls));
+    memmove(p->chars + dest, p->chars + src, n * sizeof(*p->chars));
+    memmove(p->flags + dest, p->flags + src, n * sizeof(*p->flags));
+}
+
+static void preedit_move_gap(struct zyp_preedit *p, size_t pos)
+{
+    if (pos < p->gap_start) {
+        size_t n = p->gap_start - pos;
+        preedit_move(p, p->gap_end - n, pos, n);
+        p->gap_start -= n;
+        p->gap_end -= n;
+    } else if (pos > p->gap_start) {
+        size_t n = pos - p->gap_start;
+        preedit_move(p, p->gap_start, p->gap_end, n);
+        p->gap_start += n;
+        p->gap_end += n;
+    }
+}
+
+// Copy an array to a larger one, with the charactors after the gap at its end
+static void preedit_copy(void *dest, const void *src, size_t size,
+                         const struct zyp_preedit *p, size_t capacity)
+{
+    size_t tail = p->capacity - p->gap_end;
+    if (p->gap_start) {
+        memcpy(dest, src, p->gap_start * size);
+    }
+    if (tail) {
+        memcpy((char *)dest + (capacity - tail) * size,
+               (const char *)src + p->gap_end * size, tail * size);
+    }
+}
+
+// Make the gap hold at least `n` charactors
+static int preedit_reserve_gap(struct zyp_preedit *p, size_t n)
+{
+    if (p->gap_end - p->gap_start >= n) {
+        return 0;
+    }
+    size_t length = zyp_preedit_length(p);
+    size_t capacity = p->capacity ? p->capacity * 2 : INITIAL_CAPACITY;
+    while (capacity < length + n) {
+        capacity *= 2;
+    }
+    // All the arrays are allocated before any is replaced, so a failure
+    // leaves the buffer as it was
+    uint16_t *sylls = zyp_alloc(p->allocator, capacity * sizeof(*sylls));
+    uint32_t *chars = zyp_alloc(p->allocator, capacity * sizeof(*chars));
+    uint8_t *flags = zyp_alloc(p->allocator, capacity * sizeof(*flags));
+    if (!sylls || !chars || !flags) {
+        zyp_free(p->allocator, sylls, capacity * sizeof(*sylls));
+        zyp_free(p->allocator, chars, capacity * sizeof(*chars));
+        zyp_free(p->allocator, flags, capacity * sizeof(*flags));
+        return 1;
+    }
+    preedit_copy(sylls, p->sylls, sizeof(*sylls), p, capacity);
+    preedit_copy(chars, p->chars, sizeof(*chars), p, capacity);
+    preedit_copy(flags, p->flags, sizeof(*flags), p, capacity);
+    zyp_free(p->allocator, p->sylls, p->capacity * sizeof(*sylls));
+    zyp_free(p->allocator, p->chars, p->capacity * sizeof(*chars));
+    zyp_free(p->allocator, p->flags, p->capacity * sizeof(*flags));
+    p->sylls = sylls;
+    p->chars = chars;
+    p->flags = flags;
+
+    // The charactors after the gap are at the end of the larger arrays
+    p->gap_end = capacity - (p->capacity - p->gap_end);
+    p->capacity = capacity;
+    return 0;
+}
+
+void zyp_preedit_init(struct zyp_preedit *p,
+                      const struct zyp_allocator *allocator)
+{
+    memset(p, 0, sizeof(*p));
+    p->allocator = allocator;
+}
+
+void zyp_preedit_release(struct zyp_preedit *p)
+{
+    zyp_free(p->allocator, p->sylls, p->capacity * sizeof(*p->sylls));
+    zyp_free(p->allocator, p->chars, p->capacity * sizeof(*p->chars));
+    zyp_free(p->allocator, p->flags, p->capacity * sizeof(*p->flags));
+    zyp_preedit_init(p, p->allocator);
+}
+
+int zyp_preedit_reserve(struct zyp_preedit *p, size_t n)
+{
+    return preedit_reserve_gap(p, n);
+}
+
+int zyp_preedit_insert(struct zyp_preedit *p, size_t pos,
+                       const struct preedit_char *chars, size_t n)
+{
+    if (preedit_reserve_gap(p, n)) {
+        return 1;
+    }
+    preedit_move_gap(p, pos);
+    for (size_t i = 0; i < n; i++) {
+        size_t k = p->gap_start + i;
+        p->sylls[k] = chars[i].zhuyin_syll;
+        p->chars[k] = chars[i].selected_char;
+        p->flags[k] = preedit_flags(&chars[i]);
+    }
+    p->gap_start += n;
+    return 0;
+}
+
+void zyp_preedit_remove(struct zyp_preedit *p, size_t pos, size_t n)
+{
+    preedit_move_gap(p, pos);
+    p->gap_end += n;
+}
+
+void zyp_preedit_clear(struct zyp_preedit *p)
+{
+    p->gap_start = 0;
+    p->gap_end = p->capacity;
+}
+
+void zyp_preedit_get(const struct zyp_preedit *p, size_t pos,
+                     struct preedit_char *out)
+{
+    size_t k = zyp_preedit_index(p, pos);
+    out->zhuyin_syll = p->sylls[k];
+    out->selected_char = p->chars[k];
+    out->user_selected = (p->flags[k] & PREEDIT_USER_SELECTED) != 0;
+    out->seg_point = (p->flags[k] & PREEDIT_SEG_POINT) != 0;
+}
+
+void zyp_preedit_set(struct zyp_preedit *p, size_t pos,
+                     const struct preedit_char *ch)
+{
+    size_t k = zyp_preedit_index(p, pos);
+    p->sylls[k] = ch->zhuyin_syll;
+    p->chars[k] = ch->selected_char;
+    p->flags[k] = preedit_flags(ch);
+}
+
+void zyp_preedit_compact(struct zyp_preedit *p)
+{
+    preedit_move_gap(p, zyp_preedit_length(p));
+}
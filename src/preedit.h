@@ -0,0 +1,134 @@
+#ifndef _ZYP_PREEDIT_H
+#define _ZYP_PREEDIT_H
+/**
+ * @file
+ * The preedit buffer, as a structure of arrays in a gap buffer
+ *
+ * The syllables, the selected charactors and the flags are kept in their
+ * own arrays, so a pass over the syllables reads a dense `uint16_t` array.
+ * The arrays share a gap at the caret, so typing and deleting there only
+ * moves the gap ends. zyp_preedit_compact() moves the gap to the end, after
+ * which the charactors are contiguous from index 0.
+ */
+
+#include <zyphtine/alloc.h>
+#include <zyphtine/context.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** The charactor is selected by user, see preedit_char::user_selected */
+#define PREEDIT_USER_SELECTED (1u << 0)
+/** A phrase begins at the charactor, see preedit_char::seg_point */
+#define PREEDIT_SEG_POINT (1u << 1)
+
+/**
+ * A preedit buffer
+ * The charactors `[0, gap_start)` are at the front of the arrays, and the
+ * charactors from `gap_start` are at `[gap_end, capacity)`.
+ */
+struct zyp_preedit {
+    uint16_t *sylls;
+    uint32_t *chars;
+    uint8_t *flags;
+    size_t gap_start;
+    size_t gap_end;
+    size_t capacity;
+    /** Allocator of the arrays, NULL for malloc() */
+    const struct zyp_allocator *allocator;
+};
+
+/**
+ * Initialize an empty preedit buffer
+ *
+ * @param p preedit buffer
+ * @param allocator allocator of the arrays, or NULL for malloc()
+ */
+void zyp_preedit_init(struct zyp_preedit *p,
+                      const struct zyp_allocator *allocator);
+
+/**
+ * Free the memory of the preedit buffer, keeping its allocator
+ *
+ * @param p preedit buffer
+ */
+void zyp_preedit_release(struct zyp_preedit *p);
+
+static inline size_t zyp_preedit_length(const struct zyp_preedit *p)
+{
+    return p->capacity - (p->gap_end - p->gap_start);
+}
+
+// Index in the arrays of charactor `pos`
+static inline size_t zyp_preedit_index(const struct zyp_preedit *p,
+                                       size_t pos)
+{
+    return pos < p->gap_start ? pos : pos + (p->gap_end - p->gap_start);
+}
+
+/**
+ * Make room for `n` more charactors
+ *
+ * @param p preedit buffer
+ * @param n number of charactors
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_preedit_reserve(struct zyp_preedit *p, size_t n);
+
+/**
+ * Insert charactors, moving the gap to `pos`
+ *
+ * @param p preedit buffer
+ * @param pos position to insert, at most the length
+ * @param chars charactors to be inserted
+ * @param n number of charactors
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_preedit_insert(struct zyp_preedit *p, size_t pos,
+                       const struct preedit_char *chars, size_t n);
+
+/**
+ * Remove charactors, moving the gap to `pos`
+ *
+ * @param p preedit buffer
+ * @param pos position of the first charactor to be removed
+ * @param n number of charactors, `pos + n` is at most the length
+ */
+void zyp_preedit_remove(struct zyp_preedit *p, size_t pos, size_t n);
+
+/**
+ * Remove all the charactors, keeping the memory
+ *
+ * @param p preedit buffer
+ */
+void zyp_preedit_clear(struct zyp_preedit *p);
+
+/**
+ * Get a charactor as a struct preedit_char
+ *
+ * @param p preedit buffer
+ * @param pos position of the charactor, less than the length
+ * @param out where to store the charactor
+ */
+void zyp_preedit_get(const struct zyp_preedit *p, size_t pos,
+                     struct preedit_char *out);
+
+/**
+ * Set a charactor from a struct preedit_char
+ *
+ * @param p preedit buffer
+ * @param pos position of the charactor, less than the length
+ * @param ch the new charactor
+ */
+void zyp_preedit_set(struct zyp_preedit *p, size_t pos,
+                     const struct preedit_char *ch);
+
+/**
+ * Move the gap to the end, so the arrays hold the charactors contiguously
+ * from index 0
+ *
+ * @param p preedit buffer
+ */
+void zyp_preedit_compact(struct zyp_preedit *p);
+
+#endif
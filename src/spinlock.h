@@ -0,0 +1,46 @@
+#ifndef _ZYP_SPINLOCK_H
+#define _ZYP_SPINLOCK_H
+/**
+ * @file
+ * A spin lock for the short and rare critical sections shared by threads,
+ * with GCC atomic builtins
+ */
+
+#include <sched.h>
+#include <stdint.h>
+
+/** Busy waits before yielding the processor */
+#define ZYP_SPIN_COUNT 64
+
+/**
+ * Wait a little in a spin loop, yielding the processor after a while
+ *
+ * @param spins number of waits so far, initialized to 0
+ */
+static inline void zyp_spin_wait(unsigned *spins)
+{
+    if (++*spins >= ZYP_SPIN_COUNT) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+/**
+ * Take a lock, which is a zero initialized `uint32_t`
+ *
+ * @param lock lock object
+ */
+static inline void zyp_spin_lock(uint32_t *lock)
+{
+    unsigned spins = 0;
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+        zyp_spin_wait(&spins);
+    }
+}
+
+static inline void zyp_spin_unlock(uint32_t *lock)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+#endif
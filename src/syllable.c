@@ -1,27 +1,66 @@
 #include <zyphtine/syllable.h>
-#include "utf8.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
-static const char *const INITIAL_BOPOMOFOS =
-    "\xE3\x84\x85\xE3\x84\x86\xE3\x84\x87\xE3\x84\x88"  // ㄅㄆㄇㄈ
-    "\xE3\x84\x89\xE3\x84\x8A\xE3\x84\x8B\xE3\x84\x8C"  // ㄉㄊㄋㄌ
-    "\xE3\x84\x8D\xE3\x84\x8E\xE3\x84\x8F"              // ㄍㄎㄏ
-    "\xE3\x84\x90\xE3\x84\x91\xE3\x84\x92"              // ㄐㄑㄒ
-    "\xE3\x84\x93\xE3\x84\x94\xE3\x84\x95\xE3\x84\x96"  // ㄓㄔㄕㄖ
-    "\xE3\x84\x97\xE3\x84\x98\xE3\x84\x99";             // ㄗㄘㄙ
+#include "syllable_table.h"
 
-static const char *const MEDIAL_BOPOMOFOS =
-    "\xE3\x84\xA7\xE3\x84\xA8\xE3\x84\xA9";             // ㄧㄨㄩ
+// Precomputed UTF-8 encodings of each component, indexed by field value - 1
+static const char INITIAL_BOPOMOFOS[21][3] = {
+    "\xE3\x84\x85", "\xE3\x84\x86", "\xE3\x84\x87", "\xE3\x84\x88", // ㄅㄆㄇㄈ
+    "\xE3\x84\x89", "\xE3\x84\x8A", "\xE3\x84\x8B", "\xE3\x84\x8C", // ㄉㄊㄋㄌ
+    "\xE3\x84\x8D", "\xE3\x84\x8E", "\xE3\x84\x8F",                 // ㄍㄎㄏ
+    "\xE3\x84\x90", "\xE3\x84\x91", "\xE3\x84\x92",                 // ㄐㄑㄒ
+    "\xE3\x84\x93", "\xE3\x84\x94", "\xE3\x84\x95", "\xE3\x84\x96", // ㄓㄔㄕㄖ
+    "\xE3\x84\x97", "\xE3\x84\x98", "\xE3\x84\x99",                 // ㄗㄘㄙ
+};
 
-static const char *const RHYME_BOPOMOFOS =
-    "\xE3\x84\x9A\xE3\x84\x9B\xE3\x84\x9C\xE3\x84\x9D"  // ㄚㄛㄜㄝ
-    "\xE3\x84\x9E\xE3\x84\x9F\xE3\x84\xA0\xE3\x84\xA1"  // ㄞㄟㄠㄡ
-    "\xE3\x84\xA2\xE3\x84\xA3\xE3\x84\xA4\xE3\x84\xA5"  // ㄢㄣㄤㄥ
-    "\xE3\x84\xA6";                                     // ㄦ
+static const char MEDIAL_BOPOMOFOS[3][3] = {
+    "\xE3\x84\xA7", "\xE3\x84\xA8", "\xE3\x84\xA9",                 // ㄧㄨㄩ
+};
 
-static const char *const TONE_BOPOMOFOS =
-    "\xCB\x89\xCB\x99\xCB\x8A\xCB\x87\xCB\x8B";         // ˉˊˇˋ˙
+static const char RHYME_BOPOMOFOS[13][3] = {
+    "\xE3\x84\x9A", "\xE3\x84\x9B", "\xE3\x84\x9C", "\xE3\x84\x9D", // ㄚㄛㄜㄝ
+    "\xE3\x84\x9E", "\xE3\x84\x9F", "\xE3\x84\xA0", "\xE3\x84\xA1", // ㄞㄟㄠㄡ
+    "\xE3\x84\xA2", "\xE3\x84\xA3", "\xE3\x84\xA4", "\xE3\x84\xA5", // ㄢㄣㄤㄥ
+    "\xE3\x84\xA6",                                                  // ㄦ
+};
+
+static const char TONE_BOPOMOFOS[5][2] = {
+    "\xCB\x89", "\xCB\x8A", "\xCB\x87", "\xCB\x8B", "\xCB\x99",     // ˉˊˇˋ˙
+};
+
+// Bopomofo block (U+3105 - U+3129) is encoded as E3 84 85 - E3 84 A9,
+// index these tables by the last byte - 0x80
+static const uint16_t BOPOMOFO_FIELDS[0x40] = {
+    [0x05] = ZYP_BOPOMOFO_B,  [0x06] = ZYP_BOPOMOFO_P,  [0x07] = ZYP_BOPOMOFO_M,
+    [0x08] = ZYP_BOPOMOFO_F,  [0x09] = ZYP_BOPOMOFO_D,  [0x0A] = ZYP_BOPOMOFO_T,
+    [0x0B] = ZYP_BOPOMOFO_N,  [0x0C] = ZYP_BOPOMOFO_L,  [0x0D] = ZYP_BOPOMOFO_G,
+    [0x0E] = ZYP_BOPOMOFO_K,  [0x0F] = ZYP_BOPOMOFO_H,  [0x10] = ZYP_BOPOMOFO_J,
+    [0x11] = ZYP_BOPOMOFO_Q,  [0x12] = ZYP_BOPOMOFO_X,  [0x13] = ZYP_BOPOMOFO_ZH,
+    [0x14] = ZYP_BOPOMOFO_CH, [0x15] = ZYP_BOPOMOFO_SH, [0x16] = ZYP_BOPOMOFO_R,
+    [0x17] = ZYP_BOPOMOFO_Z,  [0x18] = ZYP_BOPOMOFO_C,  [0x19] = ZYP_BOPOMOFO_S,
+    [0x1A] = ZYP_BOPOMOFO_A,  [0x1B] = ZYP_BOPOMOFO_O,  [0x1C] = ZYP_BOPOMOFO_E,
+    [0x1D] = ZYP_BOPOMOFO_EH, [0x1E] = ZYP_BOPOMOFO_AI, [0x1F] = ZYP_BOPOMOFO_EI,
+    [0x20] = ZYP_BOPOMOFO_AU, [0x21] = ZYP_BOPOMOFO_OU, [0x22] = ZYP_BOPOMOFO_AN,
+    [0x23] = ZYP_BOPOMOFO_EN, [0x24] = ZYP_BOPOMOFO_ANG, [0x25] = ZYP_BOPOMOFO_ENG,
+    [0x26] = ZYP_BOPOMOFO_ER, [0x27] = ZYP_BOPOMOFO_I,  [0x28] = ZYP_BOPOMOFO_U,
+    [0x29] = ZYP_BOPOMOFO_YU,
+};
+
+// Position of the component inside a syllable: initial, medial, rhyme
+static const uint8_t BOPOMOFO_RANKS[0x40] = {
+    [0x05] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    [0x1A] = 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    [0x27] = 2, 2, 2,
+};
+
+// Tone marks are encoded as CB xx, index this table by the last byte - 0x80
+static const uint16_t TONE_FIELDS[0x40] = {
+    [0x09] = ZYP_TONE_1, [0x0A] = ZYP_TONE_2, [0x07] = ZYP_TONE_3,
+    [0x0B] = ZYP_TONE_4, [0x19] = ZYP_TONE_5,
+};
 
 bool zyp_syllable_check(uint16_t syll)
 {
@@ -33,6 +72,24 @@ bool zyp_syllable_check(uint16_t syll)
         ;
 }
 
+bool zyp_syllable_is_legal(uint16_t syll)
+{
+    uint64_t word = LEGAL_SYLLABLE_BITS[(syll & 0x3FFF) >> 6];
+    return ((word >> (syll & 0x3F)) & 1) & !(syll & 0xC000);
+}
+
+uint16_t zyp_syllable_to_index(uint16_t syll)
+{
+    // Syllables out of the 14 bits space are forced to the invalid index
+    return SYLLABLE_TO_INDEX[syll & 0x3FFF] | (uint16_t)-!!(syll & 0xC000);
+}
+
+uint16_t zyp_syllable_from_index(uint16_t index)
+{
+    uint16_t valid = (uint16_t)-(index < ZYP_SYLLABLE_INDEX_COUNT);
+    return SYLLABLE_FROM_INDEX[index & valid] & valid;
+}
+
 bool zyp_syllable_is_single(uint16_t syll)
 {
     return zyp_syllable_is_initials(syll)
@@ -78,41 +135,160 @@ bool zyp_syllable_is_tones(uint16_t syll)
         ;
 }
 
-char *zyp_syllable_print(char *dest, uint16_t syll)
+// Write the components of a checked syllable without the null terminator
+static inline char *syllable_write(char *s, uint16_t syll)
 {
-    if (!zyp_syllable_check(syll)) {
-        return NULL;
-    }
-
-    char *s = dest;
     uint16_t init, med, rhy, tone;
     if ((init = ZYP_SYLLABLE_INITIAL(syll))) {
-        init = (init >> 9) - 1;
-        const char *chr = utf8_nthchr(INITIAL_BOPOMOFOS, init);
-        utf8_strncpy(s, chr, 1);
-        s = utf8_nextchr(s);
+        memcpy(s, INITIAL_BOPOMOFOS[(init >> 9) - 1], 3);
+        s += 3;
     }
 
     if ((med = ZYP_SYLLABLE_MEDIAL(syll))) {
-        med = (med >> 7) - 1;
-        const char *chr = utf8_nthchr(MEDIAL_BOPOMOFOS, med);
-        utf8_strncpy(s, chr, 1);
-        s = utf8_nextchr(s);
+        memcpy(s, MEDIAL_BOPOMOFOS[(med >> 7) - 1], 3);
+        s += 3;
     }
 
     if ((rhy = ZYP_SYLLABLE_RHYME(syll))) {
-        rhy = (rhy >> 3) - 1;
-        const char *chr = utf8_nthchr(RHYME_BOPOMOFOS, rhy);
-        utf8_strncpy(s, chr, 1);
-        s = utf8_nextchr(s);
+        memcpy(s, RHYME_BOPOMOFOS[(rhy >> 3) - 1], 3);
+        s += 3;
     }
 
     if ((tone = ZYP_SYLLABLE_TONE(syll))) {
-        tone = tone - 1;
-        const char *chr = utf8_nthchr(TONE_BOPOMOFOS, tone);
-        utf8_strncpy(s, chr, 1);
-        s = utf8_nextchr(s);
+        memcpy(s, TONE_BOPOMOFOS[tone - 1], 2);
+        s += 2;
     }
 
+    return s;
+}
+
+char *zyp_syllable_print(char *dest, uint16_t syll)
+{
+    if (!zyp_syllable_check(syll)) {
+        return NULL;
+    }
+
+    char *s = syllable_write(dest, syll);
+    *s = '\0';
     return dest;
 }
+
+size_t zyp_syllable_print_n(char *dest, const uint16_t *sylls, size_t n,
+                            const char *sep)
+{
+    if (!dest) {
+        return SIZE_MAX;
+    }
+
+    size_t seplen = sep ? strlen(sep) : 0;
+    char *s = dest;
+    for (size_t i = 0; i < n; i++) {
+        if (!zyp_syllable_check(sylls[i])) {
+            *s = '\0';
+            return SIZE_MAX;
+        }
+        if (i && seplen) {
+            memcpy(s, sep, seplen);
+            s += seplen;
+        }
+        s = syllable_write(s, sylls[i]);
+    }
+    *s = '\0';
+
+    return (size_t)(s - dest);
+}
+
+static inline bool is_separator(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Parse one syllable, return the bytes consumed or 0 if malformed
+static inline size_t syllable_parse_one(const unsigned char *p, size_t len,
+                                        uint16_t *syll)
+{
+    size_t pos = 0;
+    uint16_t result = 0;
+    uint8_t rank = 0;
+    while (pos + 1 < len) {
+        unsigned char lead = p[pos];
+        if (lead == 0xE3 && pos + 2 < len && p[pos + 1] == 0x84
+                && (p[pos + 2] & 0xC0) == 0x80) {
+            unsigned char idx = p[pos + 2] - 0x80;
+            uint8_t r = BOPOMOFO_RANKS[idx];
+            // Components must appear in order, otherwise a new syllable begins
+            if (r <= rank) {
+                break;
+            }
+            result |= BOPOMOFO_FIELDS[idx];
+            rank = r;
+            pos += 3;
+        } else if (lead == 0xCB && (p[pos + 1] & 0xC0) == 0x80) {
+            uint16_t tone = TONE_FIELDS[p[pos + 1] - 0x80];
+            // A tone mark always terminates the syllable
+            if (tone && rank) {
+                result |= tone;
+                pos += 2;
+            }
+            break;
+        } else {
+            break;
+        }
+    }
+
+    if (!rank) {
+        return 0;
+    }
+    *syll = result;
+    return pos;
+}
+
+size_t zyp_syllable_parse(const char *str, size_t len, uint16_t *syll)
+{
+    if (!str) {
+        return 0;
+    }
+
+    uint16_t result;
+    size_t sz = syllable_parse_one((const unsigned char *)str, len, &result);
+    if (sz && syll) {
+        *syll = result;
+    }
+    return sz;
+}
+
+size_t zyp_syllable_parse_n(uint16_t *dest, size_t n, const char *str,
+                            size_t len, size_t *end)
+{
+    size_t count = 0, pos = 0;
+    if (!str) {
+        len = 0;
+    }
+
+    while (pos < len) {
+        if (is_separator((unsigned char)str[pos])) {
+            pos++;
+            continue;
+        }
+        if (dest && count >= n) {
+            break;
+        }
+
+        uint16_t syll;
+        size_t sz = syllable_parse_one((const unsigned char *)str + pos,
+                                       len - pos, &syll);
+        if (!sz) {
+            break;
+        }
+        if (dest) {
+            dest[count] = syll;
+        }
+        count++;
+        pos += sz;
+    }
+
+    if (end) {
+        *end = pos;
+    }
+    return count;
+}
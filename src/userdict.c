@@ -0,0 +1,749 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <zyphtine/userdict.h>
+#include "alloc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_MAGIC "ZYPUSER"
+#define LOG_VERSION 1
+#define INITIAL_SLOTS 64
+#define COMPACT_BUFFER_SIZE 65536
+/** Compact when the log has this many more records than the phrases */
+#define COMPACT_SLACK 4096
+
+enum log_type {
+    LOG_SET = 1,
+    LOG_REMOVE = 2,
+};
+
+/**
+ * The log begins with a header, and follows with records. Integers are in
+ * the host byte order, since a user dictionary belongs to a machine.
+ */
+struct log_header {
+    /** "ZYPUSER" and a null charactor */
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// A record is followed by the syllables and the text
+struct log_record {
+    /** Checksum of the rest of the record, to detect torn writes */
+    uint32_t checksum;
+    uint16_t type;
+    uint16_t len;
+    uint32_t textlen;
+    /** The new frequency of LOG_SET, so replaying it twice is harmless */
+    uint32_t frequency;
+};
+
+// A syllable sequence and its phrases, sorted by frequency
+struct ud_key {
+    /** NULL if the slot is empty */
+    uint16_t *sylls;
+    uint32_t hash;
+    uint16_t len;
+    struct zyp_userdict_phrase *phrases;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+// Here are the hidden structure definition
+struct zyp_userdict {
+    char *path;
+    int fd;
+    /** Open addressing hash table of the keys, with linear probing */
+    struct ud_key *slots;
+    size_t slot_count;
+    size_t key_count;
+    size_t phrase_count;
+    /** End of the last valid record */
+    uint64_t log_size;
+    size_t log_records;
+    /** The log has grown enough to be compacted at the next chance */
+    bool compact_pending;
+    /** Buffer to encode a record */
+    unsigned char *record;
+    size_t record_capacity;
+    /** Allocator of the dictionary and everything in it, NULL for malloc() */
+    const struct zyp_allocator *allocator;
+};
+
+// FNV-1a
+static uint32_t fnv1a(uint32_t h, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static inline uint32_t sylls_hash(const uint16_t *sylls, size_t len)
+{
+    return fnv1a(2166136261u, sylls, len * sizeof(uint16_t));
+}
+
+static size_t slot_find(const struct ud_key *slots, size_t slot_count,
+                        const uint16_t *sylls, size_t len, uint32_t hash)
+{
+    size_t mask = slot_count - 1;
+    size_t i = hash & mask;
+    while (slots[i].sylls) {
+        if (slots[i].hash == hash && slots[i].len == len
+                && !memcmp(slots[i].sylls, sylls, len * sizeof(uint16_t))) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static struct ud_key *key_find(const struct zyp_userdict *ud,
+                               const uint16_t *sylls, size_t len)
+{
+    size_t i = slot_find(ud->slots, ud->slot_count, sylls, len,
+                         sylls_hash(sylls, len));
+    return ud->slots[i].sylls ? &ud->slots[i] : NULL;
+}
+
+static void key_free(struct zyp_userdict *ud, struct ud_key *key)
+{
+    for (uint32_t i = 0; i < key->count; i++) {
+        zyp_free(ud->allocator, (char *)key->phrases[i].text,
+                 key->phrases[i].text_length + 1);
+    }
+    zyp_free(ud->allocator, key->phrases,
+             key->capacity * sizeof(key->phrases[0]));
+    zyp_free(ud->allocator, key->sylls, key->len * sizeof(uint16_t));
+    key->sylls = NULL;
+}
+
+// Move the keys to a new table, dropping the keys without phrases
+static int slots_rehash(struct zyp_userdict *ud, size_t slot_count)
+{
+    struct ud_key *slots = (struct ud_key *)zyp_calloc(
+        ud->allocator, slot_count * sizeof(struct ud_key));
+    if (!slots) {
+        return 1;
+    }
+    ud->key_count = 0;
+    for (size_t i = 0; i < ud->slot_count; i++) {
+        struct ud_key *key = &ud->slots[i];
+        if (!key->sylls) {
+            continue;
+        }
+        if (!key->count) {
+            key_free(ud, key);
+            continue;
+        }
+        slots[slot_find(slots, slot_count, key->sylls, key->len,
+                        key->hash)] = *key;
+        ud->key_count++;
+    }
+    zyp_free(ud->allocator, ud->slots, ud->slot_count * sizeof(ud->slots[0]));
+    ud->slots = slots;
+    ud->slot_count = slot_count;
+    return 0;
+}
+
+static struct ud_key *key_insert(struct zyp_userdict *ud,
+                                 const uint16_t *sylls, size_t len)
+{
+    // Keep the load factor under 0.7
+    if ((ud->key_count + 1) * 10 > ud->slot_count * 7
+            && slots_rehash(ud, ud->slot_count * 2)) {
+        return NULL;
+    }
+    uint32_t hash = sylls_hash(sylls, len);
+    size_t i = slot_find(ud->slots, ud->slot_count, sylls, len, hash);
+    struct ud_key *key = &ud->slots[i];
+    if (key->sylls) {
+        return key;
+    }
+
+    uint16_t *copy = (uint16_t *)zyp_alloc(ud->allocator,
+                                           len * sizeof(uint16_t));
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, sylls, len * sizeof(uint16_t));
+    *key = (struct ud_key){
+        .sylls = copy,
+        .hash = hash,
+        .len = (uint16_t)len,
+    };
+    ud->key_count++;
+    return key;
+}
+
+static size_t phrase_find(const struct ud_key *key, const char *text,
+                          size_t textlen)
+{
+    size_t i = 0;
+    while (i < key->count && (key->phrases[i].text_length != textlen
+                              || memcmp(key->phrases[i].text, text,
+                                        textlen))) {
+        i++;
+    }
+    return i;
+}
+
+// Move the phrase to keep the phrases sorted after its frequency changed
+static void phrase_reorder(struct ud_key *key, size_t i)
+{
+    struct zyp_userdict_phrase p = key->phrases[i];
+    while (i > 0 && key->phrases[i - 1].frequency < p.frequency) {
+        key->phrases[i] = key->phrases[i - 1];
+        i--;
+    }
+    while (i + 1 < key->count
+            && key->phrases[i + 1].frequency > p.frequency) {
+        key->phrases[i] = key->phrases[i + 1];
+        i++;
+    }
+    key->phrases[i] = p;
+}
+
+static int apply_set(struct zyp_userdict *ud, const uint16_t *sylls,
+                     size_t len, const char *text, size_t textlen,
+                     uint32_t frequency)
+{
+    struct ud_key *key = key_insert(ud, sylls, len);
+    if (!key) {
+        return 1;
+    }
+    size_t i = phrase_find(key, text, textlen);
+    if (i == key->count) {
+        if (key->count == key->capacity) {
+            uint32_t capacity = key->capacity ? key->capacity * 2 : 2;
+            struct zyp_userdict_phrase *phrases =
+                (struct zyp_userdict_phrase *)zyp_realloc(
+                    ud->allocator, key->phrases,
+                    key->capacity * sizeof(*phrases),
+                    capacity * sizeof(*phrases));
+            if (!phrases) {
+                return 1;
+            }
+            key->phrases = phrases;
+            key->capacity = capacity;
+        }
+        char *copy = (char *)zyp_alloc(ud->allocator, textlen + 1);
+        if (!copy) {
+            return 1;
+        }
+        memcpy(copy, text, textlen);
+        copy[textlen] = '\0';
+        key->phrases[key->count++] = (struct zyp_userdict_phrase){
+            .text = copy,
+            .text_length = (uint32_t)textlen,
+        };
+        ud->phrase_count++;
+    }
+    key->phrases[i].frequency = frequency;
+    phrase_reorder(key, i);
+    return 0;
+}
+
+static void apply_remove(struct zyp_userdict *ud, const uint16_t *sylls,
+                         size_t len, const char *text, size_t textlen)
+{
+    struct ud_key *key = key_find(ud, sylls, len);
+    if (!key) {
+        return;
+    }
+    size_t i = phrase_find(key, text, textlen);
+    if (i == key->count) {
+        return;
+    }
+    // The key stays in the table until the next compaction or rehash
+    zyp_free(ud->allocator, (char *)key->phrases[i].text,
+             key->phrases[i].text_length + 1);
+    memmove(&key->phrases[i], &key->phrases[i + 1],
+            (key->count - i - 1) * sizeof(key->phrases[0]));
+    key->count--;
+    ud->phrase_count--;
+}
+
+// Encode a record into the record buffer, return its size or 0 on failure
+static size_t record_encode(struct zyp_userdict *ud, enum log_type type,
+                            const uint16_t *sylls, size_t len,
+                            const char *text, size_t textlen,
+                            uint32_t frequency)
+{
+    size_t size = sizeof(struct log_record) + len * sizeof(uint16_t)
+                  + textlen;
+    if (size > ud->record_capacity) {
+        unsigned char *record = (unsigned char *)zyp_realloc(
+            ud->allocator, ud->record, ud->record_capacity, size);
+        if (!record) {
+            return 0;
+        }
+        ud->record = record;
+        ud->record_capacity = size;
+    }
+
+    struct log_record rec = {
+        .type = (uint16_t)type,
+        .len = (uint16_t)len,
+        .textlen = (uint32_t)textlen,
+        .frequency = frequency,
+    };
+    unsigned char *p = ud->record;
+    memcpy(p, &rec, sizeof(rec));
+    memcpy(p + sizeof(rec), sylls, len * sizeof(uint16_t));
+    memcpy(p + sizeof(rec) + len * sizeof(uint16_t), text, textlen);
+    rec.checksum = fnv1a(2166136261u, p + sizeof(rec.checksum),
+                         size - sizeof(rec.checksum));
+    memcpy(p, &rec.checksum, sizeof(rec.checksum));
+    return size;
+}
+
+static int write_all(int fd, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    while (size) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int log_append(struct zyp_userdict *ud, enum log_type type,
+                      const uint16_t *sylls, size_t len, const char *text,
+                      size_t textlen, uint32_t frequency)
+{
+    size_t size = record_encode(ud, type, sylls, len, text, textlen,
+                                frequency);
+    if (!size) {
+        return 1;
+    }
+    if (write_all(ud->fd, ud->record, size)) {
+        // Drop the partial record, so it does not hide the later records
+        int err = ftruncate(ud->fd, (off_t)ud->log_size);
+        (void)err;
+        return 1;
+    }
+    ud->log_size += size;
+    ud->log_records++;
+    return 0;
+}
+
+/**
+ * Replay the records, return the size of the valid part of the log, or 0 if
+ * fail to allocate memory, which must not cut the records not replayed
+ */
+static uint64_t log_replay(struct zyp_userdict *ud, const unsigned char *data,
+                           size_t size)
+{
+    size_t pos = sizeof(struct log_header);
+    while (size - pos >= sizeof(struct log_record)) {
+        struct log_record rec;
+        memcpy(&rec, data + pos, sizeof(rec));
+        size_t recsize = sizeof(rec) + rec.len * sizeof(uint16_t)
+                         + rec.textlen;
+        if (rec.textlen > size - pos || recsize > size - pos
+                || fnv1a(2166136261u, data + pos + sizeof(rec.checksum),
+                         recsize - sizeof(rec.checksum)) != rec.checksum) {
+            break;
+        }
+
+        // The syllables may be unaligned, copy them to the record buffer
+        if (rec.len * sizeof(uint16_t) > ud->record_capacity) {
+            unsigned char *record = (unsigned char *)zyp_realloc(
+                ud->allocator, ud->record, ud->record_capacity,
+                rec.len * sizeof(uint16_t));
+            if (!record) {
+                return 0;
+            }
+            ud->record = record;
+            ud->record_capacity = rec.len * sizeof(uint16_t);
+        }
+        const uint16_t *sylls = (const uint16_t *)ud->record;
+        memcpy(ud->record, data + pos + sizeof(rec),
+               rec.len * sizeof(uint16_t));
+        const char *text = (const char *)data + pos + sizeof(rec)
+                           + rec.len * sizeof(uint16_t);
+        if (rec.type == LOG_SET) {
+            if (apply_set(ud, sylls, rec.len, text, rec.textlen,
+                          rec.frequency)) {
+                return 0;
+            }
+        } else if (rec.type == LOG_REMOVE) {
+            apply_remove(ud, sylls, rec.len, text, rec.textlen);
+        } else {
+            break;
+        }
+        pos += recsize;
+        ud->log_records++;
+    }
+    return pos;
+}
+
+static int read_all(int fd, unsigned char *data, size_t size)
+{
+    while (size) {
+        ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int log_load(struct zyp_userdict *ud)
+{
+    struct stat st;
+    if (fstat(ud->fd, &st)) {
+        return 1;
+    }
+
+    const struct log_header fresh = {
+        .magic = LOG_MAGIC,
+        .version = LOG_VERSION,
+    };
+    if (st.st_size == 0) {
+        ud->log_size = sizeof(fresh);
+        return write_all(ud->fd, &fresh, sizeof(fresh));
+    }
+    if ((uint64_t)st.st_size < sizeof(fresh)
+            || (uint64_t)st.st_size > SIZE_MAX) {
+        return 1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    unsigned char *data = (unsigned char *)zyp_alloc(ud->allocator, size);
+    if (!data) {
+        return 1;
+    }
+    if (lseek(ud->fd, 0, SEEK_SET) || read_all(ud->fd, data, size)
+            || memcmp(data, &fresh, sizeof(fresh.magic) + sizeof(uint32_t))) {
+        zyp_free(ud->allocator, data, size);
+        return 1;
+    }
+    ud->log_size = log_replay(ud, data, size);
+    zyp_free(ud->allocator, data, size);
+    if (!ud->log_size) {
+        return 1;
+    }
+
+    // Cut the torn record left by a crash
+    if (ud->log_size < size && ftruncate(ud->fd, (off_t)ud->log_size)) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Mark the log to be compacted if it has grown too much. The rewrite is left
+ * to zyp_userdict_compact(), or to opening and closing the dictionary, so a
+ * change costs no more than its own record.
+ */
+static void check_compact(struct zyp_userdict *ud)
+{
+    if (ud->log_records > 2 * ud->phrase_count + COMPACT_SLACK) {
+        ud->compact_pending = true;
+    }
+}
+
+struct zyp_userdict *zyp_userdict_open(const char *path)
+{
+    return zyp_userdict_open_with_allocator(path, NULL);
+}
+
+struct zyp_userdict *zyp_userdict_open_with_allocator(
+    const char *path, const struct zyp_allocator *allocator)
+{
+    if (!path) {
+        return NULL;
+    }
+    struct zyp_userdict *ud = (struct zyp_userdict *)zyp_calloc(
+        allocator, sizeof(struct zyp_userdict));
+    if (!ud) {
+        return NULL;
+    }
+    ud->fd = -1;
+    ud->allocator = allocator;
+    size_t pathsize = strlen(path) + 1;
+    ud->path = (char *)zyp_alloc(allocator, pathsize);
+    if (!ud->path) {
+        zyp_userdict_close(ud);
+        return NULL;
+    }
+    memcpy(ud->path, path, pathsize);
+    ud->slots = (struct ud_key *)zyp_calloc(
+        allocator, INITIAL_SLOTS * sizeof(struct ud_key));
+    if (!ud->slots) {
+        zyp_userdict_close(ud);
+        return NULL;
+    }
+    ud->slot_count = INITIAL_SLOTS;
+
+    ud->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (ud->fd < 0 || log_load(ud)) {
+        zyp_userdict_close(ud);
+        return NULL;
+    }
+    // A failed compaction leaves the old log, which is still valid
+    check_compact(ud);
+    if (ud->compact_pending) {
+        zyp_userdict_compact(ud);
+    }
+    return ud;
+}
+
+void zyp_userdict_close(struct zyp_userdict *ud)
+{
+    if (!ud) {
+        return;
+    }
+    if (ud->fd >= 0) {
+        if (ud->compact_pending) {
+            zyp_userdict_compact(ud);
+        }
+        fsync(ud->fd);
+        close(ud->fd);
+    }
+    for (size_t i = 0; i < ud->slot_count; i++) {
+        if (ud->slots[i].sylls) {
+            key_free(ud, &ud->slots[i]);
+        }
+    }
+    const struct zyp_allocator *allocator = ud->allocator;
+    zyp_free(allocator, ud->slots, ud->slot_count * sizeof(ud->slots[0]));
+    zyp_free(allocator, ud->record, ud->record_capacity);
+    if (ud->path) {
+        zyp_free(allocator, ud->path, strlen(ud->path) + 1);
+    }
+    zyp_free(allocator, ud, sizeof(*ud));
+}
+
+size_t zyp_userdict_lookup(const struct zyp_userdict *ud,
+                           const uint16_t *sylls, size_t len,
+                           const struct zyp_userdict_phrase **phrases)
+{
+    if (!ud || !sylls || !len || len > UINT16_MAX || !phrases) {
+        return 0;
+    }
+    const struct ud_key *key = key_find(ud, sylls, len);
+    if (!key || !key->count) {
+        return 0;
+    }
+    *phrases = key->phrases;
+    return key->count;
+}
+
+static inline bool phrase_valid(const uint16_t *sylls, size_t len,
+                                const char *text, size_t textlen)
+{
+    return sylls && len && len <= UINT16_MAX && text && textlen
+           && textlen <= UINT32_MAX - sizeof(struct log_record)
+                         - UINT16_MAX * sizeof(uint16_t)
+           && !memchr(text, '\0', textlen);
+}
+
+int zyp_userdict_learn(struct zyp_userdict *ud, const uint16_t *sylls,
+                       size_t len, const char *text, size_t textlen,
+                       uint32_t frequency)
+{
+    if (!ud || !phrase_valid(sylls, len, text, textlen)) {
+        return 1;
+    }
+
+    uint32_t old = 0;
+    bool found = false;
+    struct ud_key *key = key_find(ud, sylls, len);
+    if (key) {
+        size_t i = phrase_find(key, text, textlen);
+        if (i < key->count) {
+            old = key->phrases[i].frequency;
+            found = true;
+        }
+    }
+    uint32_t newfreq = frequency > UINT32_MAX - old ? UINT32_MAX
+                                                    : old + frequency;
+
+    // Apply first, the allocations can fail but undoing the change cannot
+    if (apply_set(ud, sylls, len, text, textlen, newfreq)) {
+        return 1;
+    }
+    if (log_append(ud, LOG_SET, sylls, len, text, textlen, newfreq)) {
+        // The change is not persisted, so the memory goes back to the log
+        if (found) {
+            key = key_find(ud, sylls, len);
+            size_t i = phrase_find(key, text, textlen);
+            key->phrases[i].frequency = old;
+            phrase_reorder(key, i);
+        } else {
+            apply_remove(ud, sylls, len, text, textlen);
+        }
+        return 1;
+    }
+    check_compact(ud);
+    return 0;
+}
+
+int zyp_userdict_remove(struct zyp_userdict *ud, const uint16_t *sylls,
+                        size_t len, const char *text, size_t textlen)
+{
+    if (!ud || !phrase_valid(sylls, len, text, textlen)) {
+        return 1;
+    }
+    const struct ud_key *key = key_find(ud, sylls, len);
+    if (!key || phrase_find(key, text, textlen) == key->count) {
+        return 0;
+    }
+    if (log_append(ud, LOG_REMOVE, sylls, len, text, textlen, 0)) {
+        return 1;
+    }
+    apply_remove(ud, sylls, len, text, textlen);
+    check_compact(ud);
+    return 0;
+}
+
+size_t zyp_userdict_count(const struct zyp_userdict *ud)
+{
+    if (!ud) {
+        return 0;
+    }
+    return ud->phrase_count;
+}
+
+int zyp_userdict_sync(struct zyp_userdict *ud)
+{
+    if (!ud) {
+        return 1;
+    }
+    return fsync(ud->fd) != 0;
+}
+
+bool zyp_userdict_compact_pending(const struct zyp_userdict *ud)
+{
+    return ud && ud->compact_pending;
+}
+
+// Write a record of every phrase to the file
+static int compact_write(struct zyp_userdict *ud, int fd)
+{
+    const struct log_header hdr = {
+        .magic = LOG_MAGIC,
+        .version = LOG_VERSION,
+    };
+    unsigned char *buf = (unsigned char *)zyp_alloc(ud->allocator,
+                                                  COMPACT_BUFFER_SIZE);
+    if (!buf) {
+        return 1;
+    }
+    memcpy(buf, &hdr, sizeof(hdr));
+    size_t used = sizeof(hdr);
+    uint64_t total = sizeof(hdr);
+
+    for (size_t i = 0; i < ud->slot_count; i++) {
+        const struct ud_key *key = &ud->slots[i];
+        for (uint32_t j = 0; key->sylls && j < key->count; j++) {
+            const struct zyp_userdict_phrase *p = &key->phrases[j];
+            size_t size = record_encode(ud, LOG_SET, key->sylls, key->len,
+                                        p->text, p->text_length,
+                                        p->frequency);
+            if (!size) {
+                zyp_free(ud->allocator, buf, COMPACT_BUFFER_SIZE);
+                return 1;
+            }
+            if (used + size > COMPACT_BUFFER_SIZE) {
+                if (write_all(fd, buf, used)) {
+                    zyp_free(ud->allocator, buf, COMPACT_BUFFER_SIZE);
+                    return 1;
+                }
+                used = 0;
+            }
+            // A large record is written directly
+            if (size > COMPACT_BUFFER_SIZE) {
+                if (write_all(fd, ud->record, size)) {
+                    zyp_free(ud->allocator, buf, COMPACT_BUFFER_SIZE);
+                    return 1;
+                }
+            } else {
+                memcpy(buf + used, ud->record, size);
+                used += size;
+            }
+            total += size;
+        }
+    }
+    int err = write_all(fd, buf, used) || fsync(fd);
+    zyp_free(ud->allocator, buf, COMPACT_BUFFER_SIZE);
+    if (!err) {
+        ud->log_size = total;
+        ud->log_records = ud->phrase_count;
+    }
+    return err;
+}
+
+int zyp_userdict_compact(struct zyp_userdict *ud)
+{
+    if (!ud) {
+        return 1;
+    }
+
+    size_t pathlen = strlen(ud->path);
+    size_t tmpsize = pathlen + sizeof(".tmp");
+    char *tmppath = (char *)zyp_alloc(ud->allocator, tmpsize);
+    if (!tmppath) {
+        return 1;
+    }
+    memcpy(tmppath, ud->path, pathlen);
+    memcpy(tmppath + pathlen, ".tmp", sizeof(".tmp"));
+
+    uint64_t log_size = ud->log_size;
+    size_t log_records = ud->log_records;
+    int fd = open(tmppath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        zyp_free(ud->allocator, tmppath, tmpsize);
+        return 1;
+    }
+    if (compact_write(ud, fd) || rename(tmppath, ud->path)) {
+        close(fd);
+        unlink(tmppath);
+        zyp_free(ud->allocator, tmppath, tmpsize);
+        ud->log_size = log_size;
+        ud->log_records = log_records;
+        return 1;
+    }
+    zyp_free(ud->allocator, tmppath, tmpsize);
+    ud->compact_pending = false;
+
+    // The descriptor still refers to the renamed file, append to it
+    close(ud->fd);
+    ud->fd = fd;
+    if (lseek(fd, 0, SEEK_END) < 0) {
+        return 1;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_APPEND)) {
+        return 1;
+    }
+
+    // Drop the keys without phrases
+    slots_rehash(ud, ud->slot_count);
+    return 0;
+}
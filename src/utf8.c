@@ -1,12 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include "alloc.h"
+#include "cpu.h"
 #include "utf8.h"
 
+#if ZYP_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
 #define BITMASK_EQU(b, mask, exp) ((b & mask) == exp)
 #define UTF8_IS_CONTIN(b) (BITMASK_EQU(b, 0xC0, 0x80))
 #define UTF8_REPLACEMENT "\xEF\xBF\xBD"
+/** Strings shorter than this are validated by the scalar code */
+#define CHECK_SIMD_MIN_LENGTH 16
+/** Ranges shorter than this are counted and searched by the scalar code */
+#define COUNT_SIMD_MIN_LENGTH 16
+/** Charactors of a null terminated string walked one by one by utf8_nthchr() */
+#define NTHCHR_WALK_LENGTH 32
+/**
+ * Bytes of a null terminated string searched after the walk by
+ * utf8_nthchr(), doubled for each next chunk up to NTHCHR_MAX_CHUNK_SIZE
+ */
+#define NTHCHR_CHUNK_SIZE 64
+#define NTHCHR_MAX_CHUNK_SIZE 4096
+
+/*
+ * A charactor begins at every byte but the continuation bytes 10xxxxxx, so
+ * counting charactors is counting those bytes, and the nth charactor begins
+ * at the nth of them. As signed chars, the continuation bytes are the ones
+ * not greater than -65 (0xBF), so a block is classified with one compare.
+ */
+
+static size_t count_scalar(const char *s, size_t len)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += !UTF8_IS_CONTIN((unsigned char)s[i]);
+    }
+    return count;
+}
+
+/**
+ * Return the index of the charactor `*n` in `s[0, len)`. If there are not so
+ * many charactors, return `len` and subtract the charactors found from `*n`,
+ * so the search can go on from `s + len`.
+ */
+static size_t seek_scalar(const char *s, size_t len, size_t *n)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (!UTF8_IS_CONTIN((unsigned char)s[i])) {
+            if (!*n) {
+                return i;
+            }
+            (*n)--;
+        }
+    }
+    return len;
+}
+
+#if ZYP_HAVE_X86_SIMD
+ZYP_TARGET("sse2")
+static size_t count_sse2(const char *s, size_t len)
+{
+    const __m128i cont_max = _mm_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    while (i + 16 <= len) {
+        // Each byte of `acc` counts up to 255 blocks, then the bytes are
+        // summed into two 16 bits sums
+        __m128i acc = _mm_setzero_si128();
+        for (int k = 0; k < 255 && i + 16 <= len; k++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, cont_max));
+        }
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sum)
+                 + (size_t)_mm_extract_epi16(sum, 4);
+    }
+    return count + count_scalar(s + i, len - i);
+}
+
+ZYP_TARGET("sse2")
+static size_t seek_sse2(const char *s, size_t len, size_t *n)
+{
+    const __m128i cont_max = _mm_set1_epi8(-65);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_cmpgt_epi8(v, cont_max));
+        size_t count = (size_t)__builtin_popcount(mask);
+        if (count > *n) {
+            // Drop the lowest `*n` charactors of the block
+            for (size_t k = *n; k; k--) {
+                mask &= mask - 1;
+            }
+            *n = 0;
+            return i + (size_t)__builtin_ctz(mask);
+        }
+        *n -= count;
+    }
+    return i + seek_scalar(s + i, len - i, n);
+}
+
+ZYP_TARGET("avx2")
+static size_t count_avx2(const char *s, size_t len)
+{
+    const __m256i cont_max = _mm256_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    while (i + 32 <= len) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < 255 && i + 32 <= len; k++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, cont_max));
+        }
+        __m256i sad = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sad),
+                                    _mm256_extracti128_si256(sad, 1));
+        count += (size_t)_mm_cvtsi128_si32(sum)
+                 + (size_t)_mm_extract_epi16(sum, 4);
+    }
+    return count + count_scalar(s + i, len - i);
+}
+
+// Every CPU with AVX2 has POPCNT, so the popcount is one instruction here
+ZYP_TARGET("avx2,popcnt")
+static size_t seek_avx2(const char *s, size_t len, size_t *n)
+{
+    const __m256i cont_max = _mm256_set1_epi8(-65);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+                _mm256_cmpgt_epi8(v, cont_max));
+        size_t count = (size_t)__builtin_popcount(mask);
+        if (count > *n) {
+            for (size_t k = *n; k; k--) {
+                mask &= mask - 1;
+            }
+            *n = 0;
+            return i + (size_t)__builtin_ctz(mask);
+        }
+        *n -= count;
+    }
+    return i + seek_scalar(s + i, len - i, n);
+}
+#endif
+
+typedef size_t (*count_kernel)(const char *s, size_t len);
+typedef size_t (*seek_kernel)(const char *s, size_t len, size_t *n);
+
+static count_kernel select_count_kernel(void)
+{
+#if ZYP_HAVE_X86_SIMD
+    unsigned features = zyp_cpu_features();
+    if (features & ZYP_CPU_AVX2) {
+        return count_avx2;
+    }
+    if (features & ZYP_CPU_SSE2) {
+        return count_sse2;
+    }
+#endif
+    return count_scalar;
+}
+
+static seek_kernel select_seek_kernel(void)
+{
+#if ZYP_HAVE_X86_SIMD
+    unsigned features = zyp_cpu_features();
+    if (features & ZYP_CPU_AVX2) {
+        return seek_avx2;
+    }
+    if (features & ZYP_CPU_SSE2) {
+        return seek_sse2;
+    }
+#endif
+    return seek_scalar;
+}
+
+static inline size_t utf8_seek(const char *s, size_t len, size_t *n)
+{
+    if (len < COUNT_SIMD_MIN_LENGTH) {
+        return seek_scalar(s, len, n);
+    }
+    return select_seek_kernel()(s, len, n);
+}
 
 char *utf8_prevchr(const char *p)
 {
@@ -28,16 +209,55 @@ char *utf8_nextchr(const char *p)
     return (char *)(p + utf8_nextchrsize(p));
 }
 
+// Seek charactor `n` of a null terminated string in bulk
+static const char *nthchr_chunks(const char *p, size_t n)
+{
+    // Search chunks which end at the null charactor at the latest, so no
+    // byte after it is read
+    size_t chunk = NTHCHR_CHUNK_SIZE;
+    for (;;) {
+        size_t avail = strnlen(p, chunk);
+        size_t i = utf8_seek(p, avail, &n);
+        if (i < avail || avail < chunk) {
+            return p + i;
+        }
+        p += avail;
+        if (chunk < NTHCHR_MAX_CHUNK_SIZE) {
+            chunk *= 2;
+        }
+    }
+}
+
+static inline const char *nthchr(const char *p, size_t n)
+{
+    // Most searches are a few charactors, which are found before the
+    // length of the string is worth finding. The walk stays at the null
+    // charactor once it reaches it.
+    size_t walk = n < NTHCHR_WALK_LENGTH ? n : NTHCHR_WALK_LENGTH;
+    n -= walk;
+    while (walk--) {
+        p += utf8_nextchrsize(p);
+    }
+    if (!n || !*p) {
+        return p;
+    }
+    return nthchr_chunks(p, n);
+}
+
 char *utf8_nthchr(const char *p, size_t n)
 {
     if (!p) {
         return NULL;
     }
-    char *c = (char *)p;
-    while (n--) {
-        c = utf8_nextchr(c);
+    return (char *)nthchr(p, n);
+}
+
+char *utf8_nthchr_n(const char *p, size_t len, size_t n)
+{
+    if (!p) {
+        return NULL;
     }
-    return c;
+    return (char *)(p + utf8_seek(p, len, &n));
 }
 
 size_t utf8_strlen(const char *str)
@@ -45,13 +265,18 @@ size_t utf8_strlen(const char *str)
     if (!str) {
         return 0;
     }
+    return utf8_strlen_n(str, strlen(str));
+}
 
-    size_t len = 0;
-    while (*str) {
-        str = utf8_nextchr(str);
-        len++;
+size_t utf8_strlen_n(const char *str, size_t len)
+{
+    if (!str) {
+        return 0;
     }
-    return len;
+    if (len < COUNT_SIMD_MIN_LENGTH) {
+        return count_scalar(str, len);
+    }
+    return select_count_kernel()(str, len);
 }
 
 size_t utf8_rangesize(const char *str, size_t start, size_t end)
@@ -60,15 +285,20 @@ size_t utf8_rangesize(const char *str, size_t start, size_t end)
         return 0;
     }
 
-    size_t sz = 0, len = end - start;
-    for (size_t i = 0; i < start; i++) {
-        str = utf8_nextchr(str);
-    }
-    for (size_t i = 0; i < len; i++) {
-        sz += utf8_nextchrsize(str);
-        str = utf8_nextchr(str);
+    const char *p = nthchr(str, start);
+    return (size_t)(nthchr(p, end - start) - p);
+}
+
+size_t utf8_rangesize_n(const char *str, size_t len, size_t start,
+                        size_t end)
+{
+    if (!str || (start > end)) {
+        return 0;
     }
-    return sz;
+
+    const char *p = utf8_nthchr_n(str, len, start);
+    return (size_t)(utf8_nthchr_n(p, len - (size_t)(p - str), end - start)
+                    - p);
 }
 
 char *utf8_strncpy(char *dest, const char *src, size_t len)
@@ -84,33 +314,44 @@ char *utf8_strncpy(char *dest, const char *src, size_t len)
 }
 
 char *utf8_substr(const char *str, size_t start, size_t end)
+{
+    return utf8_substr_with(str, start, end, NULL);
+}
+
+char *utf8_substr_with(const char *str, size_t start, size_t end,
+                       const struct zyp_allocator *allocator)
 {
     if (!str || (start > end)) {
         return NULL;
     }
 
-    size_t sz = utf8_rangesize(str, start, end);
-    char *buf = (char *)malloc(sz + 1);
+    // Seek the start once, and the end from there
+    const char *p = nthchr(str, start);
+    size_t sz = (size_t)(nthchr(p, end - start) - p);
+    char *buf = (char *)zyp_alloc(allocator, sz + 1);
     if (!buf) {
         return NULL;
     }
 
-    for (size_t i = 0; i < start; i++) {
-        str = utf8_nextchr(str);
-    }
-    strncpy(buf, str, sz);
+    memcpy(buf, p, sz);
     buf[sz] = '\0';
     return buf;
 }
 
 char *utf8_reverse(char *str)
+{
+    return utf8_reverse_with(str, NULL);
+}
+
+char *utf8_reverse_with(const char *str,
+                        const struct zyp_allocator *allocator)
 {
     if (!str) {
         return NULL;
     }
 
     size_t sz = strlen(str);
-    char *buf = (char *)malloc(sz + 1);
+    char *buf = (char *)zyp_alloc(allocator, sz + 1);
     if (!buf) {
         return NULL;
     }
@@ -141,9 +382,12 @@ static inline int utf8_check_nextchar(const char *s)
         if (BITMASK_EQU(*p, 0xFE, 0xC0)) {
             /* Overlong encoding (1100000x) */
             return 0;
-        } else {
-            return 2;
         }
+        if (!UTF8_IS_CONTIN(*(p + 1))) {
+            /* Invalid continuation byte */
+            return 0;
+        }
+        return 2;
     } else if (BITMASK_EQU(*p, 0xF0, 0xE0)) {
         /* UTF8-3 (1110xxxx) */
         if (*p == 0xE0) {
@@ -210,23 +454,282 @@ static inline int utf8_check_nextchar(const char *s)
     }
 }
 
-bool utf8_check(const char *str)
+static bool utf8_check_scalar(const char *str, size_t len)
 {
-    if (!str) {
-        return false;
-    }
-
-    const char *s = str;
-    while (*s) {
-        int offset = utf8_check_nextchar(s);
+    const unsigned char *p = (const unsigned char *)str;
+    size_t i = 0;
+    while (i < len) {
+        if (p[i] < 0x80) {
+            i++;
+            continue;
+        }
+        // utf8_check_nextchar() reads as far as the lead byte tells
+        size_t need = p[i] >= 0xF0 ? 4 : p[i] >= 0xE0 ? 3 : 2;
+        if (need > len - i) {
+            return false;
+        }
+        int offset = utf8_check_nextchar(str + i);
         if (!offset) {
             return false;
         }
-        s += offset;
+        i += offset;
     }
     return true;
 }
 
+#if ZYP_HAVE_X86_SIMD
+/*
+ * The vectorized validators follow "Validating UTF-8 In Less Than One
+ * Instruction Per Byte" by Keiser and Lemire. Each byte is checked with the
+ * byte before it by looking up three tables, by the high nibble of the
+ * previous byte, the low nibble of the previous byte and the high nibble of
+ * the byte. Each table entry is a set of the errors the nibble can be part
+ * of, so the AND of the three is the set of errors found. The sequences
+ * which need to look further back, the 3rd and 4th bytes, are checked by
+ * comparing where continuation bytes are expected with where they are.
+ */
+#define TOO_SHORT (1 << 0)      ///< A lead byte not followed by continuation
+#define TOO_LONG (1 << 1)       ///< A continuation byte after ASCII
+#define OVERLONG_3 (1 << 2)     ///< 11100000 100xxxxx
+#define TOO_LARGE (1 << 3)      ///< 11110100 1001xxxx, or 11110101 and above
+#define SURROGATE (1 << 4)      ///< 11101101 101xxxxx
+#define OVERLONG_2 (1 << 5)     ///< 1100000x
+#define TOO_LARGE_1000 (1 << 6) ///< 11110101 1000xxxx and above
+#define OVERLONG_4 (1 << 6)     ///< 11110000 1000xxxx
+#define TWO_CONTS (1 << 7)      ///< Two continuation bytes, maybe valid
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const uint8_t BYTE_1_HIGH[16] = {
+    /* 0xxx: ASCII */
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    /* 10xx: continuation */
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    /* 1100: 2 bytes lead */
+    TOO_SHORT | OVERLONG_2,
+    /* 1101: 2 bytes lead */
+    TOO_SHORT,
+    /* 1110: 3 bytes lead */
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    /* 1111: 4 bytes lead */
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const uint8_t BYTE_1_LOW[16] = {
+    /* 0000 */
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    /* 0001 */
+    CARRY | OVERLONG_2,
+    /* 001x */
+    CARRY, CARRY,
+    /* 0100 */
+    CARRY | TOO_LARGE,
+    /* 0101 ... 1100 */
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    /* 1101 */
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    /* 111x */
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+static const uint8_t BYTE_2_HIGH[16] = {
+    /* 0xxx: ASCII */
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    /* 1000 */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000
+        | OVERLONG_4,
+    /* 1001 */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    /* 101x */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    /* 11xx: lead */
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+/**
+ * The bytes of a block which are greater than these start a sequence
+ * longer than the block, they are checked with the next block
+ */
+#define INCOMPLETE_MAX_TAIL (char)0xEF, (char)0xDF, (char)0xBF
+
+ZYP_TARGET("sse4.1")
+static inline __m128i check_block_sse41(__m128i input, __m128i prev_input)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)BYTE_1_HIGH),
+            _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)BYTE_1_LOW),
+            _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)BYTE_2_HIGH),
+            _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low),
+                                    byte_2_high);
+
+    // The bytes 2 and 3 after a lead of 3 or 4 bytes must be continuation,
+    // where the tables have found TWO_CONTS
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth),
+                                   _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+ZYP_TARGET("sse4.1")
+static bool utf8_check_sse41(const char *str, size_t len)
+{
+    const __m128i max_tail = _mm_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            INCOMPLETE_MAX_TAIL);
+    __m128i error = _mm_setzero_si128();
+    __m128i prev = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    char tail[16];
+    size_t i = 0;
+    for (;;) {
+        // The last block is padded with ASCII, it ends any sequence left
+        __m128i input;
+        if (i + sizeof(tail) <= len) {
+            input = _mm_loadu_si128((const __m128i *)(str + i));
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, str + i, len - i);
+            input = _mm_loadu_si128((const __m128i *)tail);
+        }
+        if (!_mm_movemask_epi8(input)) {
+            error = _mm_or_si128(error, prev_incomplete);
+        } else {
+            error = _mm_or_si128(error, check_block_sse41(input, prev));
+            prev_incomplete = _mm_subs_epu8(input, max_tail);
+        }
+        prev = input;
+        if (i + sizeof(tail) > len) {
+            break;
+        }
+        i += sizeof(tail);
+    }
+    return _mm_testz_si128(error, error);
+}
+
+ZYP_TARGET("avx2")
+static inline __m256i check_block_avx2(__m256i input, __m256i prev_input)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // The previous block's high lane and this block's low lane, to shift
+    // the bytes in from
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i byte_1_high = _mm256_shuffle_epi8(
+            _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *)BYTE_1_HIGH)),
+            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(
+            _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *)BYTE_1_LOW)),
+            _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(
+            _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *)BYTE_2_HIGH)),
+            _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(
+            _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                      _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+ZYP_TARGET("avx2")
+static bool utf8_check_avx2(const char *str, size_t len)
+{
+    const __m256i max_tail = _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            INCOMPLETE_MAX_TAIL);
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    char tail[32];
+    size_t i = 0;
+    for (;;) {
+        __m256i input;
+        if (i + sizeof(tail) <= len) {
+            input = _mm256_loadu_si256((const __m256i *)(str + i));
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, str + i, len - i);
+            input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (!_mm256_movemask_epi8(input)) {
+            error = _mm256_or_si256(error, prev_incomplete);
+        } else {
+            error = _mm256_or_si256(error, check_block_avx2(input, prev));
+            prev_incomplete = _mm256_subs_epu8(input, max_tail);
+        }
+        prev = input;
+        if (i + sizeof(tail) > len) {
+            break;
+        }
+        i += sizeof(tail);
+    }
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+typedef bool (*check_kernel)(const char *str, size_t len);
+
+static check_kernel select_check_kernel(void)
+{
+#if ZYP_HAVE_X86_SIMD
+    unsigned features = zyp_cpu_features();
+    if (features & ZYP_CPU_AVX2) {
+        return utf8_check_avx2;
+    }
+    if (features & ZYP_CPU_SSE41) {
+        return utf8_check_sse41;
+    }
+#endif
+    return utf8_check_scalar;
+}
+
+bool utf8_check_n(const char *str, size_t len)
+{
+    if (!str) {
+        return false;
+    }
+    if (len < CHECK_SIMD_MIN_LENGTH) {
+        return utf8_check_scalar(str, len);
+    }
+    return select_check_kernel()(str, len);
+}
+
+bool utf8_check(const char *str)
+{
+    if (!str) {
+        return false;
+    }
+    return utf8_check_n(str, strlen(str));
+}
+
 #define STR_APPEND(dest, src, size) \
     do { \
         strncpy(dest, src, size); \
@@ -234,19 +737,38 @@ bool utf8_check(const char *str)
     } while (false)
 
 char *utf8_correct(const char *str)
+{
+    return utf8_correct_with(str, NULL);
+}
+
+char *utf8_correct_with(const char *str,
+                        const struct zyp_allocator *allocator)
 {
     if (!str) {
         return NULL;
     }
 
-    size_t sz = strlen(str);
-    char *buf = (char *)malloc(sz * 3 + 1);
+    // Each invalid byte becomes a replacement charactor, count them first
+    // so the result is allocated with its exact size
+    size_t sz = 0;
+    const char *p = str;
+    while (*p) {
+        int offset = utf8_check_nextchar(p);
+        if (!offset) {
+            sz += strlen(UTF8_REPLACEMENT);
+            p += 1;
+        } else {
+            sz += offset;
+            p += offset;
+        }
+    }
+    char *buf = (char *)zyp_alloc(allocator, sz + 1);
     if (!buf) {
         return NULL;
     }
     char *bufptr = buf;
 
-    const char *p = str;
+    p = str;
     while (*p) {
         int offset = utf8_check_nextchar(p);
         if (!offset) {
@@ -279,3 +801,64 @@ uint32_t utf8_getchr(const char *str)
     }
     return val;
 }
+
+uint32_t utf8_decode(const char *str, size_t *size)
+{
+    const unsigned char *p = (const unsigned char *)str;
+    size_t sz = utf8_nextchrsize(str);
+    uint32_t cp;
+    switch (sz) {
+    case 1:
+        cp = p[0];
+        break;
+    case 2:
+        cp = (uint32_t)(p[0] & 0x1F) << 6 | (p[1] & 0x3F);
+        break;
+    case 3:
+        cp = (uint32_t)(p[0] & 0x0F) << 12 | (uint32_t)(p[1] & 0x3F) << 6
+             | (p[2] & 0x3F);
+        break;
+    case 4:
+        cp = (uint32_t)(p[0] & 0x07) << 18 | (uint32_t)(p[1] & 0x3F) << 12
+             | (uint32_t)(p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+        break;
+    default:
+        cp = 0;
+        break;
+    }
+    if (size) {
+        *size = sz;
+    }
+    return cp;
+}
+
+size_t utf8_encode(char *dest, uint32_t cp)
+{
+    unsigned char *p = (unsigned char *)dest;
+    if (cp < 0x80) {
+        p[0] = (unsigned char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        p[0] = (unsigned char)(0xC0 | cp >> 6);
+        p[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            /* Surrogates */
+            return 0;
+        }
+        p[0] = (unsigned char)(0xE0 | cp >> 12);
+        p[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+        p[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    } else if (cp < 0x110000) {
+        p[0] = (unsigned char)(0xF0 | cp >> 18);
+        p[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3F));
+        p[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+        p[3] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 4;
+    } else {
+        /* Out of range */
+        return 0;
+    }
+}
@@ -5,6 +5,8 @@
  * Provide functions for UTF-8 encoded strings
  */
 
+#include <zyphtine/alloc.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -17,6 +19,17 @@
  */
 size_t utf8_strlen(const char *str);
 
+/**
+ * Return the length in charactors of the first `len` bytes of the string
+ * The bytes are counted 16 or 32 at a time when the CPU supports SSE2 or
+ * AVX2.
+ *
+ * @param str valid UTF-8 string
+ * @param len size in bytes of the string
+ * @return total charactors in the string
+ */
+size_t utf8_strlen_n(const char *str, size_t len);
+
 /**
  * Return the size in bytes of the first charactor
  * @note if the next charactor is `NUL` (null charactor),
@@ -52,6 +65,19 @@ static inline size_t utf8_nextchrsize(const char *str)
  */
 size_t utf8_rangesize(const char *str, size_t start, size_t end);
 
+/**
+ * Return the size in bytes in the given `[start, end)` charactor range of the
+ * first `len` bytes of the string
+ *
+ * @param str valid UTF-8 string
+ * @param len size in bytes of the string
+ * @param start the start position in charactors
+ * @param end the end position in charactors
+ * @return total bytes in the range, up to the end of the string
+ */
+size_t utf8_rangesize_n(const char *str, size_t len, size_t start,
+                        size_t end);
+
 /**
  * Copy the provided string, but for a given number of charactors
  * @note The buffer should have at least `4 * len + 1` bytes
@@ -83,10 +109,24 @@ char *utf8_nextchr(const char *p);
  * Get the position of the nth charactor in the string
  *
  * @param p a valid position in UTF-8 string
- * @return position to the next nth charactor
+ * @return position to the next nth charactor, or the null charactor if the
+ * string is shorter
  */
 char *utf8_nthchr(const char *p, size_t n);
 
+/**
+ * Get the position of the nth charactor in the first `len` bytes of the
+ * string
+ * The bytes are searched 16 or 32 at a time when the CPU supports SSE2 or
+ * AVX2.
+ *
+ * @param p a valid position in UTF-8 string
+ * @param len size in bytes of the string from `p`
+ * @return position to the next nth charactor, or `p + len` if the string is
+ * shorter
+ */
+char *utf8_nthchr_n(const char *p, size_t len, size_t n);
+
 /**
  * Copy a substring of the given string in the `[start, end)` range bound
  *
@@ -97,6 +137,18 @@ char *utf8_nthchr(const char *p, size_t n);
  */
 char *utf8_substr(const char *str, size_t start, size_t end);
 
+/**
+ * Copy a substring like utf8_substr(), allocated from an allocator
+ *
+ * @param str valid UTF-8 string
+ * @param allocator allocator of the result, or NULL for malloc()
+ * @return copied substring
+ * @note The returned string has `strlen() + 1` bytes, which is the size to
+ * free it with.
+ */
+char *utf8_substr_with(const char *str, size_t start, size_t end,
+                       const struct zyp_allocator *allocator);
+
 /**
  * Reverse the charactors in the string
  *
@@ -107,6 +159,18 @@ char *utf8_substr(const char *str, size_t start, size_t end);
  */
 char *utf8_reverse(char *str);
 
+/**
+ * Reverse the charactors like utf8_reverse(), allocated from an allocator
+ *
+ * @param str valid UTF-8 string
+ * @param allocator allocator of the result, or NULL for malloc()
+ * @return the allocated reversed string
+ * @note The returned string has `strlen() + 1` bytes, which is the size to
+ * free it with.
+ */
+char *utf8_reverse_with(const char *str,
+                        const struct zyp_allocator *allocator);
+
 /**
  * Validate the given sequence to check if it is a valid UTF-8 string
  *
@@ -115,6 +179,17 @@ char *utf8_reverse(char *str);
  */
 bool utf8_check(const char *str);
 
+/**
+ * Validate the first `len` bytes of the sequence as a UTF-8 string
+ * The bytes are checked 16 or 32 at a time when the CPU supports SSE4.1 or
+ * AVX2. A null charactor in the range is valid, as U+0000.
+ *
+ * @param str a bytes sequence to be verified
+ * @param len size in bytes of the sequence
+ * @return if all the bytes are valid UTF-8 sequence
+ */
+bool utf8_check_n(const char *str, size_t len);
+
 /**
  * Check and replace invalid charactors with `�(U+FFFD)`. If the string is valid,
  * it will return a copy of it.
@@ -126,6 +201,18 @@ bool utf8_check(const char *str);
  */
 char *utf8_correct(const char *str);
 
+/**
+ * Correct the string like utf8_correct(), allocated from an allocator
+ *
+ * @param str a bytes sequence to be verified
+ * @param allocator allocator of the result, or NULL for malloc()
+ * @return The corrected UTF-8 string
+ * @note The returned string has `strlen() + 1` bytes, which is the size to
+ * free it with.
+ */
+char *utf8_correct_with(const char *str,
+                        const struct zyp_allocator *allocator);
+
 /**
  * Get the UTF-8 charactor(4 bytes) of the current position
  *
@@ -134,6 +221,25 @@ char *utf8_correct(const char *str);
  */
 uint32_t utf8_getchr(const char *str);
 
+/**
+ * Decode the charactor of the current position to a Unicode code point
+ *
+ * @param str pointer to a valid position in UTF-8 string
+ * @param size where to store the size in bytes of the charactor, can be NULL
+ * @return code point of the charactor, 0 at the end of the string
+ */
+uint32_t utf8_decode(const char *str, size_t *size);
+
+/**
+ * Encode a Unicode code point to UTF-8, without a null charactor
+ * @note The buffer should have at least 4 bytes
+ *
+ * @param dest buffer to be filled
+ * @param cp Unicode code point
+ * @return size in bytes written, 0 if the code point is not valid
+ */
+size_t utf8_encode(char *dest, uint32_t cp);
+
 /**
  * Get the size of the UTF-8 charactor
  * @todo unimplemented
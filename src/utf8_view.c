@@ -0,0 +1,178 @@
+#include "utf8_view.h"
+#include "cpu.h"
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#if ZYP_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define UTF8_IS_CONTIN(b) (((b) & 0xC0) == 0x80)
+/** Views shorter than this are searched by the scalar code */
+#define FIND_SIMD_MIN_LENGTH 64
+
+/*
+ * A string of two bytes or more is searched by its first and last bytes:
+ * only the positions where both match are compared in full. In CJK text the
+ * first byte alone matches every few bytes, as there are few lead bytes,
+ * while the pair of the lead byte and a continuation byte is rare.
+ */
+
+// Find `n[0, nlen)` in `h[0, hlen)`, with `2 <= nlen <= hlen`
+static const char *find_scalar(const char *h, size_t hlen, const char *n,
+                               size_t nlen)
+{
+    const char *last = h + (hlen - nlen);
+    for (const char *p = h; p <= last; p++) {
+        p = memchr(p, n[0], (size_t)(last - p) + 1);
+        if (!p) {
+            return NULL;
+        }
+        if (p[nlen - 1] == n[nlen - 1]
+            && !memcmp(p + 1, n + 1, nlen - 2)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+#if ZYP_HAVE_X86_SIMD
+ZYP_TARGET("sse2")
+static const char *find_sse2(const char *h, size_t hlen, const char *n,
+                             size_t nlen)
+{
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[nlen - 1]);
+    size_t i = 0;
+    // Block `i` has the candidates `[i, i + 16)`, which all fit in `h`
+    for (; i + nlen - 1 + 16 <= hlen; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i + nlen - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(a, first),
+                              _mm_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            const char *p = h + i + __builtin_ctz(mask);
+            if (!memcmp(p + 1, n + 1, nlen - 2)) {
+                return p;
+            }
+        }
+    }
+    return find_scalar(h + i, hlen - i, n, nlen);
+}
+
+ZYP_TARGET("avx2")
+static const char *find_avx2(const char *h, size_t hlen, const char *n,
+                             size_t nlen)
+{
+    const __m256i first = _mm256_set1_epi8(n[0]);
+    const __m256i last = _mm256_set1_epi8(n[nlen - 1]);
+    size_t i = 0;
+    for (; i + nlen - 1 + 32 <= hlen; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + nlen - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                 _mm256_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            const char *p = h + i + __builtin_ctz(mask);
+            if (!memcmp(p + 1, n + 1, nlen - 2)) {
+                return p;
+            }
+        }
+    }
+    return find_scalar(h + i, hlen - i, n, nlen);
+}
+#endif
+
+typedef const char *(*find_kernel)(const char *h, size_t hlen, const char *n,
+                                   size_t nlen);
+
+static find_kernel select_find_kernel(void)
+{
+#if ZYP_HAVE_X86_SIMD
+    unsigned features = zyp_cpu_features();
+    if (features & ZYP_CPU_AVX2) {
+        return find_avx2;
+    }
+    if (features & ZYP_CPU_SSE2) {
+        return find_sse2;
+    }
+#endif
+    return find_scalar;
+}
+
+size_t utf8_view_length(struct utf8_view view)
+{
+    return utf8_strlen_n(view.data, view.size);
+}
+
+struct utf8_view utf8_view_slice(struct utf8_view view, size_t start,
+                                 size_t end)
+{
+    const char *view_end = view.data + view.size;
+    const char *s = utf8_nthchr_n(view.data, view.size, start);
+    const char *e = end > start
+                        ? utf8_nthchr_n(s, (size_t)(view_end - s), end - start)
+                        : s;
+    return utf8_view_make(s, (size_t)(e - s));
+}
+
+bool utf8_view_prev(struct utf8_view *view, uint32_t *cp)
+{
+    if (!view->size) {
+        return false;
+    }
+    // A charactor has at most 3 continuation bytes
+    size_t start = view->size - 1;
+    while (start && view->size - start < 4
+           && UTF8_IS_CONTIN((unsigned char)view->data[start])) {
+        start--;
+    }
+    struct utf8_view last = utf8_view_make(view->data + start,
+                                           view->size - start);
+    utf8_view_next(&last, cp);
+    view->size = start;
+    return true;
+}
+
+int utf8_view_compare(struct utf8_view a, struct utf8_view b)
+{
+    size_t size = a.size < b.size ? a.size : b.size;
+    int cmp = size ? memcmp(a.data, b.data, size) : 0;
+    if (cmp) {
+        return cmp;
+    }
+    return (a.size > b.size) - (a.size < b.size);
+}
+
+const char *utf8_view_find(struct utf8_view view, struct utf8_view needle)
+{
+    if (!needle.size) {
+        return view.data;
+    }
+    if (needle.size > view.size) {
+        return NULL;
+    }
+    if (needle.size == 1) {
+        return memchr(view.data, needle.data[0], view.size);
+    }
+    if (view.size < FIND_SIMD_MIN_LENGTH) {
+        return find_scalar(view.data, view.size, needle.data, needle.size);
+    }
+    return select_find_kernel()(view.data, view.size, needle.data,
+                                needle.size);
+}
+
+const char *utf8_view_find_chr(struct utf8_view view, uint32_t cp)
+{
+    char buf[4];
+    size_t size = utf8_encode(buf, cp);
+    if (!size) {
+        return NULL;
+    }
+    return utf8_view_find(view, utf8_view_make(buf, size));
+}
@@ -0,0 +1,180 @@
+#ifndef _ZYP_UTF8_VIEW_H
+#define _ZYP_UTF8_VIEW_H
+/**
+ * @file
+ * Provide a length-delimited view of a UTF-8 string
+ *
+ * A view is a pointer and a size in bytes, which borrows the bytes of a
+ * string owned by something else, such as the text pool of a mapped
+ * dictionary. The string needs no null charactor, and none of the functions
+ * allocate: a slice is a view of the same bytes. The bytes must stay valid
+ * and unchanged while the view is used.
+ *
+ * Views are passed and returned by value, they are as small as two pointers.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** A view of `size` bytes of a UTF-8 string from `data` */
+struct utf8_view {
+    const char *data;
+    size_t size;
+};
+
+/**
+ * Make a view of `size` bytes
+ *
+ * @param data valid UTF-8 string, can be NULL if `size` is 0
+ * @param size size in bytes of the string
+ * @return view of the string
+ */
+static inline struct utf8_view utf8_view_make(const char *data, size_t size)
+{
+    struct utf8_view view = { data, size };
+    return view;
+}
+
+/**
+ * Make a view of a null terminated string, without the null charactor
+ *
+ * @param str valid UTF-8 string
+ * @return view of the string
+ */
+static inline struct utf8_view utf8_view_from(const char *str)
+{
+    return utf8_view_make(str, strlen(str));
+}
+
+static inline bool utf8_view_is_empty(struct utf8_view view)
+{
+    return view.size == 0;
+}
+
+/**
+ * Return the length in charactors of the view
+ *
+ * @param view view of a valid UTF-8 string
+ * @return total charactors in the view
+ */
+size_t utf8_view_length(struct utf8_view view);
+
+/**
+ * Get the view of the charactors in the given `[start, end)` range
+ *
+ * @param view view of a valid UTF-8 string
+ * @param start the start position in charactors
+ * @param end the end position in charactors
+ * @return view of the range, up to the end of the view
+ */
+struct utf8_view utf8_view_slice(struct utf8_view view, size_t start,
+                                 size_t end);
+
+/**
+ * Decode the first charactor and remove it from the view
+ * A charactor cut by the end of the view, or a stray continuation byte, is
+ * removed as `�(U+FFFD)`.
+ *
+ * @param view view to iterate, moved past the charactor
+ * @param cp where to store the code point of the charactor
+ * @return false if the view is empty
+ */
+static inline bool utf8_view_next(struct utf8_view *view, uint32_t *cp)
+{
+    if (!view->size) {
+        return false;
+    }
+    const unsigned char *p = (const unsigned char *)view->data;
+    // A null charactor is one byte here, not the end of the string
+    size_t size = 1;
+    if (p[0] < 0x80) {
+        *cp = p[0];
+    } else if (p[0] < 0xC0) {
+        *cp = 0xFFFD;
+    } else {
+        size = p[0] >= 0xF0 ? 4 : p[0] >= 0xE0 ? 3 : 2;
+        if (size > view->size) {
+            size = view->size;
+            *cp = 0xFFFD;
+        } else if (size == 2) {
+            *cp = (uint32_t)(p[0] & 0x1F) << 6 | (p[1] & 0x3F);
+        } else if (size == 3) {
+            *cp = (uint32_t)(p[0] & 0x0F) << 12
+                  | (uint32_t)(p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+        } else {
+            *cp = (uint32_t)(p[0] & 0x07) << 18
+                  | (uint32_t)(p[1] & 0x3F) << 12
+                  | (uint32_t)(p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+        }
+    }
+    view->data += size;
+    view->size -= size;
+    return true;
+}
+
+/**
+ * Decode the last charactor and remove it from the view
+ *
+ * @param view view to iterate, shortened before the charactor
+ * @param cp where to store the code point of the charactor
+ * @return false if the view is empty
+ */
+bool utf8_view_prev(struct utf8_view *view, uint32_t *cp);
+
+/**
+ * Compare two views byte by byte, which is the order of their code points
+ *
+ * @param a view of a valid UTF-8 string
+ * @param b view of a valid UTF-8 string
+ * @return less than, equal to or greater than 0 if `a` is before, equal to
+ * or after `b`
+ */
+int utf8_view_compare(struct utf8_view a, struct utf8_view b);
+
+static inline bool utf8_view_equal(struct utf8_view a, struct utf8_view b)
+{
+    return a.size == b.size && (!a.size || !memcmp(a.data, b.data, a.size));
+}
+
+static inline bool utf8_view_starts_with(struct utf8_view view,
+                                         struct utf8_view prefix)
+{
+    return view.size >= prefix.size
+           && utf8_view_equal(utf8_view_make(view.data, prefix.size), prefix);
+}
+
+static inline bool utf8_view_ends_with(struct utf8_view view,
+                                       struct utf8_view suffix)
+{
+    return view.size >= suffix.size
+           && utf8_view_equal(
+               utf8_view_make(view.data + view.size - suffix.size,
+                              suffix.size),
+               suffix);
+}
+
+/**
+ * Find the first occurrence of a string in the view
+ * As no charactor is encoded within another, every match is on charactor
+ * boundaries.
+ *
+ * @param view view of a valid UTF-8 string
+ * @param needle view of the valid UTF-8 string to find
+ * @retval NULL the string is not found
+ * @return position of the first occurrence, `view.data` if `needle` is empty
+ */
+const char *utf8_view_find(struct utf8_view view, struct utf8_view needle);
+
+/**
+ * Find the first occurrence of a charactor in the view
+ *
+ * @param view view of a valid UTF-8 string
+ * @param cp Unicode code point of the charactor
+ * @retval NULL the charactor is not found, or the code point is not valid
+ * @return position of the first occurrence
+ */
+const char *utf8_view_find_chr(struct utf8_view view, uint32_t cp);
+
+#endif
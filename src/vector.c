@@ -1,6 +1,8 @@
 #include "vector.h"
+#include "alloc.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,6 +14,7 @@ struct zyp_vec {
     size_t element_size;
     size_t length;
     size_t capacity;
+    const struct zyp_allocator *allocator;
 };
 
 static inline void *_zyp_vec_fast_get(struct zyp_vec *vec, size_t index)
@@ -19,6 +22,20 @@ static inline void *_zyp_vec_fast_get(struct zyp_vec *vec, size_t index)
     return vec->buffer + (vec->element_size * index);
 }
 
+// Make room for `count` more elements, at least doubling the capacity
+static int _zyp_vec_reserve_more(struct zyp_vec *vec, size_t count)
+{
+    if (count > SIZE_MAX - vec->length) {
+        return 1;
+    }
+    size_t need = vec->length + count;
+    if (need <= vec->capacity) {
+        return 0;
+    }
+    size_t capacity = vec->capacity <= SIZE_MAX / 2 ? vec->capacity * 2 : need;
+    return zyp_vec_reserve(vec, capacity > need ? capacity : need);
+}
+
 struct zyp_vec *zyp_vec_new(size_t element_size)
 {
     return zyp_vec_with_capacity(element_size, DEFAULT_CAPACITY);
@@ -26,22 +43,30 @@ struct zyp_vec *zyp_vec_new(size_t element_size)
 
 struct zyp_vec *zyp_vec_with_capacity(size_t element_size, size_t capacity)
 {
-    if (element_size == 0) {
+    return zyp_vec_with_allocator(element_size, capacity, NULL);
+}
+
+struct zyp_vec *zyp_vec_with_allocator(size_t element_size, size_t capacity,
+                                       const struct zyp_allocator *allocator)
+{
+    if (element_size == 0 || capacity > SIZE_MAX / element_size) {
         return NULL;
     }
-    struct zyp_vec *vec = (struct zyp_vec *)malloc(sizeof(struct zyp_vec));
+    struct zyp_vec *vec =
+        (struct zyp_vec *)zyp_alloc(allocator, sizeof(struct zyp_vec));
     if (!vec) {
         return NULL;
     }
 
-    vec->buffer = malloc(element_size * capacity);
+    vec->buffer = zyp_alloc(allocator, element_size * capacity);
     if (!vec->buffer) {
-        free(vec);
+        zyp_free(allocator, vec, sizeof(struct zyp_vec));
         return NULL;
     }
     vec->capacity = capacity;
     vec->element_size = element_size;
     vec->length = 0;
+    vec->allocator = allocator;
 
     return vec;
 }
@@ -49,9 +74,10 @@ struct zyp_vec *zyp_vec_with_capacity(size_t element_size, size_t capacity)
 void zyp_vec_free(struct zyp_vec *vec)
 {
     if (vec) {
-        free(vec->buffer);
+        const struct zyp_allocator *allocator = vec->allocator;
+        zyp_free(allocator, vec->buffer, vec->element_size * vec->capacity);
+        zyp_free(allocator, vec, sizeof(struct zyp_vec));
     }
-    free(vec);
 }
 
 int zyp_vec_reserve(struct zyp_vec *vec, size_t capacity)
@@ -62,8 +88,13 @@ int zyp_vec_reserve(struct zyp_vec *vec, size_t capacity)
     if (vec->capacity >= capacity) {
         return 0;
     }
+    if (capacity > SIZE_MAX / vec->element_size) {
+        return 1;
+    }
 
-    void *newbuf = realloc(vec->buffer, vec->element_size * capacity);
+    void *newbuf = zyp_realloc(vec->allocator, vec->buffer,
+                               vec->element_size * vec->capacity,
+                               vec->element_size * capacity);
     if (!newbuf) {
         return 1;
     }
@@ -85,7 +116,9 @@ int zyp_vec_shrink(struct zyp_vec *vec, size_t capacity)
         capacity = vec->length;
     }
 
-    void *newbuf = realloc(vec->buffer, vec->element_size * capacity);
+    void *newbuf = zyp_realloc(vec->allocator, vec->buffer,
+                               vec->element_size * vec->capacity,
+                               vec->element_size * capacity);
     if (!newbuf) {
         return 1;
     }
@@ -125,10 +158,8 @@ void *zyp_vec_insert(struct zyp_vec *vec, size_t index, const void *data)
         return NULL;
     }
 
-    if (vec->capacity <= vec->length) {
-        if (zyp_vec_reserve(vec, vec->capacity * 2)) {
-            return NULL;
-        }
+    if (_zyp_vec_reserve_more(vec, 1)) {
+        return NULL;
     }
 
     void *ins_ptr = _zyp_vec_fast_get(vec, index);
@@ -196,3 +227,114 @@ void *zyp_vec_get_mut(struct zyp_vec *vec, size_t index)
     }
     return _zyp_vec_fast_get(vec, index);
 }
+
+void *zyp_vec_extend(struct zyp_vec *vec, const void *data, size_t count)
+{
+    if (!vec) {
+        return NULL;
+    }
+    return zyp_vec_splice(vec, vec->length, 0, NULL, data, count);
+}
+
+void *zyp_vec_insert_range(struct zyp_vec *vec, size_t index,
+                           const void *data, size_t count)
+{
+    return zyp_vec_splice(vec, index, 0, NULL, data, count);
+}
+
+int zyp_vec_remove_range(struct zyp_vec *vec, size_t index, size_t count,
+                         void *dest)
+{
+    return zyp_vec_splice(vec, index, count, dest, NULL, 0) ? 0 : 1;
+}
+
+void *zyp_vec_splice(struct zyp_vec *vec, size_t index, size_t remove_count,
+                     void *removed, const void *data, size_t count)
+{
+    if (!vec || index > vec->length || remove_count > vec->length - index
+        || (count && !data)) {
+        return NULL;
+    }
+    if (count > remove_count
+        && _zyp_vec_reserve_more(vec, count - remove_count)) {
+        return NULL;
+    }
+
+    void *at = _zyp_vec_fast_get(vec, index);
+    size_t tail = vec->length - index - remove_count;
+    if (removed && remove_count) {
+        memcpy(removed, at, vec->element_size * remove_count);
+    }
+    // Move the elements after the range once, to their final place
+    if (tail && count != remove_count) {
+        memmove(_zyp_vec_fast_get(vec, index + count),
+                _zyp_vec_fast_get(vec, index + remove_count),
+                vec->element_size * tail);
+    }
+    if (count) {
+        memcpy(at, data, vec->element_size * count);
+    }
+    vec->length = vec->length - remove_count + count;
+
+    return at;
+}
+
+int zyp_vec_resize(struct zyp_vec *vec, size_t length, const void *fill)
+{
+    if (!vec) {
+        return 1;
+    }
+    if (length > vec->length) {
+        if (_zyp_vec_reserve_more(vec, length - vec->length)) {
+            return 1;
+        }
+        if (fill) {
+            for (size_t i = vec->length; i < length; i++) {
+                memcpy(_zyp_vec_fast_get(vec, i), fill, vec->element_size);
+            }
+        } else {
+            memset(_zyp_vec_fast_get(vec, vec->length), 0,
+                   vec->element_size * (length - vec->length));
+        }
+    }
+    vec->length = length;
+    return 0;
+}
+
+void zyp_vec_sort(struct zyp_vec *vec,
+                  int (*compar)(const void *, const void *))
+{
+    if (!vec || vec->length < 2) {
+        return;
+    }
+    qsort(vec->buffer, vec->length, vec->element_size, compar);
+}
+
+size_t zyp_vec_lower_bound(const struct zyp_vec *vec, const void *key,
+                           int (*compar)(const void *, const void *))
+{
+    if (!vec) {
+        return 0;
+    }
+    size_t low = 0, high = vec->length;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compar(key, _zyp_vec_fast_get((struct zyp_vec *)vec, mid)) > 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+const void *zyp_vec_bsearch(const struct zyp_vec *vec, const void *key,
+                            int (*compar)(const void *, const void *))
+{
+    size_t index = zyp_vec_lower_bound(vec, key, compar);
+    if (!vec || index >= vec->length) {
+        return NULL;
+    }
+    const void *element = _zyp_vec_fast_get((struct zyp_vec *)vec, index);
+    return compar(key, element) == 0 ? element : NULL;
+}
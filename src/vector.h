@@ -1,6 +1,8 @@
 #ifndef _ZYP_VECTOR_H
 #define _ZYP_VECTOR_H
 
+#include <zyphtine/alloc.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -46,6 +48,21 @@ struct zyp_vec *zyp_vec_new(size_t element_size);
  */
 struct zyp_vec *zyp_vec_with_capacity(size_t element_size, size_t capacity);
 
+/**
+ * @brief Create a new vector drawing its memory from an allocator
+ * Both the struct and the buffer are allocated from the allocator, which
+ * should outlive the vector.
+ * @see zyp_vec_with_capacity()
+ *
+ * @param element_size size in bytes for each element, must greater than 0
+ * @param capacity initial capacity in element counts
+ * @param allocator allocator of the vector, or NULL for malloc()
+ * @retval NULL fail to allocate memory
+ * @return newly created vector
+ */
+struct zyp_vec *zyp_vec_with_allocator(size_t element_size, size_t capacity,
+                                       const struct zyp_allocator *allocator);
+
 /**
  * @brief Free the vector
  * Free all the memory used by the buffer and the struct itself.
@@ -192,4 +209,119 @@ const void *zyp_vec_get(const struct zyp_vec *vec, size_t index);
  */
 void *zyp_vec_get_mut(struct zyp_vec *vec, size_t index);
 
+/**
+ * @brief Append elements at the end of the vector
+ * Copy `count` elements from data to the end of the vector, reallocating at
+ * most once.
+ *
+ * @see zyp_vec_insert_range()
+ * @param vec vector object
+ * @param data items to be appended, must not point into the vector
+ * @param count number of items
+ * @retval NULL fail to allocate memory
+ * @return Pointer to the first appended item
+ */
+void *zyp_vec_extend(struct zyp_vec *vec, const void *data, size_t count);
+
+/**
+ * @brief Insert elements into the vector
+ * Copy `count` elements from data to the requested position. The elements
+ * after it are moved once, and the vector is reallocated at most once.
+ *
+ * @see zyp_vec_insert()
+ * @param vec vector object
+ * @param index index number to place the first item
+ * @param data items to be inserted, must not point into the vector
+ * @param count number of items
+ * @retval NULL fail to allocate memory, or the index is not valid
+ * @return Pointer to the first inserted item
+ */
+void *zyp_vec_insert_range(struct zyp_vec *vec, size_t index,
+                           const void *data, size_t count);
+
+/**
+ * @brief Remove elements from the vector
+ * Delete `count` elements from the index, moving the elements after them
+ * once. If dest is not NULL, the elements are copied to it before deleted.
+ *
+ * @see zyp_vec_remove()
+ * @param vec vector object
+ * @param index index number of the first element to be removed
+ * @param count number of elements
+ * @param dest destination to place the being removed elements
+ * @return 0 if successful, 1 if the range is not valid
+ */
+int zyp_vec_remove_range(struct zyp_vec *vec, size_t index, size_t count,
+                         void *dest);
+
+/**
+ * @brief Replace elements of the vector
+ * Remove `remove_count` elements from the index, and insert `count`
+ * elements from data in their place. The elements after the range are
+ * moved once, and the vector is reallocated at most once.
+ * If removed is not NULL, the removed elements are copied to it.
+ *
+ * @param vec vector object
+ * @param index index number of the first element to be replaced
+ * @param remove_count number of elements to be removed
+ * @param removed destination to place the being removed elements
+ * @param data items to be inserted, must not point into the vector
+ * @param count number of items to be inserted
+ * @retval NULL fail to allocate memory, or the range is not valid
+ * @return Pointer to the first inserted item
+ */
+void *zyp_vec_splice(struct zyp_vec *vec, size_t index, size_t remove_count,
+                     void *removed, const void *data, size_t count);
+
+/**
+ * @brief Change the element count of the vector
+ * Drop the elements past `length`, or append elements up to `length`, each
+ * a copy of fill, or zeroed if fill is NULL.
+ *
+ * @param vec vector object
+ * @param length new element count
+ * @param fill item the new elements are copied from, can be NULL
+ * @return 0 if successful, 1 if fail to allocate memory
+ */
+int zyp_vec_resize(struct zyp_vec *vec, size_t length, const void *fill);
+
+/**
+ * @brief Sort the elements of the vector
+ *
+ * @param vec vector object
+ * @param compar comparison function, as in qsort()
+ */
+void zyp_vec_sort(struct zyp_vec *vec,
+                  int (*compar)(const void *, const void *));
+
+/**
+ * @brief Find an element in a sorted vector
+ * The vector must be sorted so that compar gives the same order.
+ *
+ * @see zyp_vec_lower_bound()
+ * @param vec vector object
+ * @param key item to look for, passed as the first argument of compar
+ * @param compar comparison function, as in bsearch()
+ * @retval NULL the item is not found
+ * @return Pointer to a matching element
+ */
+const void *zyp_vec_bsearch(const struct zyp_vec *vec, const void *key,
+                            int (*compar)(const void *, const void *));
+
+/**
+ * @brief Find where a key would be inserted in a sorted vector
+ * The vector must be sorted so that compar gives the same order.
+ * Inserting the key at the returned index keeps the vector sorted, and
+ * puts it before the elements equal to it.
+ *
+ * @see zyp_vec_bsearch()
+ * @param vec vector object
+ * @param key item to look for, passed as the first argument of compar
+ * @param compar comparison function, as in bsearch()
+ * @return Index of the first element not less than the key, or the length
+ * if there is none
+ */
+size_t zyp_vec_lower_bound(const struct zyp_vec *vec, const void *key,
+                           int (*compar)(const void *, const void *));
+
 #endif
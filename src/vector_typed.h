@@ -0,0 +1,342 @@
+#ifndef _ZYP_VECTOR_TYPED_H
+#define _ZYP_VECTOR_TYPED_H
+
+#include "alloc.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @file
+ * This header defines a template of dynamic arrays specialized for an
+ * element type
+ *
+ * Unlike struct zyp_vec, the element size is known at compile time and the
+ * operations are inline functions taking and returning elements by value,
+ * so pushing and getting compile to plain stores and loads. The vector
+ * struct is not opaque, it can be embedded in other structs, and `data` can
+ * be read directly.
+ *
+ * ZYP_VEC_DEFINE(name, T) defines `struct name` and these functions:
+ * - `void name_init(struct name *vec,
+ *                   const struct zyp_allocator *allocator)`
+ * - `void name_release(struct name *vec)`
+ * - `int name_reserve(struct name *vec, size_t capacity)`
+ * - `size_t name_length(const struct name *vec)`
+ * - `bool name_is_empty(const struct name *vec)`
+ * - `void name_clear(struct name *vec)`
+ * - `int name_push(struct name *vec, T value)`
+ * - `T name_pop(struct name *vec)`
+ * - `int name_insert(struct name *vec, size_t index, T value)`
+ * - `T name_remove(struct name *vec, size_t index)`
+ * - `T name_get(const struct name *vec, size_t index)`
+ * - `T *name_at(struct name *vec, size_t index)`
+ *
+ * The functions returning int return 0 if successful, 1 if fail to
+ * allocate memory or the index is not valid. The functions returning an
+ * element do not check the index, like an array access. The memory is drawn
+ * from the allocator given to name_init(), or malloc() if it is NULL, and
+ * name_release() keeps the allocator for the next use.
+ *
+ * ZYP_SMALL_VEC_DEFINE(name, T, N) defines a vector which keeps up to `N`
+ * elements inside the struct, and allocates only when it grows past `N`.
+ * It has the same functions, and `T *name_data(struct name *vec)` in place
+ * of the `data` member.
+ */
+
+/**
+ * @brief Define a vector type of elements `T` and its functions
+ *
+ * @param name name of the struct, and prefix of the functions
+ * @param T element type
+ */
+#define ZYP_VEC_DEFINE(name, T) \
+    struct name { \
+        T *data; \
+        size_t length; \
+        size_t capacity; \
+        /** Allocator of `data`, NULL for malloc() */ \
+        const struct zyp_allocator *allocator; \
+    }; \
+    \
+    static inline void name##_init(struct name *vec, \
+                                   const struct zyp_allocator *allocator) \
+    { \
+        vec->data = NULL; \
+        vec->length = 0; \
+        vec->capacity = 0; \
+        vec->allocator = allocator; \
+    } \
+    \
+    static inline void name##_release(struct name *vec) \
+    { \
+        zyp_free(vec->allocator, vec->data, vec->capacity * sizeof(T)); \
+        name##_init(vec, vec->allocator); \
+    } \
+    \
+    static inline int name##_reserve(struct name *vec, size_t capacity) \
+    { \
+        if (capacity <= vec->capacity) { \
+            return 0; \
+        } \
+        if (capacity > SIZE_MAX / sizeof(T)) { \
+            return 1; \
+        } \
+        T *data = (T *)zyp_realloc(vec->allocator, vec->data, \
+                                   vec->capacity * sizeof(T), \
+                                   capacity * sizeof(T)); \
+        if (!data) { \
+            return 1; \
+        } \
+        vec->data = data; \
+        vec->capacity = capacity; \
+        return 0; \
+    } \
+    \
+    /* Make room for one more element, by doubling the capacity */ \
+    static inline int name##_grow(struct name *vec) \
+    { \
+        if (vec->length < vec->capacity) { \
+            return 0; \
+        } \
+        return name##_reserve(vec, vec->capacity ? vec->capacity * 2 \
+                                                 : ZYP_VEC_INITIAL_CAPACITY); \
+    } \
+    \
+    static inline size_t name##_length(const struct name *vec) \
+    { \
+        return vec->length; \
+    } \
+    \
+    static inline bool name##_is_empty(const struct name *vec) \
+    { \
+        return vec->length == 0; \
+    } \
+    \
+    static inline void name##_clear(struct name *vec) \
+    { \
+        vec->length = 0; \
+    } \
+    \
+    static inline int name##_push(struct name *vec, T value) \
+    { \
+        if (name##_grow(vec)) { \
+            return 1; \
+        } \
+        vec->data[vec->length++] = value; \
+        return 0; \
+    } \
+    \
+    static inline T name##_pop(struct name *vec) \
+    { \
+        return vec->data[--vec->length]; \
+    } \
+    \
+    static inline int name##_insert(struct name *vec, size_t index, \
+                                    T value) \
+    { \
+        if (index > vec->length || name##_grow(vec)) { \
+            return 1; \
+        } \
+        memmove(vec->data + index + 1, vec->data + index, \
+                (vec->length - index) * sizeof(T)); \
+        vec->data[index] = value; \
+        vec->length++; \
+        return 0; \
+    } \
+    \
+    static inline T name##_remove(struct name *vec, size_t index) \
+    { \
+        T value = vec->data[index]; \
+        memmove(vec->data + index, vec->data + index + 1, \
+                (vec->length - index - 1) * sizeof(T)); \
+        vec->length--; \
+        return value; \
+    } \
+    \
+    static inline T name##_get(const struct name *vec, size_t index) \
+    { \
+        return vec->data[index]; \
+    } \
+    \
+    static inline T *name##_at(struct name *vec, size_t index) \
+    { \
+        return vec->data + index; \
+    }
+
+/**
+ * @brief Define a vector type of elements `T` with inline storage for `N`
+ * elements, and its functions
+ *
+ * The elements are in the struct until the vector grows past `N`, then
+ * they move to the heap and stay there until the vector is released. While
+ * the elements are inline, neither init nor push allocates, so a vector on
+ * the stack or in another struct costs no allocation in the common case.
+ * The elements are addressed through name_data() rather than a pointer to
+ * the struct itself, so the struct can be moved with a plain assignment.
+ *
+ * @param name name of the struct, and prefix of the functions
+ * @param T element type
+ * @param N number of inline elements, at least 1
+ */
+#define ZYP_SMALL_VEC_DEFINE(name, T, N) \
+    struct name { \
+        size_t length; \
+        /** `N` while the elements are inline, more once on the heap */ \
+        size_t capacity; \
+        /** Allocator of `u.heap`, NULL for malloc() */ \
+        const struct zyp_allocator *allocator; \
+        union { \
+            T inline_data[N]; \
+            T *heap; \
+        } u; \
+    }; \
+    \
+    static inline void name##_init(struct name *vec, \
+                                   const struct zyp_allocator *allocator) \
+    { \
+        vec->length = 0; \
+        vec->capacity = (N); \
+        vec->allocator = allocator; \
+    } \
+    \
+    static inline bool name##_is_inline(const struct name *vec) \
+    { \
+        return vec->capacity <= (N); \
+    } \
+    \
+    static inline void name##_release(struct name *vec) \
+    { \
+        if (!name##_is_inline(vec)) { \
+            zyp_free(vec->allocator, vec->u.heap, \
+                     vec->capacity * sizeof(T)); \
+        } \
+        name##_init(vec, vec->allocator); \
+    } \
+    \
+    static inline T *name##_data(struct name *vec) \
+    { \
+        return name##_is_inline(vec) ? vec->u.inline_data : vec->u.heap; \
+    } \
+    \
+    static inline int name##_reserve(struct name *vec, size_t capacity) \
+    { \
+        if (capacity <= vec->capacity) { \
+            return 0; \
+        } \
+        if (capacity > SIZE_MAX / sizeof(T)) { \
+            return 1; \
+        } \
+        if (name##_is_inline(vec)) { \
+            T *heap = (T *)zyp_alloc(vec->allocator, capacity * sizeof(T)); \
+            if (!heap) { \
+                return 1; \
+            } \
+            memcpy(heap, vec->u.inline_data, vec->length * sizeof(T)); \
+            vec->u.heap = heap; \
+        } else { \
+            T *heap = (T *)zyp_realloc(vec->allocator, vec->u.heap, \
+                                       vec->capacity * sizeof(T), \
+                                       capacity * sizeof(T)); \
+            if (!heap) { \
+                return 1; \
+            } \
+            vec->u.heap = heap; \
+        } \
+        vec->capacity = capacity; \
+        return 0; \
+    } \
+    \
+    /* Make room for one more element, by doubling the capacity */ \
+    static inline int name##_grow(struct name *vec) \
+    { \
+        if (vec->length < vec->capacity) { \
+            return 0; \
+        } \
+        return name##_reserve(vec, vec->capacity * 2); \
+    } \
+    \
+    static inline size_t name##_length(const struct name *vec) \
+    { \
+        return vec->length; \
+    } \
+    \
+    static inline bool name##_is_empty(const struct name *vec) \
+    { \
+        return vec->length == 0; \
+    } \
+    \
+    static inline void name##_clear(struct name *vec) \
+    { \
+        vec->length = 0; \
+    } \
+    \
+    static inline int name##_push(struct name *vec, T value) \
+    { \
+        if (name##_grow(vec)) { \
+            return 1; \
+        } \
+        name##_data(vec)[vec->length++] = value; \
+        return 0; \
+    } \
+    \
+    static inline T name##_pop(struct name *vec) \
+    { \
+        return name##_data(vec)[--vec->length]; \
+    } \
+    \
+    static inline int name##_insert(struct name *vec, size_t index, \
+                                    T value) \
+    { \
+        if (index > vec->length || name##_grow(vec)) { \
+            return 1; \
+        } \
+        T *data = name##_data(vec); \
+        memmove(data + index + 1, data + index, \
+                (vec->length - index) * sizeof(T)); \
+        data[index] = value; \
+        vec->length++; \
+        return 0; \
+    } \
+    \
+    static inline T name##_remove(struct name *vec, size_t index) \
+    { \
+        T *data = name##_data(vec); \
+        T value = data[index]; \
+        memmove(data + index, data + index + 1, \
+                (vec->length - index - 1) * sizeof(T)); \
+        vec->length--; \
+        return value; \
+    } \
+    \
+    static inline T name##_get(const struct name *vec, size_t index) \
+    { \
+        const T *data = name##_is_inline(vec) ? vec->u.inline_data \
+                                              : vec->u.heap; \
+        return data[index]; \
+    } \
+    \
+    static inline T *name##_at(struct name *vec, size_t index) \
+    { \
+        return name##_data(vec) + index; \
+    }
+
+/** Capacity of a typed vector at its first growth */
+#define ZYP_VEC_INITIAL_CAPACITY 16
+
+/** @brief A vector of syllables */
+ZYP_VEC_DEFINE(zyp_vec_u16, uint16_t)
+/** @brief A vector of Unicode code points */
+ZYP_VEC_DEFINE(zyp_vec_u32, uint32_t)
+
+/** Syllables kept inline, enough for most phrases */
+#define ZYP_SMALL_VEC_INLINE 16
+
+/** @brief A vector of the syllables of a phrase */
+ZYP_SMALL_VEC_DEFINE(zyp_small_vec_u16, uint16_t, ZYP_SMALL_VEC_INLINE)
+/** @brief A vector of the charactors of a phrase */
+ZYP_SMALL_VEC_DEFINE(zyp_small_vec_u32, uint32_t, ZYP_SMALL_VEC_INLINE)
+
+#endif
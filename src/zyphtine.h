@@ -2,31 +2,35 @@
 #define _ZYP_ZYPHTINE_H
 
 #include <stdint.h>
-
-/**
- * Charactor data in preedit buffer
- */
-struct preedit_char {
-    /** @brief Zhuyin syllable of the charactor
-        If this field is zero, it means that the selected charactor
-        is not a Chinese charactor. */
-    uint16_t zhuyin_syll;
-    /** @brief The currently selected charactor */
-    uint32_t selected_char;
-    /** @brief The charactor is selected by user
-        @todo The content is still undefined in current development process */
-    uint8_t user_selected;
-    /** @brief Flag of segmentor
-        @todo The content is still undefined in current development process */
-    uint8_t seg_point;
-};
+#include <zyphtine/alloc.h>
+#include <zyphtine/context.h>
+#include <zyphtine/keyboard.h>
+#include "arena.h"
+#include "convert.h"
+#include "preedit.h"
 
 /**
  * @brief The main context object in this library
  * @todo The context is not completed
  */
 struct zyphtine_ctx {
-
+    /** @brief Composition state of the syllable being typed */
+    struct zyp_composer composer;
+    /** @brief The preedit buffer */
+    struct zyp_preedit preedit;
+    /** @brief Working memory of the conversion */
+    struct zyp_converter converter;
+    /** @brief Short-lived memory of a conversion, reset before the next */
+    struct zyp_arena arena;
+    /** @brief Position of the first charactor changed since the conversion */
+    size_t dirty;
+    /** @brief The shared dictionary followed by the context, or NULL */
+    struct zyp_dict_shared *shared;
+    /** @brief Reference to the dictionary of `shared` in use */
+    struct zyp_dict *shared_dict;
+    uint64_t shared_version;
+    /** @brief Allocator of the context and its buffers, or NULL */
+    const struct zyp_allocator *allocator;
 };
 
 #endif
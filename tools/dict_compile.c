@@ -0,0 +1,652 @@
+/**
+ * @file
+ * Compile libchewing style `tsi.src` phrase lists to binary dictionaries.
+ *
+ * Each line of the source is a phrase, its frequency and its syllables,
+ * separated by whitespaces, lines starting with `#` are comments:
+ *
+ *     一丁不識 2 ㄧ ㄉㄧㄥ ㄅㄨˋ ㄕˋ
+ *
+ * The source is read in chunks. Each chunk is split at line boundaries, and
+ * the slices are parsed and sorted by worker threads, then merged into a
+ * sorted run in a temporary file. After the whole source is read, the runs
+ * are merged into the dictionary builder, so only a chunk of the source is
+ * in memory at a time.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <zyphtine/dict.h>
+#include <zyphtine/syllable.h>
+#include "dict_builder.h"
+#include "utf8.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGRAM_NAME "zyphtine-dict-compile"
+#define DEFAULT_CHUNK_MIB 64
+#define MAX_THREADS 64
+#define MAX_PHRASE_LENGTH UINT16_MAX
+
+// A parsed line, pointing into the chunk and the syllable pool of a worker
+struct record {
+    const char *text;
+    const uint16_t *sylls;
+    size_t syll_offset;
+    uint32_t textlen;
+    uint32_t frequency;
+    uint16_t len;
+};
+
+// Record header in the run files, followed by the syllables and the text
+struct run_record {
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t textlen;
+    uint32_t frequency;
+};
+
+struct worker {
+    pthread_t thread;
+    char *begin;
+    char *end;
+    struct record *records;
+    size_t count;
+    size_t capacity;
+    uint16_t *pool;
+    size_t pool_length;
+    size_t pool_capacity;
+    uint64_t lines;
+    uint64_t skipped;
+    bool nomem;
+};
+
+// The head of a sorted run during the final merge
+struct run {
+    FILE *fp;
+    struct run_record rec;
+    uint16_t *sylls;
+    char *text;
+    size_t text_capacity;
+};
+
+struct stats {
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t phrases;
+    uint64_t skipped;
+    uint64_t keys;
+    size_t runs;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int syllables_compare(const uint16_t *a, size_t alen,
+                             const uint16_t *b, size_t blen)
+{
+    size_t len = alen < blen ? alen : blen;
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+// Order by the text too, so the output does not depend on the chunking
+static int entry_compare(const uint16_t *asylls, size_t alen,
+                         const char *atext, size_t atextlen,
+                         const uint16_t *bsylls, size_t blen,
+                         const char *btext, size_t btextlen)
+{
+    int cmp = syllables_compare(asylls, alen, bsylls, blen);
+    if (cmp) {
+        return cmp;
+    }
+    size_t len = atextlen < btextlen ? atextlen : btextlen;
+    cmp = memcmp(atext, btext, len);
+    if (cmp) {
+        return cmp;
+    }
+    return (atextlen > btextlen) - (atextlen < btextlen);
+}
+
+static int record_compare(const void *a, const void *b)
+{
+    const struct record *ra = (const struct record *)a;
+    const struct record *rb = (const struct record *)b;
+    return entry_compare(ra->sylls, ra->len, ra->text, ra->textlen,
+                         rb->sylls, rb->len, rb->text, rb->textlen);
+}
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static char *skip_blank(char *p, char *end)
+{
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static char *skip_field(char *p, char *end)
+{
+    while (p < end && !is_blank(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static int worker_reserve(struct worker *w, size_t sylls)
+{
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+        struct record *records = (struct record *)realloc(
+            w->records, capacity * sizeof(struct record));
+        if (!records) {
+            return 1;
+        }
+        w->records = records;
+        w->capacity = capacity;
+    }
+    if (w->pool_length + sylls > w->pool_capacity) {
+        size_t capacity = w->pool_capacity ? w->pool_capacity * 2 : 16384;
+        while (capacity < w->pool_length + sylls) {
+            capacity *= 2;
+        }
+        uint16_t *pool = (uint16_t *)realloc(w->pool,
+                                             capacity * sizeof(uint16_t));
+        if (!pool) {
+            return 1;
+        }
+        w->pool = pool;
+        w->pool_capacity = capacity;
+    }
+    return 0;
+}
+
+// Parse a line without the line feed, return 0 if it is skipped
+static int parse_line(struct worker *w, char *line, char *end)
+{
+    char *p = skip_blank(line, end);
+    if (p == end || *p == '#') {
+        return 0;
+    }
+
+    char *text = p;
+    p = skip_field(p, end);
+    if (p == end) {
+        return -1;
+    }
+    *p = '\0';
+    size_t textlen = (size_t)(p - text);
+    if (!utf8_check(text) || textlen > UINT32_MAX) {
+        return -1;
+    }
+
+    p = skip_blank(p + 1, end);
+    uint64_t frequency = 0;
+    char *digits = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        frequency = frequency * 10 + (uint64_t)(*p - '0');
+        if (frequency > UINT32_MAX) {
+            frequency = UINT32_MAX;
+        }
+    }
+    if (p == digits || (p < end && !is_blank(*p))) {
+        return -1;
+    }
+
+    p = skip_blank(p, end);
+    while (end > p && is_blank(end[-1])) {
+        end--;
+    }
+    size_t len = (size_t)(end - p);
+    // Every syllable takes at least 2 bytes
+    if (worker_reserve(w, len / 2 + 1)) {
+        w->nomem = true;
+        return -1;
+    }
+    uint16_t *sylls = w->pool + w->pool_length;
+    size_t stop;
+    size_t count = zyp_syllable_parse_n(sylls, len / 2 + 1, p, len, &stop);
+    if (stop != len || !count || count > MAX_PHRASE_LENGTH
+            || count != utf8_strlen(text)) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        // The first tone is not marked in the source
+        if (!ZYP_SYLLABLE_TONE(sylls[i])) {
+            sylls[i] |= ZYP_TONE_1;
+        }
+        if (!zyp_syllable_is_legal(sylls[i])) {
+            return -1;
+        }
+    }
+
+    w->records[w->count++] = (struct record){
+        .text = text,
+        .syll_offset = w->pool_length,
+        .textlen = (uint32_t)textlen,
+        .frequency = (uint32_t)frequency,
+        .len = (uint16_t)count,
+    };
+    w->pool_length += count;
+    return 1;
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    w->count = 0;
+    w->pool_length = 0;
+    w->lines = 0;
+    w->skipped = 0;
+
+    char *line = w->begin;
+    while (line < w->end && !w->nomem) {
+        char *eol = memchr(line, '\n', (size_t)(w->end - line));
+        if (!eol) {
+            eol = w->end;
+        }
+        w->lines++;
+        if (parse_line(w, line, eol) < 0) {
+            w->skipped++;
+        }
+        line = eol + 1;
+    }
+
+    // The pool does not move anymore
+    for (size_t i = 0; i < w->count; i++) {
+        w->records[i].sylls = w->pool + w->records[i].syll_offset;
+    }
+    qsort(w->records, w->count, sizeof(struct record), record_compare);
+    return NULL;
+}
+
+static int write_record(FILE *fp, const struct record *rec)
+{
+    struct run_record hdr = {
+        .len = rec->len,
+        .textlen = rec->textlen,
+        .frequency = rec->frequency,
+    };
+    return fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+           || fwrite(rec->sylls, sizeof(uint16_t), rec->len, fp) != rec->len
+           || fwrite(rec->text, 1, rec->textlen, fp) != rec->textlen;
+}
+
+// Merge the sorted slices of the workers into a run file
+static FILE *write_run(struct worker *workers, size_t nworkers)
+{
+    FILE *fp = tmpfile();
+    if (!fp) {
+        return NULL;
+    }
+    size_t pos[MAX_THREADS] = { 0 };
+    for (;;) {
+        const struct record *min = NULL;
+        size_t minw = 0;
+        for (size_t i = 0; i < nworkers; i++) {
+            if (pos[i] == workers[i].count) {
+                continue;
+            }
+            const struct record *rec = &workers[i].records[pos[i]];
+            if (!min || record_compare(rec, min) < 0) {
+                min = rec;
+                minw = i;
+            }
+        }
+        if (!min) {
+            break;
+        }
+        if (write_record(fp, min)) {
+            fclose(fp);
+            return NULL;
+        }
+        pos[minw]++;
+    }
+    if (fflush(fp) || fseek(fp, 0, SEEK_SET)) {
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+// Split the chunk at line boundaries, and parse the slices in parallel
+static FILE *process_chunk(char *chunk, size_t size, struct worker *workers,
+                           size_t nworkers, struct stats *stats)
+{
+    char *begin = chunk, *end = chunk + size;
+    for (size_t i = 0; i < nworkers; i++) {
+        char *slice_end = end;
+        if (i + 1 < nworkers) {
+            slice_end = begin + (size_t)(end - begin) / (nworkers - i);
+            char *eol = memchr(slice_end, '\n', (size_t)(end - slice_end));
+            slice_end = eol ? eol + 1 : end;
+        }
+        workers[i].begin = begin;
+        workers[i].end = slice_end;
+        begin = slice_end;
+    }
+
+    size_t started = 0;
+    for (; started < nworkers; started++) {
+        if (pthread_create(&workers[started].thread, NULL, worker_run,
+                           &workers[started])) {
+            break;
+        }
+    }
+    // Fall back to run the rest here if a thread can not be created
+    for (size_t i = started; i < nworkers; i++) {
+        worker_run(&workers[i]);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < nworkers; i++) {
+        if (workers[i].nomem) {
+            return NULL;
+        }
+        stats->lines += workers[i].lines;
+        stats->skipped += workers[i].skipped;
+        stats->phrases += workers[i].count;
+    }
+    return write_run(workers, nworkers);
+}
+
+static int run_next(struct run *run)
+{
+    if (fread(&run->rec, sizeof(run->rec), 1, run->fp) != 1) {
+        return 1;
+    }
+    if (run->rec.textlen > run->text_capacity) {
+        char *text = (char *)realloc(run->text, run->rec.textlen);
+        if (!text) {
+            return 1;
+        }
+        run->text = text;
+        run->text_capacity = run->rec.textlen;
+    }
+    return fread(run->sylls, sizeof(uint16_t), run->rec.len, run->fp)
+               != run->rec.len
+           || fread(run->text, 1, run->rec.textlen, run->fp)
+               != run->rec.textlen;
+}
+
+static inline bool run_less(const struct run *a, const struct run *b)
+{
+    return entry_compare(a->sylls, a->rec.len, a->text, a->rec.textlen,
+                         b->sylls, b->rec.len, b->text, b->rec.textlen) < 0;
+}
+
+static void heap_sift_down(struct run **heap, size_t n, size_t i)
+{
+    for (;;) {
+        size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < n && run_less(heap[l], heap[min])) {
+            min = l;
+        }
+        if (r < n && run_less(heap[r], heap[min])) {
+            min = r;
+        }
+        if (min == i) {
+            return;
+        }
+        struct run *tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+// K-way merge of the runs into the builder
+static int merge_runs(FILE **files, size_t nruns, struct zyp_dict_builder *b,
+                      struct stats *stats)
+{
+    int err = 1;
+    struct run *runs = (struct run *)calloc(nruns, sizeof(struct run));
+    struct run **heap = (struct run **)calloc(nruns, sizeof(struct run *));
+    uint16_t *last = (uint16_t *)malloc(MAX_PHRASE_LENGTH * sizeof(uint16_t));
+    size_t lastlen = 0, n = 0;
+    if (!runs || !heap || !last) {
+        goto out;
+    }
+
+    for (size_t i = 0; i < nruns; i++) {
+        runs[i].fp = files[i];
+        runs[i].sylls = (uint16_t *)malloc(MAX_PHRASE_LENGTH
+                                           * sizeof(uint16_t));
+        if (!runs[i].sylls) {
+            goto out;
+        }
+        if (!run_next(&runs[i])) {
+            heap[n++] = &runs[i];
+        }
+    }
+    for (size_t i = n / 2; i-- > 0;) {
+        heap_sift_down(heap, n, i);
+    }
+
+    while (n) {
+        struct run *run = heap[0];
+        if (syllables_compare(run->sylls, run->rec.len, last, lastlen)) {
+            memcpy(last, run->sylls, run->rec.len * sizeof(uint16_t));
+            lastlen = run->rec.len;
+            stats->keys++;
+        }
+        if (zyp_dict_builder_add(b, run->sylls, run->rec.len, run->text,
+                                 run->rec.textlen, run->rec.frequency)) {
+            goto out;
+        }
+        if (run_next(run)) {
+            heap[0] = heap[--n];
+        }
+        heap_sift_down(heap, n, 0);
+    }
+    err = 0;
+
+out:
+    if (runs) {
+        for (size_t i = 0; i < nruns; i++) {
+            free(runs[i].sylls);
+            free(runs[i].text);
+        }
+    }
+    free(runs);
+    free(heap);
+    free(last);
+    return err;
+}
+
+static void usage(FILE *fp)
+{
+    fprintf(fp,
+            "Usage: " PROGRAM_NAME " [-j THREADS] [-m CHUNK_MIB] SOURCE OUTPUT\n"
+            "Compile a tsi.src phrase list to a binary dictionary.\n"
+            "Use - as SOURCE to read from the standard input.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t chunk_size = (size_t)DEFAULT_CHUNK_MIB << 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "hj:m:")) != -1) {
+        switch (opt) {
+        case 'j':
+            nthreads = strtol(optarg, NULL, 10);
+            break;
+        case 'm':
+            chunk_size = (size_t)strtoul(optarg, NULL, 10) << 20;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (argc - optind != 2 || !chunk_size) {
+        usage(stderr);
+        return 1;
+    }
+    nthreads = nthreads < 1 ? 1 : nthreads > MAX_THREADS ? MAX_THREADS
+                                                          : nthreads;
+    const char *source = argv[optind], *output = argv[optind + 1];
+
+    FILE *in = strcmp(source, "-") ? fopen(source, "rb") : stdin;
+    if (!in) {
+        fprintf(stderr, PROGRAM_NAME ": %s: %s\n", source, strerror(errno));
+        return 1;
+    }
+
+    int err = 1;
+    struct stats stats = { 0 };
+    struct worker *workers = (struct worker *)calloc((size_t)nthreads,
+                                                     sizeof(struct worker));
+    char *chunk = (char *)malloc(chunk_size);
+    FILE **runs = NULL;
+    size_t run_capacity = 0;
+    struct zyp_dict_builder *b = NULL;
+    if (!workers || !chunk) {
+        fprintf(stderr, PROGRAM_NAME ": out of memory\n");
+        goto out;
+    }
+
+    double start = now_sec();
+    size_t filled = 0;
+    bool eof = false;
+    while (!eof) {
+        size_t n = fread(chunk + filled, 1, chunk_size - filled, in);
+        if (n < chunk_size - filled) {
+            if (ferror(in)) {
+                fprintf(stderr, PROGRAM_NAME ": %s: read error\n", source);
+                goto out;
+            }
+            eof = true;
+        }
+        filled += n;
+        stats.bytes += n;
+
+        // Keep the incomplete last line for the next chunk
+        size_t used = filled;
+        if (!eof) {
+            char *p = chunk + filled;
+            while (p > chunk && p[-1] != '\n') {
+                p--;
+            }
+            if (p == chunk) {
+                // A line longer than the chunk, grow the chunk
+                char *grown = (char *)realloc(chunk, chunk_size * 2);
+                if (!grown) {
+                    fprintf(stderr, PROGRAM_NAME ": out of memory\n");
+                    goto out;
+                }
+                chunk = grown;
+                chunk_size *= 2;
+                continue;
+            }
+            used = (size_t)(p - chunk);
+        }
+        if (!used) {
+            continue;
+        }
+
+        if (stats.runs == run_capacity) {
+            run_capacity = run_capacity ? run_capacity * 2 : 16;
+            FILE **grown = (FILE **)realloc(runs,
+                                            run_capacity * sizeof(FILE *));
+            if (!grown) {
+                fprintf(stderr, PROGRAM_NAME ": out of memory\n");
+                goto out;
+            }
+            runs = grown;
+        }
+        FILE *run = process_chunk(chunk, used, workers, (size_t)nthreads,
+                                  &stats);
+        if (!run) {
+            fprintf(stderr, PROGRAM_NAME ": fail to write a sorted run\n");
+            goto out;
+        }
+        runs[stats.runs++] = run;
+
+        memmove(chunk, chunk + used, filled - used);
+        filled -= used;
+    }
+    double parsed = now_sec();
+
+    b = zyp_dict_builder_new();
+    if (!b || merge_runs(runs, stats.runs, b, &stats)
+            || zyp_dict_builder_write(b, output)) {
+        fprintf(stderr, PROGRAM_NAME ": fail to write %s\n", output);
+        goto out;
+    }
+    double written = now_sec();
+
+    struct zyp_dict *dict = zyp_dict_open(output);
+    struct stat st;
+    if (!dict || stat(output, &st)) {
+        fprintf(stderr, PROGRAM_NAME ": %s is not valid\n", output);
+        zyp_dict_close(dict);
+        goto out;
+    }
+
+    double total = written - start;
+    fprintf(stderr,
+            "source:      %llu bytes, %llu lines, %llu skipped\n"
+            "parse+sort:  %.3f s, %.1f MiB/s, %zu threads, %zu runs\n"
+            "merge+write: %.3f s, %.0f phrases/s\n"
+            "output:      %llu keys, %zu phrases, %lld bytes\n"
+            "total:       %.3f s, %.1f MiB/s\n",
+            (unsigned long long)stats.bytes, (unsigned long long)stats.lines,
+            (unsigned long long)stats.skipped,
+            parsed - start,
+            (double)stats.bytes / (1 << 20) / (parsed - start + 1e-9),
+            (size_t)nthreads, stats.runs,
+            written - parsed,
+            (double)stats.phrases / (written - parsed + 1e-9),
+            (unsigned long long)stats.keys, zyp_dict_phrase_count(dict),
+            (long long)st.st_size,
+            total, (double)stats.bytes / (1 << 20) / (total + 1e-9));
+    zyp_dict_close(dict);
+    err = 0;
+
+out:
+    if (in != stdin) {
+        fclose(in);
+    }
+    for (size_t i = 0; i < stats.runs; i++) {
+        fclose(runs[i]);
+    }
+    if (workers) {
+        for (long i = 0; i < nthreads; i++) {
+            free(workers[i].records);
+            free(workers[i].pool);
+        }
+    }
+    free(workers);
+    free(runs);
+    free(chunk);
+    zyp_dict_builder_free(b);
+    return err;
+}